@@ -0,0 +1,267 @@
+#ifndef GAUGE_ALLOCATION_COLLECTOR_HPP
+#define GAUGE_ALLOCATION_COLLECTOR_HPP
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Python.h>
+#include <frameobject.h>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/collector.hpp"
+#include "gauge/utils/chrono.hpp"
+#include "gauge/utils/code_registry.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace allocation_collector_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+using namespace gauge;
+
+/**
+ * Samples allocations of memory by Python.
+ *
+ * Allocators of the "mem" and "object" domains are wrapped, on average
+ * one allocation in each "sampling_rate" of allocated bytes is sampled -
+ * distances between samples are drawn from the exponential distribution,
+ * so that periodic patterns of allocations aren't aliased. Only code
+ * objects and last executed instructions of the allocating thread's stack
+ * are captured by the allocator, the rest is done by a separate thread.
+ *
+ * A trace of the allocating thread is emitted for each sampled allocation,
+ * it carries the estimated count of bytes the sample stands for.
+ * Sampled allocations are tracked until they are released, so that
+ * profiles of both allocated and live memory could be dumped.
+ *
+ * The allocators can't be unwrapped while they are wrapped by someone
+ * else after the collector, e.g. by tracemalloc - stopping fails then.
+ * If the collector is destroyed meanwhile - its hooks are leaked, they
+ * keep forwarding calls to the original allocators.
+ */
+class AllocationCollector : public CollectorInterface {
+public:
+    static const CollectionMethod collection_method =
+        CollectionMethod::Sampling;
+
+    /**
+     * @param sampling_rate Average count of allocated bytes per sample.
+     *
+     * @throws CollectorError If the sampling rate is zero.
+     */
+    explicit AllocationCollector(
+        std::size_t                         sampling_rate       = 512 * 1024,
+        std::chrono::steady_clock::duration processing_interval = 1s);
+
+    AllocationCollector(const AllocationCollector &collector)     = delete;
+    AllocationCollector(AllocationCollector &&collector) noexcept = delete;
+    AllocationCollector &
+    operator=(const AllocationCollector &collector)             = delete;
+    AllocationCollector &operator=(AllocationCollector &&collector) = delete;
+    ~AllocationCollector() override;
+
+    void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    std::vector<DispatchStats> get_dispatch_stats() const override;
+    /**
+     * Should be called with the GIL held.
+     */
+    void start() override;
+    void resume() override;
+    bool is_paused() override;
+    void pause() override;
+    /**
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If the allocators have been wrapped after
+     *         the collector has been started, they stay wrapped.
+     */
+    void stop() override;
+    bool is_stopped() const override;
+
+    std::size_t get_sampling_rate() const;
+
+    /**
+     * Write the profile of processed samples to the file in the collapsed
+     * stacks format, stacks are weighted by estimated counts of bytes.
+     *
+     * @param live Write only memory that hasn't been released yet instead
+     *             of all of the allocated memory.
+     * @return Count of written stacks.
+     * @throws CollectorError If the file couldn't be written.
+     */
+    std::size_t dump(const std::string &path, bool live = false);
+
+    /**
+     * Get count of sampled allocations that haven't been released yet.
+     */
+    std::size_t get_live_samples_count();
+
+private:
+    using TimePointConversionUtil = detail::TimePointConversionUtil<
+        std::chrono::steady_clock,
+        std::chrono::system_clock>;
+
+    struct RawFrame {
+        /**
+         * Owned reference.
+         */
+        PyCodeObject * code    = nullptr;
+        int            lasti   = -1;
+        std::uintptr_t address = 0;
+    };
+
+    struct Sample {
+        unsigned long long                    id              = 0;
+        unsigned long long                    thread_id       = 0;
+        unsigned long long                    estimated_bytes = 0;
+        std::chrono::steady_clock::time_point timestamp;
+        /**
+         * Bottommost frame goes first.
+         */
+        std::vector<RawFrame> frames;
+    };
+
+    /**
+     * Wrapped allocator of a domain, the hooks only forward calls if
+     * the collector is gone.
+     */
+    struct Hook {
+        AllocationCollector *self = nullptr;
+        PyMemAllocatorEx     original{};
+    };
+
+    struct Profile {
+        unsigned long long allocated_bytes = 0;
+        unsigned long long live_bytes      = 0;
+    };
+
+    /*! Deeper frames aren't captured. */
+    static constexpr std::size_t max_depth = 128;
+    static constexpr std::size_t live_filter_bits = 1U << 16U;
+
+    std::shared_ptr<spdlog::logger>     logger;
+    std::size_t                         sampling_rate;
+    std::chrono::steady_clock::duration processing_interval;
+    std::atomic<bool>                   is_stopped_flag;
+    std::atomic<bool>                   is_paused_flag;
+    std::thread                         processor_thread;
+    std::string                         hostname;
+    unsigned long long                  process_id;
+    /**
+     * Mutex for guarding subscribing and profiles.
+     */
+    std::mutex mutex;
+    detail::Subscribers<
+        std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>>
+        subscribers;
+
+    /* --- State of the allocators, guarded by the GIL --- */
+    /**
+     * Allocated separately since they could outlive the collector.
+     */
+    std::unique_ptr<Hook> mem_hook;
+    std::unique_ptr<Hook> object_hook;
+    /**
+     * Bytes left to allocate until the next sample.
+     */
+    std::int64_t                          bytes_until_sample = 0;
+    std::mt19937_64                       random_generator;
+    std::exponential_distribution<double> sample_distance;
+    unsigned long long                    next_sample_id = 1;
+    std::vector<Sample>                   pending_samples;
+    std::vector<unsigned long long>       released_sample_ids;
+    /**
+     * IDs of samples of allocations that haven't been released yet.
+     */
+    std::unordered_map<void *, unsigned long long> live_allocations;
+    /**
+     * Bits of hashes of addresses of live sampled allocations, releases of
+     * the rest of allocations are mostly filtered out by it without
+     * looking up the map. Bits of released allocations are cleared by
+     * rebuilding it once as many allocations are released as are live.
+     */
+    std::array<std::uint64_t, live_filter_bits / 64> live_filter{};
+    std::size_t                                      live_filter_released = 0;
+
+    /* --- State of the processor thread --- */
+    /**
+     * Decoded code objects of sampled frames, guarded by the GIL.
+     */
+    detail::CodeRegistry code_registry;
+    /**
+     * Profiles by collapsed stacks, guarded by the mutex.
+     */
+    std::map<std::string, Profile> profiles;
+    /**
+     * Stacks and estimated bytes of live samples by their IDs.
+     */
+    std::unordered_map<
+        unsigned long long,
+        std::pair<Profile *, unsigned long long>>
+        live_samples;
+
+    static void *malloc_hook(void *context, std::size_t size);
+    static void *
+    calloc_hook(void *context, std::size_t count, std::size_t size);
+    static void *realloc_hook(void *context, void *pointer, std::size_t size);
+    static void  free_hook(void *context, void *pointer);
+
+    void install(PyMemAllocatorDomain domain, Hook &hook);
+    void uninstall(PyMemAllocatorDomain domain, Hook &hook);
+    /**
+     * Whether the hook has been wrapped by another allocator.
+     */
+    static bool is_wrapped(PyMemAllocatorDomain domain, const Hook &hook);
+    /**
+     * Stop the processor thread and forget live allocations.
+     */
+    void stop_processing();
+    static std::size_t get_live_filter_bit(const void *pointer);
+    void               rebuild_live_filter();
+    /**
+     * Account the allocation and sample it if its turn has come.
+     */
+    inline void on_allocation(void *pointer, std::size_t size);
+    inline void on_release(void *pointer);
+    void        sample(void *pointer, std::size_t size);
+    /**
+     * Release references to code objects of the samples.
+     *
+     * Should be called with the GIL held.
+     */
+    static void release(std::vector<Sample> &samples);
+
+    /**
+     * Turn sampled allocations into traces in an infinite loop.
+     */
+    void processor();
+    void process_samples();
+    std::shared_ptr<TraceSample> construct_trace(
+        const Sample &                                   sample,
+        const TimePointConversionUtil::BaseMeasurements &base_measurements);
+};
+} // namespace allocation_collector_impl
+
+using allocation_collector_impl::AllocationCollector;
+
+} // namespace gauge
+
+#endif // GAUGE_ALLOCATION_COLLECTOR_HPP
@@ -18,7 +18,27 @@ enum CollectionMethod {
      * Collector selects only a subset of events that is incomplete but
      * represents the "big picture".
      */
-    Sampling
+    Sampling,
+    /**
+     * Collector records every call and return of selected functions.
+     */
+    Tracing
+};
+
+/**
+ * Whether a sampled thread held the GIL.
+ */
+enum GILState {
+    /**
+     * The GIL isn't sampled.
+     */
+    Unknown,
+    Holding,
+    /**
+     * The thread either waited for the GIL or ran code that released it,
+     * the two can't be told apart.
+     */
+    Released
 };
 // TODO: Should it be structured with parent-child links for explicitness?
 /**
@@ -43,6 +63,40 @@ template <const CollectionMethod COLLECTION_METHOD> struct Trace {
     unsigned long long                    thread_id                 = 0;
     unsigned long long                    process_id                = 0;
     std::string                           hostname                  = "";
+    /**
+     * Stack of the thread hasn't changed since its previous trace,
+     * "frames" are empty in this case.
+     */
+    bool is_unchanged = false;
+    /**
+     * CPU time consumed by the thread since its previous trace, measured
+     * only when the collector samples CPU time.
+     */
+    std::chrono::nanoseconds cpu_time{0};
+    /**
+     * Set only when the collector samples the GIL.
+     */
+    GILState gil_state = GILState::Unknown;
+    /**
+     * Time the thread kept the collector waiting for the GIL, set only for
+     * the thread holding the GIL.
+     */
+    std::chrono::nanoseconds gil_wait{0};
+    /**
+     * Time the trace stands for - the actual interval since the collector's
+     * previous sample, set only by the sampling collector.
+     */
+    std::chrono::nanoseconds weight{0};
+    /**
+     * Estimated count of bytes allocated at the stack, set only by
+     * the allocation collector.
+     */
+    unsigned long long allocated_bytes = 0;
+    /**
+     * IDs of tags read from the thread's context, resolved by the tag
+     * registry.
+     */
+    std::vector<unsigned int> tags;
 
     Trace(
         std::shared_ptr<std::vector<std::shared_ptr<Frame>>> frames,
@@ -94,6 +148,20 @@ struct Span {
     unsigned long long                    thread_id  = 0;
     unsigned long long                    process_id = 0;
     std::string                           hostname{};
+    /**
+     * Count of consecutive calls the span stands for when repeated sibling
+     * spans are coalesced, set on end-spans.
+     */
+    unsigned long long repetition_count = 1;
+    /**
+     * Sum of durations of the coalesced calls without gaps between them,
+     * set on end-spans of spans repeated more than once.
+     */
+    std::chrono::nanoseconds summed_duration{0};
+    /**
+     * IDs of tags of the trace the span was last seen in.
+     */
+    std::vector<unsigned int> tags;
 
     Span(
         SpanLifeTime                          lifetime,
@@ -128,7 +196,8 @@ struct Span {
           is_generator{frame.is_generator},
           monotonic_clock_timestamp{trace.monotonic_clock_timestamp},
           timestamp{trace.timestamp}, thread_id{trace.thread_id},
-          process_id{trace.process_id}, hostname{trace.hostname} {}
+          process_id{trace.process_id}, hostname{trace.hostname},
+          tags{trace.tags} {}
     Span() = default;
 };
 
@@ -228,6 +297,7 @@ using base_impl::CollectorError;
 using base_impl::ExporterError;
 using base_impl::Frame;
 using base_impl::GaugeError;
+using base_impl::GILState;
 using base_impl::InvalidLoggingLevel;
 using base_impl::LoggingHasAlreadyBeenSetup;
 using base_impl::Span;
@@ -0,0 +1,161 @@
+#ifndef GAUGE_CHROME_TRACE_WRITER_HPP
+#define GAUGE_CHROME_TRACE_WRITER_HPP
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/async_dispatcher.hpp"
+
+namespace gauge {
+namespace chrome_trace_writer_impl {
+
+/**
+ * Streams spans to files in the Chrome trace event format, which is read
+ * by chrome://tracing and Perfetto UI.
+ *
+ * Start-spans and end-spans become "B" and "E" events on the track of
+ * their process and thread. Batches of spans are queued and written by
+ * a dedicated thread, so the aggregator never waits for the disk unless
+ * the queue is full and the policy is BackpressurePolicy::Block.
+ *
+ * Viewers end the innermost open slice of a track, so when a span ends
+ * before spans started inside of it, they are ended and started again.
+ *
+ * Files are rotated when they grow over the maximum size, each of them is
+ * a complete JSON array. Spans open at rotation are ended at the end of
+ * the file and started again at the beginning of the next one.
+ */
+class ChromeTraceWriter {
+public:
+    using Spans = std::shared_ptr<std::vector<std::shared_ptr<Span>>>;
+
+    /**
+     * @param path Path of the first file, numbers of rotated files are
+     *             inserted before the extension - "trace.1.json".
+     * @param max_file_size Size in bytes after which the file is rotated,
+     *                      zero disables rotation.
+     * @param options Capacity of the queue of batches and the policy
+     *                applied when it's full.
+     * @throws ExporterError If the file couldn't be opened.
+     */
+    explicit ChromeTraceWriter(
+        const std::string &    path,
+        std::size_t            max_file_size = 0,
+        const DispatchOptions &options =
+            DispatchOptions{64, BackpressurePolicy::Block});
+
+    ChromeTraceWriter(const ChromeTraceWriter &writer)     = delete;
+    ChromeTraceWriter(ChromeTraceWriter &&writer) noexcept = delete;
+    ChromeTraceWriter &operator=(const ChromeTraceWriter &writer) = delete;
+    ChromeTraceWriter &operator=(ChromeTraceWriter &&writer) = delete;
+    ~ChromeTraceWriter();
+
+    /**
+     * Queue the spans for writing.
+     */
+    void operator()(const Spans &spans);
+
+    /**
+     * Write the queued spans and complete the current file, spans passed
+     * afterwards are ignored.
+     */
+    void close();
+
+    /**
+     * Get paths of all of the written files, the current one is the last.
+     */
+    std::vector<std::string> get_paths();
+
+    unsigned long long get_written_events_count() const;
+
+    /**
+     * Get metrics of the queue of batches.
+     */
+    DispatchStats get_dispatch_stats();
+
+private:
+    using ThreadKey = std::pair<unsigned long long, unsigned long long>;
+
+    struct Track {
+        /**
+         * Small ID of the thread, IDs of threads are too large for
+         * the format's numbers.
+         */
+        unsigned long long tid = 0;
+        /**
+         * Start-spans of the thread that haven't ended yet, in the order
+         * they have started.
+         */
+        std::vector<std::shared_ptr<Span>> open_spans;
+        /**
+         * The track has been named in the current file.
+         */
+        bool is_named = false;
+    };
+
+    std::shared_ptr<spdlog::logger> logger;
+    std::string                     path;
+    std::size_t                     max_file_size;
+    /**
+     * Guards the dispatcher, it's held while batches are pushed, so
+     * the writer thread must never lock it.
+     */
+    std::mutex mutex;
+    std::unique_ptr<detail::AsyncDispatcher<Spans>> dispatcher;
+    /**
+     * Metrics of the queue at the moment it was closed.
+     */
+    DispatchStats closed_dispatch_stats;
+    /**
+     * Guards the list of paths, which is appended by the writer thread.
+     */
+    std::mutex                      paths_mutex;
+    std::vector<std::string>        paths;
+    std::atomic<unsigned long long> written_events_count;
+
+    /* --- State of the writer thread --- */
+    std::ofstream              file;
+    std::size_t                file_size = 0;
+    bool                       is_empty  = true;
+    unsigned long long         next_tid  = 1;
+    std::map<ThreadKey, Track> tracks;
+    /**
+     * Timestamp of the latest written event in nanoseconds since the epoch.
+     */
+    long long last_timestamp = 0;
+
+    void write(const Spans &spans);
+    void write_start(
+        const Span & span,
+        const Track &track,
+        long long    timestamp);
+    void write_end(const Span &span, const Track &track, long long timestamp);
+    /**
+     * Name the track in the current file if it isn't named yet.
+     */
+    void name_track(const ThreadKey &key, Track &track);
+    /**
+     * Append the event to the current file.
+     */
+    void append(const std::string &event);
+    void        open_file(const std::string &file_path);
+    void        complete_file();
+    void        rotate();
+    std::string get_path(std::size_t number) const;
+};
+} // namespace chrome_trace_writer_impl
+
+using chrome_trace_writer_impl::ChromeTraceWriter;
+
+} // namespace gauge
+
+#endif // GAUGE_CHROME_TRACE_WRITER_HPP
@@ -4,11 +4,13 @@
 #include <list>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include <Python.h>
 #include <pybind11/pybind11.h>
 
 #include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
 #include "gauge/utils/chrono.hpp"
 
 namespace gauge {
@@ -32,9 +34,18 @@ public:
      * Subscribe a callback that would be called with collected raw data.
      *
      * @param callback A callback to be subscribed.
+     * @param options Options of the callback's own queue, if any.
      */
-    virtual void subscribe(CallbackInterface &callback)         = 0;
-    virtual void subscribe(py::object callback)                 = 0;
+    virtual void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) = 0;
+    virtual void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) = 0;
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    virtual std::vector<DispatchStats> get_dispatch_stats() const = 0;
     virtual void start()                                        = 0;
     virtual void resume()                                       = 0;
     virtual bool is_paused()                                    = 0;
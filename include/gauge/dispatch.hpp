@@ -0,0 +1,72 @@
+#ifndef GAUGE_DISPATCH_HPP
+#define GAUGE_DISPATCH_HPP
+#include <chrono>
+#include <cstddef>
+
+namespace gauge {
+namespace dispatch_impl {
+
+/**
+ * What happens to a batch passed to a subscriber which queue is full.
+ */
+enum BackpressurePolicy {
+    /**
+     * The producer waits until there is free space in the queue.
+     */
+    Block,
+    /**
+     * The batch is dropped.
+     */
+    DropNewest,
+    /**
+     * The oldest queued batch is dropped to free space for the batch.
+     */
+    DropOldest,
+    /**
+     * Only every other batch is queued once the queue is half full,
+     * the batch is dropped when the queue is full.
+     */
+    SampleDown
+};
+
+/**
+ * How batches are passed to a subscriber.
+ */
+struct DispatchOptions {
+    /**
+     * Capacity of the subscriber's own queue, batches are queued and
+     * passed to the subscriber from a dedicated thread. Zero means that
+     * the subscriber is called synchronously by the producer.
+     */
+    std::size_t        queue_capacity = 0;
+    BackpressurePolicy policy         = Block;
+};
+
+/**
+ * Metrics of a subscriber with its own queue.
+ */
+struct DispatchStats {
+    std::size_t        queue_capacity   = 0;
+    std::size_t        queue_size       = 0;
+    BackpressurePolicy policy           = Block;
+    unsigned long long dispatched_count = 0;
+    unsigned long long dropped_count    = 0;
+    /**
+     * Age of the oldest queued batch.
+     */
+    std::chrono::steady_clock::duration lag{0};
+    /**
+     * Maximum time a batch has spent in the queue.
+     */
+    std::chrono::steady_clock::duration max_lag{0};
+};
+
+} // namespace dispatch_impl
+
+using dispatch_impl::BackpressurePolicy;
+using dispatch_impl::DispatchOptions;
+using dispatch_impl::DispatchStats;
+
+} // namespace gauge
+
+#endif // GAUGE_DISPATCH_HPP
@@ -0,0 +1,190 @@
+#ifndef GAUGE_GC_COLLECTOR_HPP
+#define GAUGE_GC_COLLECTOR_HPP
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Python.h>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/collector.hpp"
+#include "gauge/utils/chrono.hpp"
+#include "gauge/utils/spsc_ring.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace gc_collector_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+using namespace gauge;
+
+/**
+ * Statistics of garbage collections of a generation.
+ */
+struct GCStats {
+    unsigned int       generation          = 0;
+    unsigned long long collections_count   = 0;
+    unsigned long long collected_count     = 0;
+    unsigned long long uncollectable_count = 0;
+    /**
+     * Sum of durations of the collections.
+     */
+    std::chrono::nanoseconds total_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+};
+
+/**
+ * Records pauses of Python's garbage collector.
+ *
+ * A native callback is appended to "gc.callbacks", it only writes starts
+ * and stops of collections into a lock-free ring. The ring is drained by
+ * a separate thread which turns the collections into traces.
+ *
+ * Each collection is represented by a trace of the collecting thread at
+ * its start and at its stop. The trace consists of a single synthetic
+ * frame named after the collected generation with a unique cookie, so
+ * SpanAggregator makes a span of each collection with its exact duration.
+ */
+class GCCollector : public CollectorInterface {
+public:
+    static const CollectionMethod collection_method =
+        CollectionMethod::Tracing;
+    /**
+     * File name of synthetic frames of collections.
+     */
+    static constexpr const char *file_name = "<gc>";
+
+    explicit GCCollector(
+        std::chrono::steady_clock::duration processing_interval = 100ms);
+
+    GCCollector(const GCCollector &collector)     = delete;
+    GCCollector(GCCollector &&collector) noexcept = delete;
+    GCCollector &operator=(const GCCollector &collector) = delete;
+    GCCollector &operator=(GCCollector &&collector) = delete;
+    ~GCCollector() override;
+
+    void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    std::vector<DispatchStats> get_dispatch_stats() const override;
+    /**
+     * Should be called with the GIL held.
+     */
+    void start() override;
+    void resume() override;
+    bool is_paused() override;
+    void pause() override;
+    /**
+     * Should be called with the GIL held.
+     */
+    void stop() override;
+    bool is_stopped() const override;
+
+    /**
+     * Get statistics of processed collections by generations.
+     */
+    std::vector<GCStats> get_stats();
+
+    /**
+     * Get count of events dropped because of the full buffer.
+     */
+    unsigned long long get_dropped_events_count() const;
+
+private:
+    using TimePointConversionUtil = detail::TimePointConversionUtil<
+        std::chrono::steady_clock,
+        std::chrono::system_clock>;
+
+    struct Event {
+        enum Kind : std::uint8_t { Start, Stop };
+        Kind               kind                = Start;
+        unsigned int       generation          = 0;
+        unsigned long long collected_count     = 0;
+        unsigned long long uncollectable_count = 0;
+        unsigned long long thread_id           = 0;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    struct Collection {
+        unsigned int                          generation = 0;
+        unsigned long long                    cookie     = 0;
+        unsigned long long                    thread_id  = 0;
+        std::chrono::steady_clock::time_point start_timestamp;
+    };
+
+    static constexpr std::size_t events_capacity = 1024;
+    /*! CPython has three generations. */
+    static constexpr std::size_t generations_count = 3;
+
+    std::shared_ptr<spdlog::logger> logger;
+    /**
+     * Mapping of the steady clock to the system clock of the batch being
+     * processed, used only by the processor thread.
+     */
+    TimePointConversionUtil::BaseMeasurements clocks_base_measurements;
+    std::chrono::steady_clock::duration       processing_interval;
+    std::atomic<bool>                         is_stopped_flag;
+    std::atomic<bool>                         is_paused_flag;
+    std::atomic<unsigned long long>           dropped_events_count;
+    std::thread                               processor_thread;
+    std::string                               hostname;
+    unsigned long long                        process_id;
+    /**
+     * Mutex for guarding subscribing and statistics.
+     */
+    std::mutex mutex;
+    detail::Subscribers<
+        std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>>
+        subscribers;
+
+    /**
+     * Collections run with the GIL held, so the threads writing events
+     * never overlap and the ring is used as if there was one producer.
+     */
+    detail::SPSCRing<Event, events_capacity> events;
+    /**
+     * Callback registered in "gc.callbacks", guarded by the GIL.
+     */
+    py::object gc_callback;
+
+    /* --- State of the processor thread --- */
+    unsigned long long next_cookie = 1;
+    /**
+     * Collection that has started but hasn't stopped yet.
+     */
+    std::unique_ptr<Collection> current_collection;
+
+    std::array<GCStats, generations_count> stats;
+
+    void record(const Event &event);
+
+    /**
+     * Turn recorded events into traces in an infinite loop.
+     */
+    void processor();
+    void process_events();
+    std::shared_ptr<TraceSample> construct_trace(
+        const Collection &                    collection,
+        std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+        bool                                  is_unchanged = false);
+};
+} // namespace gc_collector_impl
+
+using gc_collector_impl::GCCollector;
+using gc_collector_impl::GCStats;
+
+} // namespace gauge
+
+#endif // GAUGE_GC_COLLECTOR_HPP
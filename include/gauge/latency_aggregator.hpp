@@ -0,0 +1,196 @@
+#ifndef GAUGE_LATENCY_AGGREGATOR_HPP
+#define GAUGE_LATENCY_AGGREGATOR_HPP
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/hdr_histogram.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace latency_aggregator_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+
+/**
+ * Distribution of durations of calls of a single function.
+ */
+struct LatencyStats {
+    std::string symbolic_name;
+    std::string file_name;
+    /**
+     * Function of the top-level span the calls were made under, empty
+     * unless durations are grouped by top-level spans.
+     */
+    std::string              top_symbolic_name;
+    std::string              top_file_name;
+    unsigned long long       count = 0;
+    std::chrono::nanoseconds min{0};
+    std::chrono::nanoseconds max{0};
+    std::chrono::nanoseconds mean{0};
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds p999{0};
+    /**
+     * Non-zero counters of the histogram - pairs of the lowest durations
+     * in nanoseconds and counts, encoded as little-endian 64-bit unsigned
+     * integers.
+     */
+    std::string histogram;
+};
+
+/**
+ * Aggregates spans into histograms of durations of calls per function.
+ *
+ * Durations are counted in HDR histograms over a sliding time window
+ * made of "window_count" rotating windows, the windows are switched by
+ * timestamps of spans. When a window is switched - stats of the sliding
+ * window are passed to subscribers.
+ *
+ * Histograms are written only under the mutex but read without it, so
+ * taking a snapshot doesn't stall aggregation.
+ *
+ * Start times of open spans are kept until the spans end. When
+ * "max_open_spans" spans are open - the older half of them is dropped,
+ * so that spans which ends are lost don't accumulate.
+ */
+class LatencyAggregator {
+public:
+    using Snapshot = std::shared_ptr<std::vector<LatencyStats>>;
+
+    /**
+     * @param window Duration of each of the rotating windows, zero
+     *               disables rotation.
+     * @param window_count Count of the windows kept.
+     * @param by_top_span Group durations by functions of top-level spans.
+     * @param significant_digits Precision of the histograms, from 1 to 4.
+     * @param max_open_spans Count of open spans kept.
+     */
+    explicit LatencyAggregator(
+        std::chrono::steady_clock::duration window             = 10s,
+        unsigned int                        window_count       = 6,
+        bool                                by_top_span        = false,
+        int                                 significant_digits = 2,
+        std::size_t                         max_open_spans     = 65536);
+
+    void subscribe(
+        std::function<void(const Snapshot &)> callback,
+        const DispatchOptions &               options = DispatchOptions());
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions());
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats();
+
+    /**
+     * Count durations of the ended spans.
+     */
+    void operator()(
+        const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans);
+
+    /**
+     * Get stats of all of the functions over the sliding window.
+     */
+    std::vector<LatencyStats> snapshot();
+
+    /**
+     * Drop the histograms, spans that are already open are still counted
+     * when they end.
+     */
+    void reset();
+
+private:
+    struct Window {
+        /**
+         * Number of the window the histogram is counted for.
+         */
+        std::atomic<long long> number{-1};
+        detail::HdrHistogram   histogram;
+
+        explicit Window(int significant_digits)
+            : histogram{significant_digits} {}
+    };
+
+    struct Series {
+        std::string symbolic_name;
+        std::string file_name;
+        std::string top_symbolic_name;
+        std::string top_file_name;
+        /**
+         * Windows by their numbers modulo the count of windows.
+         */
+        std::vector<std::unique_ptr<Window>> windows;
+    };
+
+    using Function = std::pair<std::string, std::string>;
+
+    struct OpenSpan {
+        std::chrono::steady_clock::time_point start;
+        /**
+         * Function of the span's top-level span.
+         */
+        std::shared_ptr<const Function> top;
+    };
+
+    using SeriesKey =
+        std::tuple<std::string, std::string, std::string, std::string>;
+
+    std::mutex                          mutex;
+    std::shared_ptr<spdlog::logger>     logger;
+    detail::Subscribers<Snapshot>       subscribers;
+    std::chrono::steady_clock::duration window;
+    unsigned int                        window_count;
+    bool                                by_top_span;
+    int                                 significant_digits;
+    std::size_t                         max_open_spans;
+    /**
+     * Number of the latest window.
+     */
+    long long current_window = 0;
+
+    std::map<SeriesKey, std::shared_ptr<Series>, std::less<>> series;
+    std::unordered_map<std::string, OpenSpan>                  open_spans;
+
+    /**
+     * Drop the older half of the open spans.
+     */
+    void      drop_oldest_open_spans();
+    long long get_window_number(
+        std::chrono::steady_clock::time_point timestamp) const;
+    Series &  get_series(const Span &span, const Function *top);
+    void      record(
+             Series &                            target,
+             std::chrono::steady_clock::duration duration,
+             long long                           window_number);
+    /**
+     * Make stats of the series from the windows of the sliding window.
+     */
+    std::vector<LatencyStats> collect(
+        const std::vector<std::shared_ptr<Series>> &all_series,
+        long long                                   window_number) const;
+};
+} // namespace latency_aggregator_impl
+
+using latency_aggregator_impl::LatencyAggregator;
+using latency_aggregator_impl::LatencyStats;
+
+} // namespace gauge
+
+#endif // GAUGE_LATENCY_AGGREGATOR_HPP
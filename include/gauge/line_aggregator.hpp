@@ -0,0 +1,188 @@
+#ifndef GAUGE_LINE_AGGREGATOR_HPP
+#define GAUGE_LINE_AGGREGATOR_HPP
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace line_aggregator_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+
+/**
+ * Sample counts of a single line of code.
+ */
+struct LineStats {
+    std::string file_name;
+    int         line_number = 0;
+    /**
+     * Count of samples in which the line was being executed.
+     */
+    unsigned long long self_count = 0;
+    /**
+     * Count of samples in which the line was anywhere in the stack, lines
+     * of recursive calls are counted once per sample.
+     */
+    unsigned long long total_count = 0;
+    /**
+     * Sums of weights of the same samples, samples of irregular schedules
+     * stand for different spans of time.
+     */
+    std::chrono::nanoseconds self_time{0};
+    std::chrono::nanoseconds total_time{0};
+    /**
+     * Sums of CPU times of the same samples, zero unless CPU-time sampling
+     * is enabled in the collector.
+     */
+    std::chrono::nanoseconds self_cpu_time{0};
+    std::chrono::nanoseconds total_cpu_time{0};
+};
+
+/**
+ * Aggregates raw traces into per-line sample histograms.
+ *
+ * Counters are kept in an open-addressing hash table keyed by interned
+ * file names and line numbers, so counting a frame doesn't allocate.
+ * Unchanged traces count the thread's last complete stack once more.
+ * Besides counts, weights of traces are summed as times of the lines and
+ * CPU times of traces are summed as CPU times of the lines.
+ *
+ * When the snapshot interval is set - counters are periodically passed
+ * to subscribers and reset, the interval is measured by timestamps of
+ * traces.
+ */
+class LineAggregator {
+public:
+    using Snapshot = std::shared_ptr<std::vector<LineStats>>;
+
+    explicit LineAggregator(
+        std::chrono::steady_clock::duration snapshot_interval = 0s);
+
+    void subscribe(
+        std::function<void(const Snapshot &)> callback,
+        const DispatchOptions &               options = DispatchOptions());
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions());
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats();
+
+    /**
+     * Count lines of the traces.
+     */
+    void
+    operator()(const std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>
+                   &traces);
+
+    /**
+     * Get counters of all of the lines.
+     *
+     * @param reset Reset the counters after taking the snapshot.
+     */
+    std::vector<LineStats> snapshot(bool reset = false);
+
+    /**
+     * Get "count" of lines with the highest counts.
+     *
+     * Lines are ordered by times and then by counts, so that lines of
+     * unweighted traces are still ordered.
+     *
+     * @param by_total Order by total counts instead of self counts.
+     * @param by_cpu_time Order by CPU times before times and counts.
+     */
+    std::vector<LineStats>
+    top(std::size_t count, bool by_total = false, bool by_cpu_time = false);
+
+    /**
+     * Reset the counters.
+     */
+    void reset();
+
+    /**
+     * Count of samples since the last reset.
+     */
+    unsigned long long get_samples_count();
+
+private:
+    /**
+     * Interned file name in the high half, line number in the low half.
+     */
+    using LineKey = std::uint64_t;
+
+    struct Slot {
+        LineKey                  key         = empty_key;
+        unsigned long long       self_count  = 0;
+        unsigned long long       total_count = 0;
+        std::chrono::nanoseconds self_time{0};
+        std::chrono::nanoseconds total_time{0};
+        std::chrono::nanoseconds self_cpu_time{0};
+        std::chrono::nanoseconds total_cpu_time{0};
+        /**
+         * Number of the last sample that has counted the line, used for
+         * counting recursive lines once.
+         */
+        unsigned long long last_sample = 0;
+    };
+
+    static constexpr LineKey     empty_key        = ~LineKey{0};
+    static constexpr std::size_t initial_capacity = 1024;
+
+    std::mutex                                     mutex;
+    std::shared_ptr<spdlog::logger>                logger;
+    detail::Subscribers<Snapshot>                  subscribers;
+    std::chrono::steady_clock::duration            snapshot_interval;
+    std::chrono::steady_clock::time_point          last_snapshot_timestamp;
+    std::unordered_map<std::string, std::uint32_t> file_ids;
+    std::vector<std::string>                       file_names;
+    std::vector<Slot>                              slots;
+    std::size_t                                    slots_used    = 0;
+    unsigned long long                             samples_count = 0;
+
+    struct ThreadStack {
+        /**
+         * Lines of the thread's last complete stack, bottommost first.
+         */
+        std::vector<LineKey> lines;
+        /**
+         * The thread has been seen since the last reset.
+         */
+        bool is_seen = true;
+    };
+    using ThreadKey = std::pair<unsigned long long, unsigned long long>;
+    std::map<ThreadKey, ThreadStack> last_stacks;
+
+    LineKey intern(const Frame &frame);
+    Slot &  find_slot(LineKey key);
+    void    grow();
+    void    count_stack(
+           const std::vector<LineKey> &stack,
+           std::chrono::nanoseconds    weight,
+           std::chrono::nanoseconds    cpu_time);
+    std::vector<LineStats> collect(bool reset);
+    void                   reset_counters();
+};
+} // namespace line_aggregator_impl
+
+using line_aggregator_impl::LineAggregator;
+using line_aggregator_impl::LineStats;
+
+} // namespace gauge
+
+#endif // GAUGE_LINE_AGGREGATOR_HPP
@@ -0,0 +1,164 @@
+#ifndef GAUGE_REMOTE_SAMPLING_COLLECTOR_HPP
+#define GAUGE_REMOTE_SAMPLING_COLLECTOR_HPP
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+#include <sys/types.h>
+
+#include "gauge/base.hpp"
+#include "gauge/collector.hpp"
+#include "gauge/utils/chrono.hpp"
+#include "gauge/utils/frame_snapshot.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace remote_sampling_collector_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+using namespace gauge;
+
+/**
+ * Samples stacks of threads of another Python process (Linux only).
+ *
+ * Structures of the process' interpreter are copied with
+ * process_vm_readv() and validated the same way as during GIL-free
+ * sampling, so the sampled process is never stopped and doesn't execute
+ * anything on behalf of the collector. The process has to run the same
+ * version of Python as the current one, reading its memory requires
+ * the same privileges as attaching to it with ptrace.
+ *
+ * Only the main interpreter of the process is sampled, threads are
+ * identified by the same IDs as threading.get_ident() returns in
+ * the process.
+ */
+class RemoteSamplingCollector : public CollectorInterface {
+public:
+    /**
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If the process couldn't be attached to.
+     */
+    explicit RemoteSamplingCollector(
+        pid_t                               pid,
+        std::chrono::steady_clock::duration sampling_interval   = 10000us,
+        std::chrono::steady_clock::duration processing_interval = 3s);
+
+    RemoteSamplingCollector(const RemoteSamplingCollector &collector) =
+        delete;
+    RemoteSamplingCollector(RemoteSamplingCollector &&collector) noexcept =
+        delete;
+    RemoteSamplingCollector &
+    operator=(const RemoteSamplingCollector &collector) = delete;
+    RemoteSamplingCollector &
+    operator=(RemoteSamplingCollector &&collector) = delete;
+    ~RemoteSamplingCollector() override;
+
+    void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    std::vector<DispatchStats> get_dispatch_stats() const override;
+    void start() override;
+    void resume() override;
+    bool is_paused() override;
+    void pause() override;
+    void stop() override;
+    bool is_stopped() const override;
+
+    pid_t get_pid() const;
+
+    std::chrono::steady_clock::duration get_sampling_interval();
+
+    void set_sampling_interval(
+        std::chrono::steady_clock::duration interval) noexcept;
+
+    /**
+     * Get count of samples dropped because the processing has fallen
+     * behind.
+     */
+    unsigned long long get_dropped_samples_count() const;
+
+    /**
+     * Get count of samples that failed because the process' memory
+     * couldn't be read consistently.
+     */
+    unsigned long long get_failed_samples_count() const;
+
+private:
+    using TimePointConversionUtil = detail::TimePointConversionUtil<
+        std::chrono::steady_clock,
+        std::chrono::system_clock>;
+    using Traces = std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>;
+
+    /*! Time workers' loops going to sleep each iteration. */
+    static constexpr auto sleep_interval = std::chrono::microseconds(1000);
+    /*! Time workers' loops gonna sleep each iteration during pause. */
+    static constexpr auto pause_sleep_interval = std::chrono::milliseconds(50);
+    /*! Samples are dropped while there are more unprocessed traces. */
+    static constexpr std::size_t max_pending_traces = 100000;
+
+    const pid_t                         pid;
+    std::shared_ptr<spdlog::logger>     logger;
+    std::string                         hostname;
+    std::chrono::steady_clock::duration sampling_interval;
+    std::chrono::steady_clock::duration processing_interval;
+    std::atomic<bool>                   is_stopped_flag;
+    std::atomic<bool>                   is_paused_flag;
+    std::atomic<unsigned long long>     dropped_samples_count;
+    std::atomic<unsigned long long>     failed_samples_count;
+    std::thread                         collector_thread;
+    std::thread                         processor_thread;
+    /**
+     * Guards subscribers, settings and pending traces.
+     */
+    std::mutex mutex;
+    std::mutex thread_management_mutex;
+    detail::Subscribers<Traces> subscribers;
+    Traces                      pending_traces;
+
+    /*! Used only by the collector thread. */
+    detail::FrameSnapshotter            snapshotter;
+    std::vector<detail::ThreadSnapshot> thread_snapshots;
+    std::vector<detail::FrameSnapshot>  frame_snapshots;
+
+    /**
+     * Sample the process in an infinite loop.
+     */
+    void collector();
+    /**
+     * Pass collected traces to subscribers in an infinite loop.
+     */
+    void processor();
+    void process_traces();
+    /**
+     * Halt collecting and processing, process remaining traces.
+     */
+    void finalize();
+    /**
+     * Copy stacks of all threads of the process.
+     */
+    bool collect_traces(
+        std::chrono::steady_clock::time_point      monotonic_clock_timestamp,
+        std::vector<std::shared_ptr<TraceSample>> &traces);
+    std::shared_ptr<TraceSample> construct_trace(
+        std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
+        unsigned long long                        thread_id,
+        const std::vector<detail::FrameSnapshot> &frames) const;
+};
+} // namespace remote_sampling_collector_impl
+
+using remote_sampling_collector_impl::RemoteSamplingCollector;
+
+} // namespace gauge
+
+#endif // GAUGE_REMOTE_SAMPLING_COLLECTOR_HPP
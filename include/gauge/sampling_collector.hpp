@@ -3,21 +3,32 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <deque>
-#include <forward_list>
 #include <list>
 #include <mutex>
+#include <random>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <Python.h>
+#include <boost/circular_buffer.hpp>
+#include <boost/functional/hash.hpp>
 #include <pybind11/pybind11.h>
 #include <spdlog/logger.h>
 
 #include "gauge/base.hpp"
 #include "gauge/collector.hpp"
+#include "gauge/thread_filter.hpp"
 #include "gauge/utils/chrono.hpp"
+#include "gauge/utils/code_registry.hpp"
+#include "gauge/utils/frame_snapshot.hpp"
+#include "gauge/utils/subscribers.hpp"
+#include "gauge/utils/thread_clock.hpp"
 
 namespace gauge {
 namespace sampling_collector_impl {
@@ -26,6 +37,27 @@ namespace py = pybind11;
 using namespace std::literals::chrono_literals;
 using namespace gauge;
 
+/**
+ * How intervals between samples are chosen, all of the schedules keep
+ * the sampling interval as the mean interval.
+ */
+enum SamplingSchedule {
+    /**
+     * Every interval is the sampling interval.
+     */
+    Fixed,
+    /**
+     * Intervals are distributed uniformly within half of the sampling
+     * interval around it.
+     */
+    Jittered,
+    /**
+     * Intervals are distributed exponentially, so samples are a Poisson
+     * process and never alias with periodic workloads.
+     */
+    Exponential
+};
+
 class SamplingCollector : public CollectorInterface {
 public:
     explicit SamplingCollector(
@@ -39,8 +71,13 @@ public:
     SamplingCollector &operator=(SamplingCollector &&collector) = delete;
     ~SamplingCollector() override;
 
-    void subscribe(CallbackInterface &callback) override;
-    void subscribe(py::object callback) override;
+    void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    std::vector<DispatchStats> get_dispatch_stats() const override;
     void start() override;
     void resume() override;
     bool is_paused() override;
@@ -53,11 +90,179 @@ public:
     void set_sampling_interval(
         std::chrono::steady_clock::duration interval) noexcept;
 
+    /**
+     * Set how intervals between samples are chosen.
+     *
+     * Each trace carries the actual interval since the previous sample of
+     * the collector as its weight, so irregular samples are still counted
+     * proportionally to time.
+     */
+    void set_sampling_schedule(SamplingSchedule schedule) noexcept;
+
+    SamplingSchedule get_sampling_schedule();
+
+    /**
+     * Set context variables read as tags of traces, empty list disables
+     * reading.
+     *
+     * Values are read from the current context of each sampled thread,
+     * variables not set in the context are skipped. Each pair of
+     * the variable's name and the value's string is interned by the tag
+     * registry, traces and spans carry the IDs of the tags. Tags aren't
+     * read during GIL-free sampling and for asyncio tasks.
+     *
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If any of the objects isn't a ContextVar.
+     */
+    void set_context_vars(const std::vector<py::object> &vars);
+
     std::chrono::steady_clock::duration get_collection_interval();
 
     void set_collection_interval(
         std::chrono::steady_clock::duration interval) noexcept;
 
+    /**
+     * Enable or disable collection of stacks of asyncio tasks.
+     *
+     * When enabled - in addition to stacks of OS threads, await-chains of
+     * all pending asyncio tasks are collected. Each task is represented
+     * as a separate logical thread with the ID equal to the ID of the task
+     * object.
+     *
+     * Should be called with the GIL held.
+     */
+    void set_async_tasks_collection(bool enabled);
+
+    bool is_collecting_async_tasks();
+
+    /**
+     * Get the filter deciding which threads are sampled.
+     */
+    ThreadFilter &get_thread_filter();
+
+    /**
+     * Enable or disable suppression of unchanged stacks.
+     *
+     * When enabled - stack of each thread is fingerprinted and if it is
+     * the same as in the previous sample, a trace marked as unchanged and
+     * without frames is emitted instead of the whole stack.
+     *
+     * Whole stacks are still emitted on the first sample after a subscriber
+     * is added and once in "max_unchanged_samples" samples, so that
+     * subscribers which have no base for unchanged traces catch up.
+     */
+    void set_unchanged_stacks_suppression(bool enabled);
+
+    bool is_suppressing_unchanged_stacks();
+
+    /**
+     * Enable or disable experimental GIL-free sampling (Linux only).
+     *
+     * When enabled - stacks of threads are copied without taking the GIL,
+     * the copies are validated and torn samples are retried or skipped.
+     * Frames are not referenced, so sampled stacks could be slightly
+     * inconsistent with the actual state of threads. Collection of asyncio
+     * tasks still requires the GIL.
+     *
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If it is not supported on the platform.
+     */
+    void set_gil_free_sampling(bool enabled);
+
+    bool is_gil_free_sampling();
+
+    /**
+     * Enable or disable measurement of CPU time of sampled threads.
+     *
+     * When enabled - each trace carries CPU time consumed by the thread
+     * since its previous sample. Threads that haven't consumed any CPU time
+     * could be skipped, if suppression of unchanged stacks is enabled too -
+     * unchanged traces are emitted for them instead.
+     *
+     * @throws CollectorError If per-thread CPU clocks are not supported on
+     *         the platform.
+     */
+    void set_cpu_time_sampling(bool enabled, bool skip_idle_threads = false);
+
+    bool is_cpu_time_sampling();
+
+    /**
+     * Enable or disable sampling of the GIL.
+     *
+     * When enabled - the thread holding the GIL is found before the GIL is
+     * taken for the sample, its trace is marked as holding the GIL and
+     * carries the time it kept the collector waiting. Traces of the rest
+     * of threads are marked as released. Only the holder is found during
+     * GIL-free sampling, the wait isn't measured.
+     *
+     * @throws CollectorError If the holder of the GIL can't be found with
+     *         the version of Python.
+     */
+    void set_gil_sampling(bool enabled);
+
+    bool is_gil_sampling();
+
+    /**
+     * Get count of samples dropped because the processing has fallen
+     * behind.
+     */
+    unsigned long long get_dropped_samples_count() const;
+
+    /**
+     * Enable or disable the flight recorder.
+     *
+     * When enabled - samples are only kept in a ring buffer of
+     * the given capacity in frames, the oldest samples are overwritten and
+     * nothing is passed to subscribers unless recorded samples are
+     * replayed. Recorded frames are not referenced.
+     *
+     * Unchanged stacks are recorded as references to frames of the thread's
+     * previous sample, so they are replayed and dumped as whole stacks.
+     * Samples which frames have been overwritten are dropped.
+     */
+    void set_flight_recording(bool enabled, std::size_t capacity = 1000000);
+
+    bool is_flight_recording();
+
+    /**
+     * Write stacks of recorded samples of the last "window" to the file in
+     * the collapsed stacks format, zero window means all of the samples.
+     *
+     * @return Count of written samples.
+     * @throws CollectorError If the file couldn't be written.
+     */
+    std::size_t dump(
+        const std::string &                 path,
+        std::chrono::steady_clock::duration window = 0s);
+
+    /**
+     * Pass recorded samples of the last "window" to the subscribers, zero
+     * window means all of the samples.
+     *
+     * @return Count of passed samples.
+     */
+    std::size_t replay(std::chrono::steady_clock::duration window = 0s);
+
+    /**
+     * Dump recorded samples when a call of any of the functions lasts
+     * longer than the threshold, with empty path the samples are replayed
+     * instead. Empty list of functions disables the watchdog.
+     *
+     * Each slow call triggers a single dump, dumps are made by
+     * the processor thread and overwrite the file.
+     *
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If any of the objects has no code.
+     */
+    void set_dump_watchdog(
+        const std::vector<py::object> &     functions,
+        std::chrono::steady_clock::duration threshold,
+        const std::string &                 path   = "",
+        std::chrono::steady_clock::duration window = 0s);
+
 private:
     using TimePointConversionUtil = detail::TimePointConversionUtil<
         std::chrono::steady_clock,
@@ -69,35 +274,77 @@ private:
         bool                                  is_generator  = false;
         bool                                  is_bottommost = false;
         bool                                  is_topmost    = false;
+        bool                                  is_unchanged  = false;
         unsigned long long                    cookie        = 0;
-        PyObject *                            thread_id     = nullptr;
+        unsigned long long                    thread_id     = 0;
         std::chrono::steady_clock::time_point monotonic_clock_timestamp = {};
+        /**
+         * Code of the frame, lines are resolved from it by "lasti". It is
+         * the only source of information about the frame during GIL-free
+         * sampling, "frame" is empty in this case.
+         */
+        std::shared_ptr<const detail::CodeInfo> code;
+        int                                     lasti = -1;
+        /**
+         * CPU time consumed by the thread and state of its GIL, set only for
+         * bottommost frames.
+         */
+        std::chrono::nanoseconds cpu_time{0};
+        GILState                 gil_state = GILState::Unknown;
+        std::chrono::nanoseconds gil_wait{0};
+        /**
+         * Interval since the previous sample, same for all of the frames of
+         * the sample.
+         */
+        std::chrono::nanoseconds weight{0};
+        /**
+         * IDs of tags of the thread, set only for bottommost frames.
+         */
+        std::vector<unsigned int> tags;
 
         RawFrame(
             decltype(frame)                     frame,
+            decltype(code)                      code,
             decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
             decltype(thread_id)                 thread_id,
             bool                                is_topmost    = false,
             bool                                is_bottommost = false);
+        RawFrame(
+            const detail::FrameSnapshot &       snapshot,
+            decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
+            decltype(thread_id)                 thread_id,
+            bool                                is_topmost,
+            bool                                is_bottommost);
+        /**
+         * Construct a marker of an unchanged stack of the thread.
+         */
+        RawFrame(
+            decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
+            decltype(thread_id)                 thread_id);
         RawFrame(RawFrame &&raw_frame) noexcept;
+        /**
+         * Swaps referenced frames, so the previous frame is released by
+         * the moved-from object.
+         */
         RawFrame &operator                  =(RawFrame &&raw_frame) noexcept;
         RawFrame(const RawFrame &raw_frame) = delete;
         RawFrame &operator=(const RawFrame &raw_frame) = delete;
         ~RawFrame();
     };
 
-    /*! Callbacks. */
-    std::forward_list<CallbackInterface> collect_callbacks;
-    /*! Python callbacks. */
-    std::forward_list<py::object> py_collect_callbacks;
+    detail::Subscribers<
+        std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>>
+        subscribers;
     /*! Time workers' loops going to sleep each iteration. */
     static constexpr auto sleep_interval = std::chrono::microseconds(1000);
     /*! Time workers' loops gonna sleep each iteration during pause. */
     static constexpr auto pause_sleep_interval = std::chrono::milliseconds(50);
     static constexpr auto frames_buffer_reserve = 100000;
+    /*! Samples are dropped while the buffer holds more frames. */
+    static constexpr std::size_t max_raw_frames = 10 * frames_buffer_reserve;
     std::chrono::steady_clock::duration       sampling_interval;
+    SamplingSchedule                          sampling_schedule;
     std::chrono::steady_clock::duration       processing_interval;
-    TimePointConversionUtil::BaseMeasurements clocks_base_measurements;
     std::atomic<bool>                         is_stopped_flag;
     std::atomic<bool>                         is_paused_flag;
     std::atomic<bool>                         ignore_own_threads_flag;
@@ -107,7 +354,8 @@ private:
     /**
      * Buffer that stores data collected by collector().
      */
-    std::list<RawFrame> raw_frames;
+    std::list<RawFrame>             raw_frames;
+    std::atomic<unsigned long long> dropped_samples_count;
     /**
      * Mutex for class-wise guarding of non-thread safe resources.
      */
@@ -120,9 +368,166 @@ private:
      * Logger for class-wise usage.
      */
     std::shared_ptr<spdlog::logger> logger;
-    py::object                      py_context;
+    /**
+     * Underlying set of weak references of asyncio's WeakSet of all tasks.
+     *
+     * Guarded by the GIL.
+     */
+    py::object        async_tasks;
+    std::atomic<bool> collect_async_tasks_flag;
 
     std::unordered_set<unsigned long long> own_thread_ids;
+    ThreadFilter                           thread_filter;
+
+    struct StackFingerprint {
+        std::size_t        hash         = 0;
+        unsigned long long sample_count = 0;
+        /**
+         * Count of unchanged traces emitted since the last whole stack.
+         */
+        unsigned int unchanged_count = 0;
+    };
+    /*! Whole stack is emitted after this many unchanged traces in a row. */
+    static constexpr unsigned int max_unchanged_samples = 100;
+    std::atomic<bool>             suppress_unchanged_stacks_flag;
+    /**
+     * Number of the current collect_frames() call, used to detect
+     * exited threads.
+     */
+    unsigned long long sample_count = 1;
+    /**
+     * Fingerprints of threads' stacks from the previous sample.
+     */
+    std::unordered_map<unsigned long long, StackFingerprint>
+        stack_fingerprints;
+
+    /**
+     * Decoded code objects of sampled frames, guarded by the GIL.
+     */
+    detail::CodeRegistry code_registry;
+    /**
+     * Copies stacks of threads when GIL-free sampling is enabled.
+     */
+    std::shared_ptr<detail::FrameSnapshotter> frame_snapshotter;
+    std::atomic<bool>       cpu_time_sampling_flag;
+    std::atomic<bool>       skip_idle_threads_flag;
+    detail::ThreadCPUClocks cpu_clocks;
+    std::atomic<bool>       gil_sampling_flag;
+
+    struct ContextVar {
+        py::object  var;
+        std::string name;
+    };
+    using TagKey = std::pair<std::size_t, PyObject *>;
+    struct CachedTag {
+        /**
+         * Referenced, so that identity of the value isn't reused.
+         */
+        py::object   value;
+        unsigned int id = 0;
+    };
+    static constexpr std::size_t tags_cache_capacity = 4096;
+    /**
+     * Context variables read as tags, guarded by the mutex.
+     */
+    std::vector<ContextVar> context_vars;
+    /**
+     * IDs of tags by indexes of variables and values, guarded by the mutex.
+     */
+    std::unordered_map<TagKey, CachedTag, boost::hash<TagKey>> tags_cache;
+
+    /**
+     * Sample kept by the flight recorder. Frames and tags of the sample are
+     * referred by their positions in the rings counted from the start of
+     * the recording.
+     */
+    struct RecordedSample {
+        std::chrono::steady_clock::time_point monotonic_clock_timestamp;
+        unsigned long long                    thread_id    = 0;
+        std::uint64_t                         first_frame  = 0;
+        std::uint32_t                         frames_count = 0;
+        std::uint32_t                         tags_count   = 0;
+        std::uint64_t                         first_tag    = 0;
+        std::chrono::nanoseconds              cpu_time{0};
+        std::chrono::nanoseconds              gil_wait{0};
+        std::chrono::nanoseconds              weight{0};
+        GILState                              gil_state = GILState::Unknown;
+    };
+    /**
+     * Frame kept by the flight recorder, its line is resolved when it is
+     * recorded.
+     */
+    struct RecordedFrame {
+        unsigned long long cookie       = 0;
+        std::uint32_t      code_id      = 0;
+        int                line_number  = 0;
+        bool               is_coroutine = false;
+        bool               is_generator = false;
+    };
+    struct RecordedStack {
+        std::uint64_t first_frame  = 0;
+        std::uint32_t frames_count = 0;
+    };
+
+    /**
+     * Rings of the flight recorder, the oldest samples are overwritten
+     * first. Guarded by the flight recorder's mutex as the rest of
+     * the recorder's state.
+     */
+    boost::circular_buffer<RecordedSample> recorded_samples;
+    boost::circular_buffer<RecordedFrame>  recorded_frames;
+    boost::circular_buffer<unsigned int>   recorded_tags;
+    /**
+     * Counts of frames and tags ever put into the rings.
+     */
+    std::uint64_t recorded_frames_count = 0;
+    std::uint64_t recorded_tags_count   = 0;
+    /**
+     * Codes of recorded frames by their IDs.
+     */
+    std::vector<std::shared_ptr<const detail::CodeInfo>> recorded_codes;
+    std::unordered_map<const detail::CodeInfo *, std::uint32_t>
+        recorded_code_ids;
+    /**
+     * Last recorded stacks of threads, unchanged stacks refer to them.
+     * Stacks which frames have been overwritten are pruned once the ring of
+     * frames is overwritten entirely.
+     */
+    std::unordered_map<unsigned long long, RecordedStack> recorded_stacks;
+    std::uint64_t     stacks_pruned_at_frame = 0;
+    std::mutex        flight_recorder_mutex;
+    std::atomic<bool> flight_recording_flag;
+
+    struct WatchedCall {
+        unsigned long long                    cookie = 0;
+        std::chrono::steady_clock::time_point since;
+        bool                                  is_triggered = false;
+        unsigned long long                    sample_count = 0;
+    };
+    /**
+     * Functions watched by the dump watchdog, guarded by the mutex.
+     */
+    std::vector<detail::CodeInfo>       watched_functions;
+    std::chrono::steady_clock::duration watchdog_threshold{0};
+    std::string                         watchdog_path;
+    std::chrono::steady_clock::duration watchdog_window{0};
+    /**
+     * Outermost calls of watched functions by thread IDs.
+     */
+    std::unordered_map<unsigned long long, WatchedCall> watched_calls;
+    std::unordered_map<
+        const detail::CodeInfo *,
+        std::pair<std::shared_ptr<const detail::CodeInfo>, bool>>
+                       is_watched_cache;
+    unsigned long long watchdog_sample_count = 0;
+    std::atomic<bool>  is_dump_requested;
+
+    /*! Used only by the collector thread. */
+    std::mt19937_64 schedule_random_generator;
+
+    /*! Buffers used only by the collector thread. */
+    std::vector<detail::ThreadSnapshot> thread_snapshots;
+    std::vector<detail::FrameSnapshot>  frame_snapshots;
 
     void register_own_thread();
 
@@ -135,6 +540,13 @@ private:
      */
     void collector();
 
+    /**
+     * Draw the interval until the next sample from the schedule.
+     *
+     * Should be called with the mutex held.
+     */
+    std::chrono::steady_clock::duration draw_sampling_interval();
+
     /**
      * Perform sampled raw profile data processing in an infinite loop.
      */
@@ -149,11 +561,120 @@ private:
 
     /**
      * Collect data from the interpreter.
+     *
+     * Threads are filtered before any work with their frames is done.
      */
-    static inline bool collect_frames(
+    inline bool collect_frames(
         std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
         std::vector<SamplingCollector::RawFrame> &frames);
 
+    /**
+     * Collect data from copies of the interpreter's structures without
+     * holding the GIL.
+     */
+    inline bool snapshot_frames(
+        detail::FrameSnapshotter &                snapshotter,
+        std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
+        std::vector<SamplingCollector::RawFrame> &frames);
+
+    /**
+     * Fingerprint the stack by identities of its frames and their last
+     * executed instructions, frames are not referenced.
+     */
+    static std::size_t fingerprint_stack(PyFrameObject *frame);
+    static std::size_t
+    fingerprint_stack(const std::vector<detail::FrameSnapshot> &frames);
+
+    /**
+     * Check if the stack of the thread is the same as in its previous sample
+     * and could be emitted as an unchanged trace.
+     */
+    inline bool is_stack_unchanged(
+        unsigned long long thread_id,
+        std::size_t        fingerprint);
+
+    /**
+     * Forget fingerprints of threads that weren't sampled this time.
+     */
+    void forget_stale_fingerprints();
+
+    /**
+     * Measure CPU time consumed by the thread since its previous sample.
+     *
+     * @param is_idle Set if the thread should be skipped as idle.
+     * @return False if the thread's CPU clock couldn't be read.
+     */
+    inline bool measure_cpu_time(
+        std::uint64_t             unique_id,
+        unsigned long long        thread_id,
+        std::chrono::nanoseconds &cpu_time,
+        bool &                    is_idle);
+
+    /**
+     * Read tags of the thread from its current context.
+     *
+     * Should be called with the GIL and the mutex held.
+     */
+    inline void
+    read_tags(PyThreadState *thread_state, std::vector<unsigned int> &tags);
+
+    /**
+     * Convert the value of a tag to a string without running Python code,
+     * so only exact strings, integers, floats and booleans are converted,
+     * other values are replaced by names of their types.
+     *
+     * Should be called with the GIL held.
+     */
+    static std::string format_tag_value(PyObject *value);
+
+    /**
+     * Handle the thread skipped as idle - if its stack is fingerprinted,
+     * emit an unchanged trace for it.
+     *
+     * @return False if the whole stack of the thread has to be collected
+     *         anyway.
+     */
+    inline bool skip_idle_thread(
+        std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
+        unsigned long long                        thread_id,
+        std::vector<SamplingCollector::RawFrame> &frames);
+
+    /**
+     * Check whether the copied thread state is still in the interpreter's
+     * list of threads.
+     *
+     * Should be called with the GIL held.
+     */
+    static bool is_thread_alive(const detail::ThreadSnapshot &thread);
+
+    /**
+     * Collect await-chains of asyncio tasks from the interpreter.
+     */
+    inline bool collect_task_frames(
+        std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
+        std::vector<SamplingCollector::RawFrame> &frames);
+
+    /**
+     * Put the collected frames into the flight recorder's ring buffer.
+     */
+    void record_frames(std::vector<SamplingCollector::RawFrame> &frames);
+    std::uint32_t intern_recorded_code(
+        const std::shared_ptr<const detail::CodeInfo> &code);
+
+    /**
+     * Track calls of watched functions in the collected frames and request
+     * a dump if any of them is too long.
+     */
+    void watch_calls(const std::vector<SamplingCollector::RawFrame> &frames);
+
+    bool is_watched(const std::shared_ptr<const detail::CodeInfo> &code);
+
+    /**
+     * Make traces of recorded samples of the last "window".
+     */
+    std::vector<std::shared_ptr<TraceSample>>
+    get_recorded_traces(std::chrono::steady_clock::duration window);
+
     /**
      * Factory function for gauge::Frame objects.
      */
@@ -161,13 +682,27 @@ private:
 
     /**
      * Factory function for gauge::Trace objects.
+     *
+     * @param base_measurements Mapping of the steady clock to
+     *        the system clock taken once for the whole batch of traces.
+     */
+    std::unique_ptr<TraceSample> construct_trace(
+        const std::vector<RawFrame *> &                  raw_frames,
+        const TimePointConversionUtil::BaseMeasurements &base_measurements);
+    /**
+     * Make a trace of the recorded sample, the sample's frames and tags
+     * must still be in the rings.
+     *
+     * Should be called with the flight recorder's mutex held.
      */
-    std::unique_ptr<TraceSample>
-    construct_trace(const std::vector<RawFrame *> &raw_frames);
+    std::unique_ptr<TraceSample> construct_trace(
+        const RecordedSample &                           sample,
+        const TimePointConversionUtil::BaseMeasurements &base_measurements);
 };
 } // namespace sampling_collector_impl
 
 using sampling_collector_impl::SamplingCollector;
+using sampling_collector_impl::SamplingSchedule;
 
 } // namespace gauge
 
@@ -11,6 +11,7 @@
 
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
@@ -18,8 +19,9 @@
 #include <spdlog/logger.h>
 
 #include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
 #include "gauge/collector.hpp"
-#include "gauge/utils/chrono.hpp"
+#include "gauge/utils/subscribers.hpp"
 
 namespace gauge {
 namespace span_aggregator_impl {
@@ -31,7 +33,15 @@ using namespace boost::multi_index;
 /**
  * Aggregates raw traces and turns them into spans.
  *
+ * Traces marked as unchanged extend open spans of the thread's last
+ * complete trace without matching them frame by frame.
  *
+ * Memory retained by open spans could be bounded by a budget, spans seen
+ * least recently are force-ended when it's exceeded.
+ *
+ * Consecutive calls of the same function from the same line of the same
+ * parent could be coalesced into a single span, so that loops don't
+ * produce a span per iteration.
  */
 class SpanAggregator {
 public:
@@ -39,10 +49,50 @@ public:
         std::chrono::steady_clock::duration span_ttl = 100ms);
     void subscribe(
         std::function<void(
-            std::shared_ptr<std::vector<std::shared_ptr<Span>>>)> callback);
-    void subscribe(py::object callback);
+            std::shared_ptr<std::vector<std::shared_ptr<Span>>>)> callback,
+        const DispatchOptions &options = DispatchOptions());
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions());
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats();
     void finish_open_spans();
 
+    /**
+     * Limit count of open spans and their estimated size in bytes, zero
+     * means no limit.
+     *
+     * When any of the limits is exceeded - the least recently seen open
+     * spans are ended together with their descendants, as if their threads
+     * have expired. Spans of the trace being processed are never evicted.
+     * Spans extended by unchanged traces count as seen.
+     */
+    void set_open_spans_budget(std::size_t max_count, std::size_t max_bytes);
+    std::size_t get_open_spans_count();
+    /**
+     * Get estimated size of open spans in bytes, including their strings
+     * and indexes.
+     */
+    std::size_t get_open_spans_bytes();
+    /**
+     * Get count of spans ended because of the budget.
+     */
+    unsigned long long get_evicted_spans_count();
+
+    /**
+     * Enable or disable coalescing of repeated sibling spans.
+     *
+     * When enabled a span that starts right after its open sibling with
+     * the same symbolic name, file name and line of the call in the parent
+     * continues the sibling instead of ending it. The resulting span carries
+     * count of the calls and their summed duration, its descendants are
+     * coalesced the same way.
+     */
+    void set_sibling_coalescing(bool enabled);
+    bool is_coalescing_siblings();
+
     /**
      * Process raw trace-samples.
      *
@@ -56,16 +106,10 @@ public:
                    &traces);
 
 private:
-    using TimePointConversionUtil = detail::TimePointConversionUtil<
-        std::chrono::steady_clock,
-        std::chrono::system_clock>;
-    std::mutex                                mutex;
-    std::shared_ptr<spdlog::logger>           logger;
-    TimePointConversionUtil::BaseMeasurements clocks_base_measurements;
-    std::forward_list<std::function<void(
-        std::shared_ptr<std::vector<std::shared_ptr<Span>>>)>>
-                                  callbacks;
-    std::forward_list<py::object> py_callbacks;
+    std::mutex                      mutex;
+    std::shared_ptr<spdlog::logger> logger;
+    detail::Subscribers<std::shared_ptr<std::vector<std::shared_ptr<Span>>>>
+        subscribers;
 
     boost::uuids::random_generator random_generator;
 
@@ -73,18 +117,79 @@ private:
     std::chrono::steady_clock::time_point offset;
     std::chrono::steady_clock::time_point finish_offsets;
 
+    struct ThreadState {
+        /**
+         * Generation of the thread's last complete trace.
+         */
+        unsigned long long                    generation = 0;
+        std::chrono::steady_clock::time_point monotonic_clock_timestamp;
+        std::chrono::system_clock::time_point timestamp;
+        /**
+         * Cookies of frames of the last complete trace, their spans are
+         * relocated in the recency index by unchanged traces.
+         */
+        std::vector<decltype(Frame::cookie)> cookies;
+        /**
+         * Generation of the complete trace before the last one and when it
+         * was last seen, spans ended by the last one were open until then.
+         */
+        unsigned long long previous_generation = 0;
+        std::pair<
+            std::chrono::steady_clock::time_point,
+            std::chrono::system_clock::time_point>
+            previous_last_seen;
+    };
+    using ThreadKey = std::pair<unsigned long long, unsigned long long>;
+    /**
+     * States of threads by process and thread IDs.
+     */
+    std::map<ThreadKey, ThreadState> thread_states;
+    unsigned long long               next_generation = 1;
+
     /* --- Spans indexing --- */
     // TODO: Need to evaluate idea of having spans indexed as stacks.
     struct OpenSpan {
         decltype(Frame::cookie) cookie;
         std::shared_ptr<Span>   span;
+        /**
+         * Generation of the trace the span was last seen in.
+         */
+        unsigned long long generation;
+        /**
+         * Estimated size of the entry in bytes.
+         */
+        std::size_t size;
+        /**
+         * Line of the parent's frame the span has been called from.
+         */
+        int call_line_number = 0;
+        /**
+         * Count of coalesced calls.
+         */
+        unsigned long long repetition_count = 1;
+        /**
+         * Summed duration of the coalesced calls except the current one.
+         */
+        std::chrono::nanoseconds summed_duration{0};
+        /**
+         * Time the current one of the coalesced calls has started.
+         */
+        std::chrono::steady_clock::time_point repetition_start;
 
         inline OpenSpan(
             decltype(Frame::cookie) cookie,
-            std::shared_ptr<Span>   span)
-            : cookie{cookie}, span{std::move(span)} {}
+            std::shared_ptr<Span>   span,
+            unsigned long long      generation       = 0,
+            int                     call_line_number = 0)
+            : cookie{cookie}, span{std::move(span)}, generation{generation},
+              size{get_size(*this->span)},
+              call_line_number{call_line_number},
+              repetition_start{this->span->monotonic_clock_timestamp} {}
+
+        static std::size_t get_size(const Span &span);
     };
 
+    struct by_recency {};
     struct by_cookie {};
     struct by_id {};
     struct by_parent_id {};
@@ -107,6 +212,8 @@ private:
     multi_index_container<
         OpenSpan,
         indexed_by<
+            // The least recently seen spans come first.
+            sequenced<tag<by_recency>>,
             hashed_unique<
                 tag<by_cookie>,
                 member<
@@ -116,15 +223,34 @@ private:
             hashed_unique<tag<by_id>, span_id_extractor>,
             hashed_non_unique<tag<by_parent_id>, span_parent_id_extractor>>>
         open_spans;
+
+    std::size_t        max_open_spans       = 0;
+    std::size_t        max_open_spans_bytes = 0;
+    std::size_t        open_spans_bytes     = 0;
+    unsigned long long evicted_spans_count  = 0;
+    bool               coalesce_siblings    = false;
+
     /**
      * Index new open span
      *
-     * Does not mutate the span in any way.
+     * Does not mutate the span, unless it's coalesced with its sibling -
+     * then it takes the sibling's ID and becomes an end-span.
      */
     void add_span(
         const std::shared_ptr<Span> &       span,
         const decltype(Frame::cookie) &     cookie,
-        std::vector<std::shared_ptr<Span>> &spans);
+        std::vector<std::shared_ptr<Span>> &spans,
+        unsigned long long                  generation       = 0,
+        int                                 call_line_number = 0);
+    /**
+     * Continue the open sibling-span by the span if they are repeated calls.
+     */
+    bool coalesce_span(
+        const OpenSpan &                sibling,
+        const std::shared_ptr<Span> &   span,
+        const decltype(Frame::cookie) & cookie,
+        unsigned long long              generation,
+        int                             call_line_number);
     /**
      * Remove indexed span.
      */
@@ -146,11 +272,28 @@ private:
         decltype(Span::monotonic_clock_timestamp) monotonic_clock_timestamp,
         decltype(Span::timestamp)                 timestamp);
 
+    /**
+     * Get when the span was last seen, unchanged traces could have seen it
+     * after the trace it comes from.
+     */
+    std::pair<
+        decltype(Span::monotonic_clock_timestamp),
+        decltype(Span::timestamp)>
+    get_last_seen(const OpenSpan &open_span) const;
+    /**
+     * Mark open spans of the thread's last complete trace as seen.
+     */
+    void touch_open_spans(const ThreadState &thread_state);
+    /**
+     * End the least recently seen spans while the budget is exceeded.
+     */
+    void evict_open_spans(
+        std::vector<std::shared_ptr<Span>> &spans,
+        unsigned long long                  generation);
     void process_open_spans(
         std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans,
         bool force_finish = false);
     std::unique_ptr<Span> to_end_span(const std::shared_ptr<Span> &span);
-    py::object            py_context;
     void                  sort_spans(
                          const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans);
     void execute_callbacks(
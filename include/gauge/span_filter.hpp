@@ -0,0 +1,185 @@
+#ifndef GAUGE_SPAN_FILTER_HPP
+#define GAUGE_SPAN_FILTER_HPP
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/glob.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace span_filter_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+
+/**
+ * Filters spans emitted by an aggregator before passing them further.
+ *
+ * Supports:
+ *
+ * - Stripping of topmost levels of the call-trees, per process/thread.
+ * - Allow and deny lists of glob patterns matched against file names and
+ *   against names of modules.
+ * - Dropping of spans shorter than the minimum duration.
+ *
+ * Children of dropped spans are re-attached to their closest kept
+ * ancestor or become topmost if there is no such ancestor.
+ *
+ * When the minimum duration is set - start-spans are held back until
+ * either they live long enough or their end-span is received.
+ */
+class SpanFilter {
+public:
+    explicit SpanFilter(
+        std::chrono::steady_clock::duration min_duration = 0us);
+
+    void subscribe(
+        std::function<void(
+            std::shared_ptr<std::vector<std::shared_ptr<Span>>>)> callback,
+        const DispatchOptions &options = DispatchOptions());
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions());
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats();
+
+    /**
+     * Strip "count" of topmost levels of call-trees.
+     *
+     * @param count Count of levels to strip, zero disables stripping.
+     * @param process_id PID of spans to strip, empty value is a wildcard.
+     * @param thread_id Thread ID of spans to strip, empty value is
+     *                  a wildcard.
+     */
+    void strip_levels(
+        unsigned int                        count,
+        boost::optional<unsigned long long> process_id = boost::none,
+        boost::optional<unsigned long long> thread_id  = boost::none);
+
+    /**
+     * Keep only spans with file names matching any of the patterns.
+     *
+     * Empty list disables the filtering.
+     */
+    void set_allowed_files(const std::vector<std::string> &patterns);
+
+    /**
+     * Drop spans with file names matching any of the patterns.
+     */
+    void set_denied_files(const std::vector<std::string> &patterns);
+
+    /**
+     * Set directories that modules are imported from, usually "sys.path".
+     *
+     * Names of modules are derived from file names relative to the longest
+     * matching root, e.g. "/usr/lib/python3.8/json/decoder.py" becomes
+     * "json.decoder" and "pkg/__init__.py" becomes "pkg".
+     */
+    void set_module_roots(const std::vector<std::string> &roots);
+
+    /**
+     * Keep only spans with names of modules matching any of the patterns.
+     *
+     * Empty list disables the filtering.
+     */
+    void set_allowed_modules(const std::vector<std::string> &patterns);
+
+    /**
+     * Drop spans with names of modules matching any of the patterns.
+     */
+    void set_denied_modules(const std::vector<std::string> &patterns);
+
+    void set_min_duration(std::chrono::steady_clock::duration duration);
+    std::chrono::steady_clock::duration get_min_duration();
+
+    /**
+     * Filter the spans and pass the kept ones to the subscribers.
+     */
+    void operator()(
+        const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans);
+
+private:
+    using StripKey = std::tuple<
+        boost::optional<unsigned long long>,
+        boost::optional<unsigned long long>>;
+
+    struct SpanState {
+        std::shared_ptr<Span> start_span;
+        std::string           parent_id;
+        bool                  is_top      = false;
+        unsigned int          depth       = 0;
+        bool                  is_dropped  = false;
+        bool                  is_released = false;
+    };
+
+    std::mutex                      mutex;
+    std::shared_ptr<spdlog::logger> logger;
+    detail::Subscribers<std::shared_ptr<std::vector<std::shared_ptr<Span>>>>
+        subscribers;
+
+    std::chrono::steady_clock::duration   min_duration;
+    std::map<StripKey, unsigned int>      strip_levels_by_key;
+    detail::GlobSet                       allowed_files;
+    detail::GlobSet                       denied_files;
+    detail::GlobSet                       allowed_modules;
+    detail::GlobSet                       denied_modules;
+    std::unordered_map<std::string, bool> is_file_allowed_cache;
+    /**
+     * Longest roots go first.
+     */
+    std::vector<std::string> module_roots;
+
+    /**
+     * Spans that are started but not yet ended.
+     */
+    std::unordered_map<std::string, SpanState> states;
+    /**
+     * IDs of start-spans held back until they reach the minimum duration.
+     */
+    std::deque<std::string> held_span_ids;
+
+    /**
+     * Check the file name and the name of its module against the lists.
+     */
+    bool        is_file_allowed(const std::string &file_name);
+    std::string get_module_name(const std::string &file_name) const;
+    bool should_strip(const Span &span, unsigned int depth) const;
+    /**
+     * Make a copy of the span with its parent replaced by the closest
+     * kept ancestor.
+     */
+    static std::shared_ptr<Span>
+    reparent(const std::shared_ptr<Span> &span, const SpanState &state);
+    void release_held_spans(
+        std::chrono::steady_clock::time_point now,
+        std::vector<std::shared_ptr<Span>> &  spans);
+    void process_start_span(
+        const std::shared_ptr<Span> &       span,
+        std::vector<std::shared_ptr<Span>> &spans);
+    void process_end_span(
+        const std::shared_ptr<Span> &       span,
+        std::vector<std::shared_ptr<Span>> &spans);
+};
+} // namespace span_filter_impl
+
+using span_filter_impl::SpanFilter;
+
+} // namespace gauge
+
+#endif // GAUGE_SPAN_FILTER_HPP
@@ -0,0 +1,141 @@
+#ifndef GAUGE_SPAN_REGISTRY_HPP
+#define GAUGE_SPAN_REGISTRY_HPP
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/utils/ttl_map.hpp"
+
+namespace gauge {
+namespace span_registry_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+
+/**
+ * Bookkeeping of spans exported to a tracer.
+ *
+ * Started spans are kept by their IDs together with everything that
+ * exporting of their descendants needs - parents, depths and whether
+ * they are stripped are resolved once when spans start. A batch of spans
+ * is turned into the list of entries that have to be started or finished
+ * by the tracer, so that the exporter only makes the tracer calls.
+ *
+ * Each thread of each process is given its own execution context created
+ * by the factory, contexts of threads not seen for longer than the TTL
+ * are forgotten.
+ *
+ * Should be used with the GIL held, which guards it. The factory and
+ * finalizers of expired contexts could release the GIL, so they are
+ * called when the registry is consistent.
+ */
+class SpanRegistry {
+public:
+    struct Entry {
+        /**
+         * Start-span.
+         */
+        std::shared_ptr<Span> span;
+        /**
+         * Null for topmost spans.
+         */
+        std::shared_ptr<Entry> parent;
+        /**
+         * Count of levels from the top, topmost spans are on the first one.
+         */
+        unsigned int depth       = 1;
+        bool         is_stripped = false;
+        /**
+         * All of the ancestors are stripped, so the span appears topmost.
+         */
+        bool is_top = false;
+        /**
+         * Span of the tracer, set by the exporter.
+         */
+        py::object tracer_span = py::none();
+        /**
+         * Execution context of the span's thread.
+         */
+        py::object context = py::none();
+    };
+    /**
+     * Spans to export paired with their entries.
+     */
+    using ExportedSpans =
+        std::vector<std::pair<std::shared_ptr<Span>, std::shared_ptr<Entry>>>;
+
+    explicit SpanRegistry(
+        py::object                          context_factory,
+        std::chrono::steady_clock::duration context_ttl = 30s);
+
+    /**
+     * Strip "count" of topmost levels of call-trees.
+     *
+     * @param count Count of levels to strip, zero disables stripping.
+     * @param process_id PID of spans to strip, empty value is a wildcard.
+     * @param thread_id Thread ID of spans to strip, empty value is
+     *                  a wildcard.
+     */
+    void strip_levels(
+        unsigned int                        count,
+        boost::optional<unsigned long long> process_id = boost::none,
+        boost::optional<unsigned long long> thread_id  = boost::none);
+
+    std::size_t get_spans_count();
+    std::size_t get_contexts_count();
+
+    /**
+     * Register the spans.
+     *
+     * @return Not stripped spans with their entries in the order they have
+     *         to be exported.
+     */
+    ExportedSpans operator()(const std::vector<std::shared_ptr<Span>> &spans);
+
+private:
+    using StripKey = std::tuple<
+        boost::optional<unsigned long long>,
+        boost::optional<unsigned long long>>;
+    using ThreadKey = std::pair<unsigned long long, unsigned long long>;
+    using Contexts =
+        detail::TTLMap<ThreadKey, py::object, boost::hash<ThreadKey>>;
+
+    std::shared_ptr<spdlog::logger> logger;
+    py::object                      context_factory;
+
+    std::map<StripKey, unsigned int> strip_levels_by_key;
+    /**
+     * Entries of started spans by their IDs.
+     */
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+    /**
+     * Execution contexts by process and thread IDs.
+     */
+    Contexts contexts;
+
+    bool should_strip(const Span &span, unsigned int depth) const;
+    py::object
+    get_context(const Span &span, std::chrono::steady_clock::time_point now);
+    std::shared_ptr<Entry> start_span(
+        const std::shared_ptr<Span> &         span,
+        std::chrono::steady_clock::time_point now);
+    std::shared_ptr<Entry> end_span(const std::shared_ptr<Span> &span);
+};
+} // namespace span_registry_impl
+
+using span_registry_impl::SpanRegistry;
+
+} // namespace gauge
+
+#endif // GAUGE_SPAN_REGISTRY_HPP
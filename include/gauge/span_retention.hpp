@@ -0,0 +1,151 @@
+#ifndef GAUGE_SPAN_RETENTION_HPP
+#define GAUGE_SPAN_RETENTION_HPP
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace span_retention_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+
+/**
+ * Keeps or drops whole call-trees depending on their top-level spans.
+ *
+ * Spans of each tree are held back until the top-level span ends, then
+ * the whole tree is passed further if the top-level span has lasted at
+ * least the minimum duration or if it's picked at random with
+ * the sample rate, otherwise the tree is dropped.
+ *
+ * Count of held spans is bounded per thread. When a thread exceeds
+ * the bound - its oldest tree is let through right away if it has
+ * already lasted the minimum duration, otherwise it's dropped.
+ *
+ * Spans that don't belong to any known tree are passed as they are.
+ */
+class SpanRetention {
+public:
+    /**
+     * @param min_duration Minimum duration of top-level spans of kept
+     *                     trees.
+     * @param sample_rate Probability of keeping a tree that is shorter
+     *                    than the minimum duration.
+     * @param max_held_spans Maximum count of held spans per thread.
+     */
+    explicit SpanRetention(
+        std::chrono::steady_clock::duration min_duration   = 100ms,
+        double                              sample_rate    = 0.0,
+        std::size_t                         max_held_spans = 10000);
+
+    void subscribe(
+        std::function<void(
+            std::shared_ptr<std::vector<std::shared_ptr<Span>>>)> callback,
+        const DispatchOptions &options = DispatchOptions());
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions());
+    /**
+     * Get metrics of the callbacks subscribed with their own queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats();
+
+    void set_min_duration(std::chrono::steady_clock::duration duration);
+    std::chrono::steady_clock::duration get_min_duration();
+    void                                set_sample_rate(double rate);
+    double                              get_sample_rate();
+
+    /**
+     * Count of trees passed further.
+     */
+    unsigned long long get_kept_trees_count();
+    /**
+     * Count of dropped trees, including the ones dropped due to the bound
+     * of held spans.
+     */
+    unsigned long long get_dropped_trees_count();
+
+    /**
+     * Hold the spans and pass the kept trees to the subscribers.
+     */
+    void operator()(
+        const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans);
+
+private:
+    using ThreadKey = std::pair<unsigned long long, unsigned long long>;
+
+    struct Tree {
+        enum State { Held, Kept, Dropped };
+        State                                 state = Held;
+        std::string                           top_id;
+        std::chrono::steady_clock::time_point start;
+        ThreadKey                             thread_key;
+        std::vector<std::shared_ptr<Span>>    spans;
+        /**
+         * Position in the thread's list of held trees.
+         */
+        std::list<std::shared_ptr<Tree>>::iterator position;
+    };
+
+    struct ThreadTrees {
+        /**
+         * Held trees, the oldest first.
+         */
+        std::list<std::shared_ptr<Tree>> trees;
+        std::size_t                      held_spans_count = 0;
+    };
+
+    std::mutex                      mutex;
+    std::shared_ptr<spdlog::logger> logger;
+    detail::Subscribers<std::shared_ptr<std::vector<std::shared_ptr<Span>>>>
+        subscribers;
+
+    std::chrono::steady_clock::duration min_duration;
+    double                              sample_rate;
+    std::size_t                         max_held_spans;
+    std::mt19937_64                     random_generator;
+    unsigned long long                  kept_trees_count    = 0;
+    unsigned long long                  dropped_trees_count = 0;
+
+    /**
+     * Trees of spans that are started but not yet ended.
+     */
+    std::unordered_map<std::string, std::shared_ptr<Tree>> trees;
+    std::map<ThreadKey, ThreadTrees>                       thread_trees;
+
+    void add_span(
+        Tree &                              tree,
+        const std::shared_ptr<Span> &       span,
+        std::vector<std::shared_ptr<Span>> &spans);
+    /**
+     * Decide on the held tree and stop holding it.
+     */
+    void release_tree(
+        Tree &                              tree,
+        bool                                is_kept,
+        std::vector<std::shared_ptr<Span>> &spans);
+    bool should_keep(std::chrono::steady_clock::duration duration);
+};
+} // namespace span_retention_impl
+
+using span_retention_impl::SpanRetention;
+
+} // namespace gauge
+
+#endif // GAUGE_SPAN_RETENTION_HPP
@@ -0,0 +1,100 @@
+#ifndef GAUGE_THREAD_FILTER_HPP
+#define GAUGE_THREAD_FILTER_HPP
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Python.h>
+
+#include "gauge/utils/glob.hpp"
+
+namespace gauge {
+namespace thread_filter_impl {
+
+/**
+ * Decides which threads should be sampled.
+ *
+ * Thread is sampled when:
+ *
+ * - It is not excluded by its ID or by its name.
+ * - It is included by its ID or by its name, or no inclusions are set.
+ * - It is marked as active, if sampling only of active threads is
+ *   enabled.
+ *
+ * The decisions are taken before any work with thread's frames is done.
+ */
+class ThreadFilter {
+public:
+    ThreadFilter() = default;
+
+    void set_included_ids(const std::vector<unsigned long long> &ids);
+    void set_excluded_ids(const std::vector<unsigned long long> &ids);
+    /**
+     * Set glob patterns of names (as in threading.Thread.name) of threads
+     * that should be included.
+     */
+    void set_included_names(const std::vector<std::string> &patterns);
+    /**
+     * Set glob patterns of names of threads that should be excluded.
+     */
+    void set_excluded_names(const std::vector<std::string> &patterns);
+
+    /**
+     * Sample only threads marked as active with mark_active().
+     */
+    void set_only_active(bool only_active);
+    bool is_only_active();
+    /**
+     * Mark the thread as active (for example - handling a request).
+     */
+    void mark_active(unsigned long long thread_id);
+    void mark_inactive(unsigned long long thread_id);
+
+    /**
+     * Check whether the thread should be sampled.
+     *
+     * The thread state could be a copy. The GIL is taken to resolve names
+     * of threads that haven't been seen recently or haven't got names.
+     */
+    bool is_sampled(PyThreadState *thread_state);
+
+private:
+    struct NameMatch {
+        bool                                  is_included = false;
+        bool                                  is_excluded = false;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+    /*! Renamed threads are matched by their new names after this. */
+    static constexpr std::chrono::seconds name_match_ttl{1};
+
+    std::mutex                             mutex;
+    std::unordered_set<unsigned long long> included_ids;
+    std::unordered_set<unsigned long long> excluded_ids;
+    std::unordered_set<unsigned long long> active_ids;
+    detail::GlobSet                        included_names;
+    detail::GlobSet                        excluded_names;
+    bool                                   only_active = false;
+    /**
+     * Results of matching thread names by unique thread state IDs, so that
+     * thread names are resolved once per TTL. Threads unknown to
+     * the threading module aren't cached, since they could be registered
+     * right after.
+     */
+    std::unordered_map<std::uint64_t, NameMatch> name_matches;
+
+    NameMatch match_name(
+        PyThreadState *               thread_state,
+        std::unique_lock<std::mutex> &lock);
+};
+
+} // namespace thread_filter_impl
+
+using thread_filter_impl::ThreadFilter;
+
+} // namespace gauge
+
+#endif // GAUGE_THREAD_FILTER_HPP
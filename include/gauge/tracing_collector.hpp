@@ -0,0 +1,229 @@
+#ifndef GAUGE_TRACING_COLLECTOR_HPP
+#define GAUGE_TRACING_COLLECTOR_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Python.h>
+#include <frameobject.h>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+
+#include "gauge/base.hpp"
+#include "gauge/collector.hpp"
+#include "gauge/utils/chrono.hpp"
+#include "gauge/utils/frame_snapshot.hpp"
+#include "gauge/utils/spsc_ring.hpp"
+#include "gauge/utils/subscribers.hpp"
+
+namespace gauge {
+namespace tracing_collector_impl {
+
+namespace py = pybind11;
+using namespace std::literals::chrono_literals;
+using namespace gauge;
+
+/**
+ * Records exact calls and returns of selected functions.
+ *
+ * Calls are hooked with a profile function installed in all threads of
+ * the interpreter, only code objects from the allow-list are recorded.
+ * Events are written into per-thread lock-free rings and are turned into
+ * traces by a separate thread, which means that the traced threads
+ * never wait for the rest of the pipeline.
+ *
+ * A trace of the thread's traced frames is emitted at each call and
+ * return, each call gets its own unique cookie. Together with unchanged
+ * traces emitted for threads staying inside of traced functions, this
+ * makes SpanAggregator produce spans with exact start and end times.
+ *
+ * Each resumption of a generator or a coroutine is traced as a separate
+ * call.
+ */
+class TracingCollector : public CollectorInterface {
+public:
+    static const CollectionMethod collection_method =
+        CollectionMethod::Tracing;
+
+    explicit TracingCollector(
+        std::chrono::steady_clock::duration processing_interval = 100ms);
+
+    TracingCollector(const TracingCollector &collector)     = delete;
+    TracingCollector(TracingCollector &&collector) noexcept = delete;
+    TracingCollector &operator=(const TracingCollector &collector) = delete;
+    TracingCollector &operator=(TracingCollector &&collector) = delete;
+    ~TracingCollector() override;
+
+    void subscribe(
+        CallbackInterface &    callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    void subscribe(
+        py::object             callback,
+        const DispatchOptions &options = DispatchOptions()) override;
+    std::vector<DispatchStats> get_dispatch_stats() const override;
+    /**
+     * Should be called with the GIL held.
+     */
+    void start() override;
+    void resume() override;
+    bool is_paused() override;
+    void pause() override;
+    /**
+     * Should be called with the GIL held.
+     */
+    void stop() override;
+    bool is_stopped() const override;
+
+    /**
+     * Set functions (or code objects) which calls should be recorded.
+     *
+     * Should be called with the GIL held.
+     */
+    void set_traced_functions(const std::vector<py::object> &functions);
+
+    /**
+     * Get count of events dropped because of full buffers.
+     */
+    unsigned long long get_dropped_events_count() const;
+
+private:
+    using TimePointConversionUtil = detail::TimePointConversionUtil<
+        std::chrono::steady_clock,
+        std::chrono::system_clock>;
+
+    struct Event {
+        enum Kind : std::uint8_t { Call, Return };
+        Kind                    kind   = Call;
+        const detail::CodeInfo *code   = nullptr;
+        unsigned long long      cookie = 0;
+        /**
+         * Count of traced frames in the thread's stack including
+         * the event's frame.
+         */
+        std::size_t                           depth = 0;
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    struct CallRecord {
+        PyFrameObject *    frame  = nullptr;
+        unsigned long long cookie = 0;
+    };
+
+    struct ThreadBuffer {
+        static constexpr std::size_t capacity = 1024;
+
+        explicit ThreadBuffer(unsigned long long thread_id)
+            : thread_id{thread_id} {}
+
+        unsigned long long thread_id;
+        /**
+         * Session of the collector the traced thread has last seen, used
+         * only by the traced thread.
+         */
+        unsigned long long session = 0;
+        /**
+         * Events passed from the traced thread to the processor thread.
+         */
+        detail::SPSCRing<Event, capacity> events;
+        /**
+         * Traced frames of the thread, used only by the traced thread.
+         */
+        std::vector<CallRecord> stack;
+        /**
+         * Traced frames of the thread as seen by the processor thread.
+         */
+        std::vector<std::pair<const detail::CodeInfo *, unsigned long long>>
+            processed_stack;
+    };
+
+    /**
+     * Unique ID of the collector, distinguishes collectors in per-thread
+     * caches even if one is allocated in place of another.
+     */
+    const std::uint64_t instance_id;
+
+    std::shared_ptr<spdlog::logger> logger;
+    /**
+     * Mapping of the steady clock to the system clock of the batch being
+     * processed, used only by the processor thread.
+     */
+    TimePointConversionUtil::BaseMeasurements clocks_base_measurements;
+    std::chrono::steady_clock::duration       processing_interval;
+    std::atomic<bool>                         is_stopped_flag;
+    std::atomic<bool>                         is_paused_flag;
+    std::atomic<unsigned long long>           next_cookie;
+    /**
+     * Incremented at each start, stacks of threads recorded during
+     * previous sessions are discarded.
+     */
+    std::atomic<unsigned long long> session;
+    std::atomic<unsigned long long>           dropped_events_count;
+    std::thread                               processor_thread;
+    std::string                               hostname;
+    unsigned long long                        process_id;
+    /**
+     * Mutex for guarding subscribing.
+     */
+    std::mutex mutex;
+    detail::Subscribers<
+        std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>>>
+        subscribers;
+
+    /**
+     * Traced code objects, guarded by the GIL.
+     */
+    std::vector<py::object> traced_code_objects;
+    std::unordered_map<PyCodeObject *, const detail::CodeInfo *> traced_codes;
+    /**
+     * Decoded information of all ever traced code objects, it is never
+     * released before the collector, since events could refer to it.
+     */
+    std::deque<detail::CodeInfo> code_infos;
+    /**
+     * Profile function's argument.
+     */
+    py::object profile_object;
+
+    std::mutex                                 buffers_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    static int profile(
+        PyObject *     object,
+        PyFrameObject *frame,
+        int            what,
+        PyObject *     arg);
+    /**
+     * Install the profile function into the thread.
+     *
+     * Should be called with the GIL held.
+     */
+    void install(PyThreadState *thread_state);
+    void uninstall(PyThreadState *thread_state);
+    ThreadBuffer &get_thread_buffer();
+    void          record(ThreadBuffer &buffer, const Event &event);
+
+    /**
+     * Turn recorded events into traces in an infinite loop.
+     */
+    void processor();
+    void process_events();
+    std::shared_ptr<TraceSample> construct_trace(
+        const ThreadBuffer &                  buffer,
+        std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+        bool                                  is_unchanged = false);
+};
+} // namespace tracing_collector_impl
+
+using tracing_collector_impl::TracingCollector;
+
+} // namespace gauge
+
+#endif // GAUGE_TRACING_COLLECTOR_HPP
@@ -0,0 +1,463 @@
+#include <cmath>
+#include <fstream>
+
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/process/environment.hpp>
+#include <spdlog/spdlog.h>
+
+#include "gauge/allocation_collector.hpp"
+#include "gauge/utils/clock.hpp"
+#include "gauge/utils/gil.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Join frames from the topmost one to the bottommost one, same as
+ * SamplingCollector::dump() does.
+ */
+std::string collapse_stack(const TraceSample &trace) {
+    std::string stack;
+    for (auto it = trace.frames->rbegin(); it != trace.frames->rend(); it++) {
+        if (!stack.empty()) {
+            stack += ';';
+        }
+        stack += fmt::format(
+            "{} ({}:{})",
+            (*it)->symbolic_name,
+            (*it)->file_name,
+            (*it)->line_number);
+    }
+    return stack;
+}
+} // namespace
+
+AllocationCollector::AllocationCollector(
+    std::size_t                         sampling_rate,
+    std::chrono::steady_clock::duration processing_interval)
+    : logger{detail::get_logger()}, sampling_rate{sampling_rate},
+      processing_interval{processing_interval}, is_stopped_flag{true},
+      is_paused_flag{false}, hostname{boost::asio::ip::host_name()},
+      process_id{static_cast<unsigned long long>(
+          boost::this_process::get_id())},
+      mem_hook{std::make_unique<Hook>()},
+      object_hook{std::make_unique<Hook>()},
+      random_generator{std::random_device()()} {
+    if (sampling_rate == 0) {
+        throw CollectorError();
+    }
+    sample_distance = std::exponential_distribution<double>(
+        1.0 / static_cast<double>(sampling_rate));
+}
+
+AllocationCollector::~AllocationCollector() {
+    if (is_stopped_flag) {
+        return;
+    }
+    detail::GILGuard gil_guard;
+    for (const auto &item :
+         {std::make_pair(PYMEM_DOMAIN_OBJ, &object_hook),
+          std::make_pair(PYMEM_DOMAIN_MEM, &mem_hook)}) {
+        auto &hook = *item.second;
+        if (is_wrapped(item.first, *hook)) {
+            // The wrapper keeps calling the hook, it's left forwarding
+            // calls to the original allocator.
+            hook->self = nullptr;
+            hook.release();
+        } else {
+            uninstall(item.first, *hook);
+        }
+    }
+    stop_processing();
+}
+
+void AllocationCollector::subscribe(
+    CallbackInterface &    callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(callback, options);
+}
+
+void AllocationCollector::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> AllocationCollector::get_dispatch_stats() const {
+    return subscribers.get_dispatch_stats();
+}
+
+void AllocationCollector::start() {
+    SPDLOG_LOGGER_DEBUG(logger, "Starting allocation collector...");
+    if (!is_stopped_flag) {
+        throw CollectorHasAlreadyStarted();
+    }
+    bytes_until_sample =
+        static_cast<std::int64_t>(sample_distance(random_generator)) + 1;
+    is_stopped_flag = false;
+    install(PYMEM_DOMAIN_MEM, *mem_hook);
+    install(PYMEM_DOMAIN_OBJ, *object_hook);
+    processor_thread = std::thread([this] { this->processor(); });
+    SPDLOG_LOGGER_DEBUG(logger, "Started allocation collector.");
+}
+
+void AllocationCollector::stop() {
+    SPDLOG_LOGGER_DEBUG(logger, "Stopping allocation collector...");
+    if (is_stopped_flag) {
+        return;
+    }
+    if (is_wrapped(PYMEM_DOMAIN_OBJ, *object_hook) ||
+        is_wrapped(PYMEM_DOMAIN_MEM, *mem_hook)) {
+        // Wrappers installed later, e.g. by tracemalloc, keep calling
+        // the collector's hooks.
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Allocator has been wrapped after the allocation collector, "
+            "it must be unwrapped first.");
+        throw CollectorError();
+    }
+    uninstall(PYMEM_DOMAIN_OBJ, *object_hook);
+    uninstall(PYMEM_DOMAIN_MEM, *mem_hook);
+    stop_processing();
+    SPDLOG_LOGGER_DEBUG(logger, "Stopped allocation collector.");
+}
+
+void AllocationCollector::stop_processing() {
+    is_stopped_flag = true;
+    if (processor_thread.joinable()) {
+        py::gil_scoped_release release;
+        processor_thread.join();
+        subscribers.flush();
+    }
+    live_allocations.clear();
+    rebuild_live_filter();
+}
+
+bool AllocationCollector::is_stopped() const { return is_stopped_flag; }
+
+void AllocationCollector::resume() {
+    if (is_stopped()) {
+        throw CollectorIsStopped();
+    }
+    if (!is_paused_flag) {
+        throw CollectorIsNotPaused();
+    }
+    is_paused_flag = false;
+}
+
+bool AllocationCollector::is_paused() { return is_paused_flag; }
+
+void AllocationCollector::pause() {
+    if (is_paused_flag) {
+        throw CollectorIsAlreadyPaused();
+    }
+    is_paused_flag = true;
+}
+
+std::size_t AllocationCollector::get_sampling_rate() const {
+    return sampling_rate;
+}
+
+std::size_t AllocationCollector::dump(const std::string &path, bool live) {
+    std::size_t   count = 0;
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        for (const auto &item : profiles) {
+            const auto bytes =
+                live ? item.second.live_bytes : item.second.allocated_bytes;
+            if (bytes == 0) {
+                continue;
+            }
+            file << item.first << ' ' << bytes << '\n';
+            count++;
+        }
+    }
+    file.close();
+    if (file.fail()) {
+        throw CollectorError();
+    }
+    SPDLOG_LOGGER_INFO(
+        logger,
+        "Dumped {} stacks of {} memory to \"{}\".",
+        count,
+        live ? "live" : "allocated",
+        path);
+    return count;
+}
+
+std::size_t AllocationCollector::get_live_samples_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return live_samples.size();
+}
+
+void *AllocationCollector::malloc_hook(void *context, std::size_t size) {
+    auto &hook    = *static_cast<Hook *>(context);
+    auto *pointer = hook.original.malloc(hook.original.ctx, size);
+    if (pointer != nullptr && hook.self != nullptr) {
+        hook.self->on_allocation(pointer, size);
+    }
+    return pointer;
+}
+
+void *AllocationCollector::calloc_hook(
+    void *      context,
+    std::size_t count,
+    std::size_t size) {
+    auto &hook    = *static_cast<Hook *>(context);
+    auto *pointer = hook.original.calloc(hook.original.ctx, count, size);
+    if (pointer != nullptr && hook.self != nullptr) {
+        hook.self->on_allocation(pointer, count * size);
+    }
+    return pointer;
+}
+
+void *AllocationCollector::realloc_hook(
+    void *      context,
+    void *      pointer,
+    std::size_t size) {
+    auto &hook = *static_cast<Hook *>(context);
+    auto *new_pointer =
+        hook.original.realloc(hook.original.ctx, pointer, size);
+    if (new_pointer != nullptr && hook.self != nullptr) {
+        if (pointer != nullptr) {
+            hook.self->on_release(pointer);
+        }
+        hook.self->on_allocation(new_pointer, size);
+    }
+    return new_pointer;
+}
+
+void AllocationCollector::free_hook(void *context, void *pointer) {
+    auto &hook = *static_cast<Hook *>(context);
+    if (pointer != nullptr && hook.self != nullptr) {
+        hook.self->on_release(pointer);
+    }
+    hook.original.free(hook.original.ctx, pointer);
+}
+
+void AllocationCollector::install(PyMemAllocatorDomain domain, Hook &hook) {
+    hook.self = this;
+    PyMem_GetAllocator(domain, &hook.original);
+    PyMemAllocatorEx allocator{
+        &hook,
+        &AllocationCollector::malloc_hook,
+        &AllocationCollector::calloc_hook,
+        &AllocationCollector::realloc_hook,
+        &AllocationCollector::free_hook};
+    PyMem_SetAllocator(domain, &allocator);
+}
+
+void AllocationCollector::uninstall(PyMemAllocatorDomain domain, Hook &hook) {
+    PyMem_SetAllocator(domain, &hook.original);
+}
+
+bool AllocationCollector::is_wrapped(
+    PyMemAllocatorDomain domain,
+    const Hook &         hook) {
+    PyMemAllocatorEx allocator{};
+    PyMem_GetAllocator(domain, &allocator);
+    return allocator.ctx != &hook;
+}
+
+void AllocationCollector::on_allocation(void *pointer, std::size_t size) {
+    bytes_until_sample -= static_cast<std::int64_t>(size);
+    if (bytes_until_sample > 0) {
+        return;
+    }
+    sample(pointer, size);
+}
+
+void AllocationCollector::on_release(void *pointer) {
+    const auto bit = get_live_filter_bit(pointer);
+    if ((live_filter[bit / 64] & (std::uint64_t{1} << (bit % 64))) == 0) {
+        return;
+    }
+    auto it = live_allocations.find(pointer);
+    if (it == live_allocations.end()) {
+        return;
+    }
+    released_sample_ids.push_back(it->second);
+    live_allocations.erase(it);
+    live_filter_released++;
+    if (live_filter_released > live_allocations.size()) {
+        rebuild_live_filter();
+    }
+}
+
+std::size_t AllocationCollector::get_live_filter_bit(const void *pointer) {
+    // Addresses are aligned, so the lowest bits are dropped before they
+    // are spread by a multiplicative hash.
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto address = reinterpret_cast<std::uintptr_t>(pointer) >> 4U;
+    return static_cast<std::size_t>(
+        (static_cast<std::uint64_t>(address) * 0x9E3779B97F4A7C15ULL) >>
+        48U);
+}
+
+void AllocationCollector::rebuild_live_filter() {
+    live_filter.fill(0);
+    for (const auto &item : live_allocations) {
+        const auto bit = get_live_filter_bit(item.first);
+        live_filter[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    }
+    live_filter_released = 0;
+}
+
+void AllocationCollector::sample(void *pointer, std::size_t size) {
+    bytes_until_sample =
+        static_cast<std::int64_t>(sample_distance(random_generator)) + 1;
+    if (is_paused_flag) {
+        return;
+    }
+    // The allocator is called with the GIL held, so it's the current
+    // thread's state.
+    auto *thread_state = _PyThreadState_UncheckedGet();
+    if (thread_state == nullptr || thread_state->frame == nullptr) {
+        return;
+    }
+    Sample sample;
+    sample.id        = next_sample_id++;
+    sample.thread_id = thread_state->thread_id;
+    sample.timestamp = detail::get_fast_clock().now();
+    // An allocation is sampled with probability 1 - exp(-size / rate),
+    // the size is scaled back by it. Sizes are never zero here since
+    // the distance to the next sample is at least a byte.
+    const auto probability = -std::expm1(
+        -static_cast<double>(size) / static_cast<double>(sampling_rate));
+    sample.estimated_bytes = static_cast<unsigned long long>(
+        std::llround(static_cast<double>(size) / probability));
+    // Only references are taken here - allocating Python objects from
+    // inside of the allocator isn't safe.
+    for (auto frame = thread_state->frame;
+         frame != nullptr && sample.frames.size() < max_depth;
+         frame = frame->f_back) {
+        Py_INCREF(frame->f_code);
+        sample.frames.push_back(RawFrame{
+            frame->f_code,
+            frame->f_lasti,
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            reinterpret_cast<std::uintptr_t>(frame)});
+    }
+    live_allocations[pointer] = sample.id;
+    const auto bit            = get_live_filter_bit(pointer);
+    live_filter[bit / 64] |= std::uint64_t{1} << (bit % 64);
+    pending_samples.push_back(std::move(sample));
+}
+
+void AllocationCollector::release(std::vector<Sample> &samples) {
+    for (auto &sample : samples) {
+        for (auto &frame : sample.frames) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            Py_DECREF(reinterpret_cast<PyObject *>(frame.code));
+        }
+        sample.frames.clear();
+    }
+}
+
+void AllocationCollector::processor() {
+    SPDLOG_LOGGER_DEBUG(logger, "Launching processing of allocations...");
+    static constexpr auto sleep_interval = std::chrono::milliseconds(1);
+    try {
+        auto previous_timestamp = std::chrono::steady_clock::now();
+        while (!is_stopped_flag) {
+            std::this_thread::sleep_for(sleep_interval);
+            detail::calibrate_clocks();
+            auto current_timestamp = std::chrono::steady_clock::now();
+            if ((current_timestamp - previous_timestamp) <
+                processing_interval) {
+                continue;
+            }
+            previous_timestamp = current_timestamp;
+            process_samples();
+        }
+        process_samples();
+    } catch (const std::exception &e) {
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Processing of allocations has stopped due to the exception: "
+            "\"{}\".",
+            e.what());
+        return;
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Processing of allocations has stopped.");
+}
+
+void AllocationCollector::process_samples() {
+    // All of the traces of the batch are converted the same way.
+    const auto base_measurements = detail::get_system_clock_mapping().get();
+    std::vector<Sample>             samples;
+    std::vector<unsigned long long> released_ids;
+    auto                            traces =
+        std::make_shared<std::vector<std::shared_ptr<TraceSample>>>();
+    {
+        detail::GILGuard gil_guard;
+        samples.swap(pending_samples);
+        released_ids.swap(released_sample_ids);
+        traces->reserve(samples.size());
+        for (const auto &sample : samples) {
+            traces->emplace_back(construct_trace(sample, base_measurements));
+        }
+        release(samples);
+    }
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        for (std::size_t i = 0; i < samples.size(); i++) {
+            const auto bytes   = samples[i].estimated_bytes;
+            auto &     profile = profiles[collapse_stack(*(*traces)[i])];
+            profile.allocated_bytes += bytes;
+            profile.live_bytes += bytes;
+            live_samples.emplace(
+                samples[i].id,
+                std::make_pair(&profile, bytes));
+        }
+        // Samples are processed first, since they could be released in
+        // the same batch.
+        for (const auto id : released_ids) {
+            auto it = live_samples.find(id);
+            if (it == live_samples.end()) {
+                continue;
+            }
+            it->second.first->live_bytes -= it->second.second;
+            live_samples.erase(it);
+        }
+    }
+    if (!traces->empty()) {
+        subscribers(traces);
+    }
+}
+
+std::shared_ptr<TraceSample> AllocationCollector::construct_trace(
+    const Sample &                                   sample,
+    const TimePointConversionUtil::BaseMeasurements &base_measurements) {
+    auto trace_sample = std::make_shared<TraceSample>();
+    trace_sample->frames =
+        std::make_shared<std::vector<std::shared_ptr<Frame>>>();
+    trace_sample->monotonic_clock_timestamp = sample.timestamp;
+    trace_sample->timestamp = TimePointConversionUtil::convert_time_point(
+        sample.timestamp,
+        base_measurements);
+    trace_sample->thread_id       = sample.thread_id;
+    trace_sample->process_id      = process_id;
+    trace_sample->hostname        = hostname;
+    trace_sample->allocated_bytes = sample.estimated_bytes;
+    for (const auto &raw_frame : sample.frames) {
+        const auto code      = code_registry.get(raw_frame.code);
+        auto       frame     = std::make_shared<Frame>();
+        frame->symbolic_name = code->name;
+        frame->file_name     = code->file_name;
+        frame->line_number   = code->get_line_number(raw_frame.lasti);
+        frame->is_coroutine  = false;
+        frame->is_generator  = false;
+        frame->cookie        = raw_frame.address;
+        trace_sample->frames->emplace_back(std::move(frame));
+    }
+    return trace_sample;
+}
+
+const CollectionMethod AllocationCollector::collection_method;
+constexpr std::size_t  AllocationCollector::max_depth;
+constexpr std::size_t  AllocationCollector::live_filter_bits;
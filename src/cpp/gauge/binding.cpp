@@ -2,16 +2,32 @@
 #include <memory>
 #include <vector>
 
+#include <boost/optional.hpp>
 #include <fmt/format.h>
 #include <pybind11/chrono.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
+#include <gauge/allocation_collector.hpp>
 #include <gauge/base.hpp>
+#include <gauge/chrome_trace_writer.hpp>
+#include <gauge/dispatch.hpp>
+#include <gauge/gc_collector.hpp>
+#include <gauge/latency_aggregator.hpp>
+#include <gauge/line_aggregator.hpp>
+#include <gauge/remote_sampling_collector.hpp>
 #include <gauge/sampling_collector.hpp>
 #include <gauge/span_aggregator.hpp>
+#include <gauge/span_filter.hpp>
+#include <gauge/span_registry.hpp>
+#include <gauge/span_retention.hpp>
+#include <gauge/thread_filter.hpp>
+#include <gauge/tracing_collector.hpp>
+#include <gauge/utils/clock.hpp>
 #include <gauge/utils/logging.hpp>
+#include <gauge/utils/py_string_cache.hpp>
+#include <gauge/utils/tag_registry.hpp>
 
 namespace py = pybind11;
 using namespace gauge;
@@ -19,6 +35,56 @@ using namespace gauge;
 PYBIND11_MAKE_OPAQUE(std::vector<std::shared_ptr<TraceSample>>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::shared_ptr<Frame>>);
 PYBIND11_MAKE_OPAQUE(std::vector<std::shared_ptr<Span>>);
+PYBIND11_MAKE_OPAQUE(std::vector<LineStats>);
+PYBIND11_MAKE_OPAQUE(std::vector<LatencyStats>);
+
+namespace pybind11 {
+namespace detail {
+// Makes boost::optional convertible as described in pybind11 docs on
+// custom optional-like types.
+template <typename T>
+struct type_caster<boost::optional<T>> : optional_caster<boost::optional<T>> {
+};
+} // namespace detail
+} // namespace pybind11
+
+namespace {
+/**
+ * Names of functions, files and hosts - they repeat a lot.
+ */
+gauge::detail::PyStringCache &get_names_cache() {
+    // Leaked so that strings aren't released after the interpreter is
+    // finalized.
+    static auto *cache = new gauge::detail::PyStringCache(65536, true);
+    return *cache;
+}
+
+/**
+ * IDs of spans - each is read several times while a span is exported.
+ */
+gauge::detail::PyStringCache &get_ids_cache() {
+    static auto *cache = new gauge::detail::PyStringCache(16384);
+    return *cache;
+}
+
+/**
+ * Make a getter of the string attribute that hands out cached strings.
+ */
+template <typename Class>
+auto get_cached(
+    std::string Class::*           member,
+    gauge::detail::PyStringCache &(*get_cache)()) {
+    return [member, get_cache](const Class &self) {
+        return get_cache().get(self.*member);
+    };
+}
+
+template <typename Class> auto set_string(std::string Class::*member) {
+    return [member](Class &self, std::string value) {
+        self.*member = std::move(value);
+    };
+}
+} // namespace
 
 // TODO: 1. Make __repr__(), __hash__(), __eq__(), __ne__()
 //          for Frame and Trace classes.
@@ -37,6 +103,12 @@ PYBIND11_MODULE(_gauge, m) {
     py::bind_vector<
         std::vector<std::shared_ptr<Span>>,
         std::shared_ptr<std::vector<std::shared_ptr<Span>>>>(m, "Spans");
+    py::bind_vector<
+        std::vector<LineStats>,
+        std::shared_ptr<std::vector<LineStats>>>(m, "LineStatsList");
+    py::bind_vector<
+        std::vector<LatencyStats>,
+        std::shared_ptr<std::vector<LatencyStats>>>(m, "LatencyStatsList");
     // Exceptions.
     auto gauge_error = py::register_exception<GaugeError>(m, "GaugeError");
     py::register_exception<InvalidLoggingLevel>(
@@ -76,15 +148,32 @@ PYBIND11_MODULE(_gauge, m) {
             py::arg("is_coroutine"),
             py::arg("is_generator"),
             py::arg("cookie"))
-        .def_readwrite("symbolic_name", &Frame::symbolic_name)
-        .def_readwrite("file_name", &Frame::file_name)
+        .def_property(
+            "symbolic_name",
+            get_cached(&Frame::symbolic_name, get_names_cache),
+            set_string(&Frame::symbolic_name))
+        .def_property(
+            "file_name",
+            get_cached(&Frame::file_name, get_names_cache),
+            set_string(&Frame::file_name))
         .def_readwrite("line_number", &Frame::line_number)
         .def_readwrite("is_coroutine", &Frame::is_coroutine)
         .def_readwrite("is_generator", &Frame::is_generator)
         .def_readwrite("cookie", &Frame::cookie);
     // gauge.CollectionMethod
     py::enum_<CollectionMethod>(m, "CollectionMethod")
-        .value("Sampling", CollectionMethod::Sampling);
+        .value("Sampling", CollectionMethod::Sampling)
+        .value("Tracing", CollectionMethod::Tracing);
+    // gauge.GILState
+    py::enum_<GILState>(m, "GILState")
+        .value("Unknown", GILState::Unknown)
+        .value("Holding", GILState::Holding)
+        .value("Released", GILState::Released);
+    // gauge.SamplingSchedule
+    py::enum_<SamplingSchedule>(m, "SamplingSchedule")
+        .value("Fixed", SamplingSchedule::Fixed)
+        .value("Jittered", SamplingSchedule::Jittered)
+        .value("Exponential", SamplingSchedule::Exponential);
     // gauge.Trace
     py::class_<TraceSample, std::shared_ptr<TraceSample>>(m, "TraceSample")
         .def(
@@ -111,7 +200,17 @@ PYBIND11_MODULE(_gauge, m) {
         .def_readwrite("timestamp", &TraceSample::timestamp)
         .def_readwrite("thread_id", &TraceSample::thread_id)
         .def_readwrite("process_id", &TraceSample::process_id)
-        .def_readwrite("hostname", &TraceSample::hostname);
+        .def_property(
+            "hostname",
+            get_cached(&TraceSample::hostname, get_names_cache),
+            set_string(&TraceSample::hostname))
+        .def_readwrite("is_unchanged", &TraceSample::is_unchanged)
+        .def_readwrite("cpu_time", &TraceSample::cpu_time)
+        .def_readwrite("gil_state", &TraceSample::gil_state)
+        .def_readwrite("gil_wait", &TraceSample::gil_wait)
+        .def_readwrite("weight", &TraceSample::weight)
+        .def_readwrite("allocated_bytes", &TraceSample::allocated_bytes)
+        .def_readwrite("tags", &TraceSample::tags);
     // gauge.Span
     py::class_<Span, std::shared_ptr<Span>> PySpan(m, "Span");
     PySpan.def(
@@ -147,12 +246,27 @@ PYBIND11_MODULE(_gauge, m) {
         py::arg("process_id"),
         py::arg("hostname"));
     PySpan.def_readwrite("lifetime", &Span::lifetime)
-        .def_readwrite("id", &Span::id)
-        .def_readwrite("parent_id", &Span::parent_id)
-        .def_readwrite("correlation_id", &Span::correlation_id)
+        .def_property(
+            "id",
+            get_cached(&Span::id, get_ids_cache),
+            set_string(&Span::id))
+        .def_property(
+            "parent_id",
+            get_cached(&Span::parent_id, get_ids_cache),
+            set_string(&Span::parent_id))
+        .def_property(
+            "correlation_id",
+            get_cached(&Span::correlation_id, get_ids_cache),
+            set_string(&Span::correlation_id))
         .def_readwrite("is_top", &Span::is_top)
-        .def_readwrite("symbolic_name", &Span::symbolic_name)
-        .def_readwrite("file_name", &Span::file_name)
+        .def_property(
+            "symbolic_name",
+            get_cached(&Span::symbolic_name, get_names_cache),
+            set_string(&Span::symbolic_name))
+        .def_property(
+            "file_name",
+            get_cached(&Span::file_name, get_names_cache),
+            set_string(&Span::file_name))
         .def_readwrite("line_number", &Span::line_number)
         .def_readwrite("is_coroutine", &Span::is_coroutine)
         .def_readwrite("is_generator", &Span::is_generator)
@@ -162,11 +276,46 @@ PYBIND11_MODULE(_gauge, m) {
         .def_readwrite("timestamp", &Span::timestamp)
         .def_readwrite("thread_id", &Span::thread_id)
         .def_readwrite("process_id", &Span::process_id)
-        .def_readwrite("hostname", &Span::hostname);
+        .def_property(
+            "hostname",
+            get_cached(&Span::hostname, get_names_cache),
+            set_string(&Span::hostname))
+        .def_readwrite("repetition_count", &Span::repetition_count)
+        .def_readwrite("summed_duration", &Span::summed_duration)
+        .def_readwrite("tags", &Span::tags);
     // gauge.SpanLifetime
     py::enum_<Span::SpanLifeTime>(PySpan, "SpanLifeTime")
         .value("Start", Span::SpanLifeTime::Start)
         .value("End", Span::SpanLifeTime::End);
+    // gauge.BackpressurePolicy
+    py::enum_<BackpressurePolicy>(m, "BackpressurePolicy")
+        .value("Block", BackpressurePolicy::Block)
+        .value("DropNewest", BackpressurePolicy::DropNewest)
+        .value("DropOldest", BackpressurePolicy::DropOldest)
+        .value("SampleDown", BackpressurePolicy::SampleDown);
+    // gauge.DispatchOptions
+    py::class_<DispatchOptions>(m, "DispatchOptions")
+        .def(
+            py::init(
+                [](std::size_t queue_capacity, BackpressurePolicy policy) {
+                    DispatchOptions options;
+                    options.queue_capacity = queue_capacity;
+                    options.policy         = policy;
+                    return options;
+                }),
+            py::arg("queue_capacity") = 0,
+            py::arg("policy")         = BackpressurePolicy::Block)
+        .def_readwrite("queue_capacity", &DispatchOptions::queue_capacity)
+        .def_readwrite("policy", &DispatchOptions::policy);
+    // gauge.DispatchStats
+    py::class_<DispatchStats>(m, "DispatchStats")
+        .def_readonly("queue_capacity", &DispatchStats::queue_capacity)
+        .def_readonly("queue_size", &DispatchStats::queue_size)
+        .def_readonly("policy", &DispatchStats::policy)
+        .def_readonly("dispatched_count", &DispatchStats::dispatched_count)
+        .def_readonly("dropped_count", &DispatchStats::dropped_count)
+        .def_readonly("lag", &DispatchStats::lag)
+        .def_readonly("max_lag", &DispatchStats::max_lag);
     // gauge.SamplingCollector
     py::class_<SamplingCollector>(m, "SamplingCollector")
         .def(
@@ -177,8 +326,45 @@ PYBIND11_MODULE(_gauge, m) {
             py::arg("processing_interval"))
         .def(
             "subscribe",
-            (void (SamplingCollector::*)(py::object)) &
-                SamplingCollector::subscribe)
+            [](SamplingCollector &    self,
+               SpanAggregator &       aggregator,
+               const DispatchOptions &options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SamplingCollector &    self,
+               LineAggregator &       aggregator,
+               const DispatchOptions &options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (SamplingCollector::*)(
+                py::object,
+                const DispatchOptions &)) &
+                SamplingCollector::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &SamplingCollector::get_dispatch_stats)
         .def("start", &SamplingCollector::start)
         .def("pause", &SamplingCollector::pause)
         .def("is_paused", &SamplingCollector::is_paused)
@@ -196,7 +382,323 @@ PYBIND11_MODULE(_gauge, m) {
             &SamplingCollector::get_collection_interval)
         .def(
             "set_collection_interval",
-            &SamplingCollector::set_collection_interval);
+            &SamplingCollector::set_collection_interval)
+        .def(
+            "set_async_tasks_collection",
+            &SamplingCollector::set_async_tasks_collection,
+            py::arg("enabled"))
+        .def(
+            "is_collecting_async_tasks",
+            &SamplingCollector::is_collecting_async_tasks)
+        .def(
+            "get_thread_filter",
+            &SamplingCollector::get_thread_filter,
+            py::return_value_policy::reference_internal)
+        .def(
+            "set_unchanged_stacks_suppression",
+            &SamplingCollector::set_unchanged_stacks_suppression,
+            py::arg("enabled"))
+        .def(
+            "is_suppressing_unchanged_stacks",
+            &SamplingCollector::is_suppressing_unchanged_stacks)
+        .def(
+            "set_gil_free_sampling",
+            &SamplingCollector::set_gil_free_sampling,
+            py::arg("enabled"))
+        .def("is_gil_free_sampling", &SamplingCollector::is_gil_free_sampling)
+        .def(
+            "set_cpu_time_sampling",
+            &SamplingCollector::set_cpu_time_sampling,
+            py::arg("enabled"),
+            py::arg("skip_idle_threads") = false)
+        .def("is_cpu_time_sampling", &SamplingCollector::is_cpu_time_sampling)
+        .def(
+            "set_gil_sampling",
+            &SamplingCollector::set_gil_sampling,
+            py::arg("enabled"))
+        .def("is_gil_sampling", &SamplingCollector::is_gil_sampling)
+        .def(
+            "set_sampling_schedule",
+            &SamplingCollector::set_sampling_schedule,
+            py::arg("schedule"))
+        .def(
+            "get_sampling_schedule",
+            &SamplingCollector::get_sampling_schedule)
+        .def(
+            "set_context_vars",
+            &SamplingCollector::set_context_vars,
+            py::arg("vars"))
+        .def(
+            "get_dropped_samples_count",
+            &SamplingCollector::get_dropped_samples_count)
+        .def(
+            "set_flight_recording",
+            &SamplingCollector::set_flight_recording,
+            py::arg("enabled"),
+            py::arg("capacity") = 1000000)
+        .def("is_flight_recording", &SamplingCollector::is_flight_recording)
+        .def(
+            "dump",
+            &SamplingCollector::dump,
+            py::arg("path"),
+            py::arg("window") = std::chrono::steady_clock::duration::zero(),
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "replay",
+            &SamplingCollector::replay,
+            py::arg("window") = std::chrono::steady_clock::duration::zero(),
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "set_dump_watchdog",
+            &SamplingCollector::set_dump_watchdog,
+            py::arg("functions"),
+            py::arg("threshold"),
+            py::arg("path")   = "",
+            py::arg("window") = std::chrono::steady_clock::duration::zero());
+    // gauge.RemoteSamplingCollector
+    py::class_<RemoteSamplingCollector>(m, "RemoteSamplingCollector")
+        .def(
+            py::init<
+                pid_t,
+                std::chrono::steady_clock::duration,
+                std::chrono::steady_clock::duration>(),
+            py::arg("pid"),
+            py::arg("sampling_interval"),
+            py::arg("processing_interval"))
+        .def(
+            "subscribe",
+            [](RemoteSamplingCollector &self,
+               SpanAggregator &         aggregator,
+               const DispatchOptions &  options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](RemoteSamplingCollector &self,
+               LineAggregator &         aggregator,
+               const DispatchOptions &  options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (RemoteSamplingCollector::*)(
+                py::object,
+                const DispatchOptions &)) &
+                RemoteSamplingCollector::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def(
+            "get_dispatch_stats",
+            &RemoteSamplingCollector::get_dispatch_stats)
+        .def("start", &RemoteSamplingCollector::start)
+        .def("pause", &RemoteSamplingCollector::pause)
+        .def("is_paused", &RemoteSamplingCollector::is_paused)
+        .def("resume", &RemoteSamplingCollector::resume)
+        .def("stop", &RemoteSamplingCollector::stop)
+        .def("is_stopped", &RemoteSamplingCollector::is_stopped)
+        .def("get_pid", &RemoteSamplingCollector::get_pid)
+        .def(
+            "get_sampling_interval",
+            &RemoteSamplingCollector::get_sampling_interval)
+        .def(
+            "set_sampling_interval",
+            &RemoteSamplingCollector::set_sampling_interval)
+        .def(
+            "get_dropped_samples_count",
+            &RemoteSamplingCollector::get_dropped_samples_count)
+        .def(
+            "get_failed_samples_count",
+            &RemoteSamplingCollector::get_failed_samples_count);
+    // gauge.TracingCollector
+    py::class_<TracingCollector>(m, "TracingCollector")
+        .def(
+            py::init<std::chrono::steady_clock::duration>(),
+            py::arg("processing_interval"))
+        .def(
+            "subscribe",
+            [](TracingCollector &     self,
+               SpanAggregator &       aggregator,
+               const DispatchOptions &options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](TracingCollector &     self,
+               LineAggregator &       aggregator,
+               const DispatchOptions &options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (TracingCollector::*)(py::object, const DispatchOptions &)) &
+                TracingCollector::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &TracingCollector::get_dispatch_stats)
+        .def("start", &TracingCollector::start)
+        .def("pause", &TracingCollector::pause)
+        .def("is_paused", &TracingCollector::is_paused)
+        .def("resume", &TracingCollector::resume)
+        .def("stop", &TracingCollector::stop)
+        .def("is_stopped", &TracingCollector::is_stopped)
+        .def(
+            "set_traced_functions",
+            &TracingCollector::set_traced_functions,
+            py::arg("functions"))
+        .def(
+            "get_dropped_events_count",
+            &TracingCollector::get_dropped_events_count)
+        .def_readonly_static(
+            "collection_method",
+            &TracingCollector::collection_method);
+    // gauge.GCStats
+    py::class_<GCStats>(m, "GCStats")
+        .def_readonly("generation", &GCStats::generation)
+        .def_readonly("collections_count", &GCStats::collections_count)
+        .def_readonly("collected_count", &GCStats::collected_count)
+        .def_readonly("uncollectable_count", &GCStats::uncollectable_count)
+        .def_readonly("total_pause", &GCStats::total_pause)
+        .def_readonly("max_pause", &GCStats::max_pause);
+    // gauge.GCCollector
+    py::class_<GCCollector>(m, "GCCollector")
+        .def(
+            py::init<std::chrono::steady_clock::duration>(),
+            py::arg("processing_interval"))
+        .def(
+            "subscribe",
+            [](GCCollector &          self,
+               SpanAggregator &       aggregator,
+               const DispatchOptions &options) {
+                // Connect natively so that traces never reach Python.
+                CollectorInterface::CallbackInterface callback =
+                    [&aggregator](
+                        const std::shared_ptr<
+                            std::vector<std::shared_ptr<TraceSample>>>
+                            &traces) { aggregator(traces); };
+                self.subscribe(callback, options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (GCCollector::*)(py::object, const DispatchOptions &)) &
+                GCCollector::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &GCCollector::get_dispatch_stats)
+        .def("start", &GCCollector::start)
+        .def("pause", &GCCollector::pause)
+        .def("is_paused", &GCCollector::is_paused)
+        .def("resume", &GCCollector::resume)
+        .def("stop", &GCCollector::stop)
+        .def("is_stopped", &GCCollector::is_stopped)
+        .def("get_stats", &GCCollector::get_stats)
+        .def(
+            "get_dropped_events_count",
+            &GCCollector::get_dropped_events_count)
+        .def_readonly_static("file_name", &GCCollector::file_name)
+        .def_readonly_static(
+            "collection_method",
+            &GCCollector::collection_method);
+    // gauge.AllocationCollector
+    py::class_<AllocationCollector>(m, "AllocationCollector")
+        .def(
+            py::init<std::size_t, std::chrono::steady_clock::duration>(),
+            py::arg("sampling_rate"),
+            py::arg("processing_interval"))
+        .def(
+            "subscribe",
+            (void (AllocationCollector::*)(
+                py::object,
+                const DispatchOptions &)) &
+                AllocationCollector::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &AllocationCollector::get_dispatch_stats)
+        .def("start", &AllocationCollector::start)
+        .def("pause", &AllocationCollector::pause)
+        .def("is_paused", &AllocationCollector::is_paused)
+        .def("resume", &AllocationCollector::resume)
+        .def("stop", &AllocationCollector::stop)
+        .def("is_stopped", &AllocationCollector::is_stopped)
+        .def("get_sampling_rate", &AllocationCollector::get_sampling_rate)
+        .def(
+            "dump",
+            &AllocationCollector::dump,
+            py::arg("path"),
+            py::arg("live") = false,
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "get_live_samples_count",
+            &AllocationCollector::get_live_samples_count)
+        .def_readonly_static(
+            "collection_method",
+            &AllocationCollector::collection_method);
+    // gauge.ThreadFilter
+    py::class_<ThreadFilter>(m, "ThreadFilter")
+        .def(
+            "set_included_ids",
+            &ThreadFilter::set_included_ids,
+            py::arg("ids"))
+        .def(
+            "set_excluded_ids",
+            &ThreadFilter::set_excluded_ids,
+            py::arg("ids"))
+        .def(
+            "set_included_names",
+            &ThreadFilter::set_included_names,
+            py::arg("patterns"))
+        .def(
+            "set_excluded_names",
+            &ThreadFilter::set_excluded_names,
+            py::arg("patterns"))
+        .def(
+            "set_only_active",
+            &ThreadFilter::set_only_active,
+            py::arg("only_active"))
+        .def("is_only_active", &ThreadFilter::is_only_active)
+        .def("mark_active", &ThreadFilter::mark_active, py::arg("thread_id"))
+        .def(
+            "mark_inactive",
+            &ThreadFilter::mark_inactive,
+            py::arg("thread_id"));
     // gauge.SpanAggregator
     py::class_<SpanAggregator>(m, "SpanAggregator")
         .def(
@@ -204,13 +706,398 @@ PYBIND11_MODULE(_gauge, m) {
             py::arg("span_ttl"))
         .def(
             "subscribe",
-            (void (SpanAggregator::*)(py::object)) & SpanAggregator::subscribe)
+            [](SpanAggregator &       self,
+               SpanFilter &           span_filter,
+               const DispatchOptions &options) {
+                // Connect natively so that spans never reach Python.
+                self.subscribe(
+                    [&span_filter](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { span_filter(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanAggregator &       self,
+               SpanRetention &        span_retention,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&span_retention](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { span_retention(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanAggregator &       self,
+               LatencyAggregator &    aggregator,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&aggregator](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { aggregator(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanAggregator &       self,
+               ChromeTraceWriter &    writer,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&writer](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { writer(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (SpanAggregator::*)(py::object, const DispatchOptions &)) &
+                SpanAggregator::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &SpanAggregator::get_dispatch_stats)
         .def("finish_open_spans", &SpanAggregator::finish_open_spans)
+        .def(
+            "set_open_spans_budget",
+            &SpanAggregator::set_open_spans_budget,
+            py::arg("max_count"),
+            py::arg("max_bytes"))
+        .def("get_open_spans_count", &SpanAggregator::get_open_spans_count)
+        .def("get_open_spans_bytes", &SpanAggregator::get_open_spans_bytes)
+        .def(
+            "get_evicted_spans_count",
+            &SpanAggregator::get_evicted_spans_count)
+        .def(
+            "set_sibling_coalescing",
+            &SpanAggregator::set_sibling_coalescing,
+            py::arg("enabled"))
+        .def("is_coalescing_siblings", &SpanAggregator::is_coalescing_siblings)
         .def("__call__", &SpanAggregator::operator(), py::is_operator());
+    // gauge.LineStats
+    py::class_<LineStats>(m, "LineStats")
+        .def_readonly("file_name", &LineStats::file_name)
+        .def_readonly("line_number", &LineStats::line_number)
+        .def_readonly("self_count", &LineStats::self_count)
+        .def_readonly("total_count", &LineStats::total_count)
+        .def_readonly("self_time", &LineStats::self_time)
+        .def_readonly("total_time", &LineStats::total_time)
+        .def_readonly("self_cpu_time", &LineStats::self_cpu_time)
+        .def_readonly("total_cpu_time", &LineStats::total_cpu_time);
+    // gauge.LineAggregator
+    py::class_<LineAggregator>(m, "LineAggregator")
+        .def(
+            py::init<std::chrono::steady_clock::duration>(),
+            py::arg("snapshot_interval"))
+        .def(
+            "subscribe",
+            (void (LineAggregator::*)(py::object, const DispatchOptions &)) &
+                LineAggregator::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &LineAggregator::get_dispatch_stats)
+        .def("snapshot", &LineAggregator::snapshot, py::arg("reset") = false)
+        .def(
+            "top",
+            &LineAggregator::top,
+            py::arg("count"),
+            py::arg("by_total")    = false,
+            py::arg("by_cpu_time") = false)
+        .def("reset", &LineAggregator::reset)
+        .def("get_samples_count", &LineAggregator::get_samples_count)
+        .def("__call__", &LineAggregator::operator(), py::is_operator());
+    // gauge.LatencyStats
+    py::class_<LatencyStats>(m, "LatencyStats")
+        .def_readonly("symbolic_name", &LatencyStats::symbolic_name)
+        .def_readonly("file_name", &LatencyStats::file_name)
+        .def_readonly("top_symbolic_name", &LatencyStats::top_symbolic_name)
+        .def_readonly("top_file_name", &LatencyStats::top_file_name)
+        .def_readonly("count", &LatencyStats::count)
+        .def_readonly("min", &LatencyStats::min)
+        .def_readonly("max", &LatencyStats::max)
+        .def_readonly("mean", &LatencyStats::mean)
+        .def_readonly("p50", &LatencyStats::p50)
+        .def_readonly("p90", &LatencyStats::p90)
+        .def_readonly("p99", &LatencyStats::p99)
+        .def_readonly("p999", &LatencyStats::p999)
+        .def_property_readonly("histogram", [](const LatencyStats &self) {
+            return py::bytes(self.histogram);
+        });
+    // gauge.LatencyAggregator
+    py::class_<LatencyAggregator>(m, "LatencyAggregator")
+        .def(
+            py::init<
+                std::chrono::steady_clock::duration,
+                unsigned int,
+                bool,
+                int,
+                std::size_t>(),
+            py::arg("window"),
+            py::arg("window_count"),
+            py::arg("by_top_span"),
+            py::arg("significant_digits"),
+            py::arg("max_open_spans"))
+        .def(
+            "subscribe",
+            (void (LatencyAggregator::*)(
+                py::object,
+                const DispatchOptions &)) &
+                LatencyAggregator::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &LatencyAggregator::get_dispatch_stats)
+        .def("snapshot", &LatencyAggregator::snapshot)
+        .def("reset", &LatencyAggregator::reset)
+        .def("__call__", &LatencyAggregator::operator(), py::is_operator());
+    // gauge.SpanFilter
+    py::class_<SpanFilter>(m, "SpanFilter")
+        .def(
+            py::init<std::chrono::steady_clock::duration>(),
+            py::arg("min_duration"))
+        .def(
+            "subscribe",
+            [](SpanFilter &           self,
+               SpanRetention &        span_retention,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&span_retention](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { span_retention(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanFilter &           self,
+               LatencyAggregator &    aggregator,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&aggregator](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { aggregator(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanFilter &           self,
+               ChromeTraceWriter &    writer,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&writer](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { writer(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (SpanFilter::*)(py::object, const DispatchOptions &)) &
+                SpanFilter::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &SpanFilter::get_dispatch_stats)
+        .def(
+            "strip_levels",
+            &SpanFilter::strip_levels,
+            py::arg("count"),
+            py::arg("process_id") = py::none(),
+            py::arg("thread_id")  = py::none())
+        .def(
+            "set_allowed_files",
+            &SpanFilter::set_allowed_files,
+            py::arg("patterns"))
+        .def(
+            "set_denied_files",
+            &SpanFilter::set_denied_files,
+            py::arg("patterns"))
+        .def(
+            "set_module_roots",
+            &SpanFilter::set_module_roots,
+            py::arg("roots"))
+        .def(
+            "set_allowed_modules",
+            &SpanFilter::set_allowed_modules,
+            py::arg("patterns"))
+        .def(
+            "set_denied_modules",
+            &SpanFilter::set_denied_modules,
+            py::arg("patterns"))
+        .def("get_min_duration", &SpanFilter::get_min_duration)
+        .def(
+            "set_min_duration",
+            &SpanFilter::set_min_duration,
+            py::arg("duration"))
+        .def("__call__", &SpanFilter::operator(), py::is_operator());
+    // gauge.SpanRetention
+    py::class_<SpanRetention>(m, "SpanRetention")
+        .def(
+            py::init<
+                std::chrono::steady_clock::duration,
+                double,
+                std::size_t>(),
+            py::arg("min_duration"),
+            py::arg("sample_rate"),
+            py::arg("max_held_spans"))
+        .def(
+            "subscribe",
+            [](SpanRetention &        self,
+               SpanFilter &           span_filter,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&span_filter](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { span_filter(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanRetention &        self,
+               LatencyAggregator &    aggregator,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&aggregator](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { aggregator(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            [](SpanRetention &        self,
+               ChromeTraceWriter &    writer,
+               const DispatchOptions &options) {
+                self.subscribe(
+                    [&writer](
+                        std::shared_ptr<std::vector<std::shared_ptr<Span>>>
+                            spans) { writer(spans); },
+                    options);
+            },
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions(),
+            py::keep_alive<1, 2>())
+        .def(
+            "subscribe",
+            (void (SpanRetention::*)(py::object, const DispatchOptions &)) &
+                SpanRetention::subscribe,
+            py::arg("callback"),
+            py::arg("options") = DispatchOptions())
+        .def("get_dispatch_stats", &SpanRetention::get_dispatch_stats)
+        .def("get_min_duration", &SpanRetention::get_min_duration)
+        .def(
+            "set_min_duration",
+            &SpanRetention::set_min_duration,
+            py::arg("duration"))
+        .def("get_sample_rate", &SpanRetention::get_sample_rate)
+        .def(
+            "set_sample_rate",
+            &SpanRetention::set_sample_rate,
+            py::arg("rate"))
+        .def("get_kept_trees_count", &SpanRetention::get_kept_trees_count)
+        .def(
+            "get_dropped_trees_count",
+            &SpanRetention::get_dropped_trees_count)
+        .def("__call__", &SpanRetention::operator(), py::is_operator());
+    // gauge.ChromeTraceWriter
+    py::class_<ChromeTraceWriter>(m, "ChromeTraceWriter")
+        .def(
+            py::init<
+                const std::string &,
+                std::size_t,
+                const DispatchOptions &>(),
+            py::arg("path"),
+            py::arg("max_file_size"),
+            py::arg("options"))
+        .def(
+            "close",
+            &ChromeTraceWriter::close,
+            py::call_guard<py::gil_scoped_release>())
+        .def("get_paths", &ChromeTraceWriter::get_paths)
+        .def(
+            "get_written_events_count",
+            &ChromeTraceWriter::get_written_events_count)
+        .def("get_dispatch_stats", &ChromeTraceWriter::get_dispatch_stats)
+        .def("__call__", &ChromeTraceWriter::operator(), py::is_operator());
+    // gauge.SpanRegistry
+    py::class_<SpanRegistry> PySpanRegistry(m, "SpanRegistry");
+    PySpanRegistry
+        .def(
+            py::init<py::object, std::chrono::steady_clock::duration>(),
+            py::arg("context_factory"),
+            py::arg("context_ttl") = std::chrono::seconds(30))
+        .def(
+            "strip_levels",
+            &SpanRegistry::strip_levels,
+            py::arg("count"),
+            py::arg("process_id") = py::none(),
+            py::arg("thread_id")  = py::none())
+        .def("get_spans_count", &SpanRegistry::get_spans_count)
+        .def("get_contexts_count", &SpanRegistry::get_contexts_count)
+        .def("__call__", &SpanRegistry::operator(), py::is_operator());
+    // gauge.SpanRegistry.Entry
+    py::class_<SpanRegistry::Entry, std::shared_ptr<SpanRegistry::Entry>>(
+        PySpanRegistry,
+        "Entry")
+        .def_readonly("span", &SpanRegistry::Entry::span)
+        .def_readonly("parent", &SpanRegistry::Entry::parent)
+        .def_readonly("depth", &SpanRegistry::Entry::depth)
+        .def_readonly("is_stripped", &SpanRegistry::Entry::is_stripped)
+        .def_readonly("is_top", &SpanRegistry::Entry::is_top)
+        .def_readwrite("tracer_span", &SpanRegistry::Entry::tracer_span)
+        .def_readonly("context", &SpanRegistry::Entry::context);
     m.def(
         "setup_logging",
         &gauge::setup_logging,
         py::arg("stdout"),
         py::arg("stderr"),
         py::arg("level"));
+    m.def(
+        "get_tag",
+        [](unsigned int id) { return detail::get_tag_registry().get(id); },
+        py::arg("id"));
+    // gauge.testing - internals exposed for tests
+    auto testing = m.def_submodule("testing");
+    // gauge.testing.FastClock
+    py::class_<detail::FastClock>(testing, "FastClock")
+        .def(
+            py::init([](py::function read_ticks, py::function read_steady) {
+                // Readings are simulated by Python, the GIL is held while
+                // the clock is used.
+                detail::FastClock::Sources sources;
+                sources.read_ticks = [read_ticks]() {
+                    return read_ticks().cast<std::uint64_t>();
+                };
+                sources.read_steady = [read_steady]() {
+                    return read_steady()
+                        .cast<std::chrono::steady_clock::time_point>();
+                };
+                return std::make_unique<detail::FastClock>(
+                    std::move(sources));
+            }),
+            py::arg("read_ticks"),
+            py::arg("read_steady"))
+        .def("now", &detail::FastClock::now)
+        .def("calibrate", &detail::FastClock::calibrate);
 }
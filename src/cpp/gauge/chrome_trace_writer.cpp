@@ -0,0 +1,328 @@
+#include <algorithm>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "gauge/chrome_trace_writer.hpp"
+#include "gauge/utils/logging.hpp"
+#include "gauge/utils/tag_registry.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Quote the value as a JSON string.
+ */
+std::string quote(const std::string &value) {
+    std::string result;
+    result.reserve(value.size() + 2);
+    result += '"';
+    for (const char c : value) {
+        switch (c) {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                result += fmt::format(
+                    "\\u{:04x}",
+                    static_cast<unsigned int>(static_cast<unsigned char>(c)));
+            } else {
+                result += c;
+            }
+        }
+    }
+    result += '"';
+    return result;
+}
+
+/**
+ * Format nanoseconds as microseconds without losing precision, numbers
+ * of the format are microseconds.
+ */
+std::string format_timestamp(long long nanoseconds) {
+    return fmt::format("{}.{:03}", nanoseconds / 1000, nanoseconds % 1000);
+}
+} // namespace
+
+ChromeTraceWriter::ChromeTraceWriter(
+    const std::string &    path,
+    std::size_t            max_file_size,
+    const DispatchOptions &options)
+    : logger{detail::get_logger()}, path{path}, max_file_size{max_file_size},
+      written_events_count{0} {
+    open_file(path);
+    if (!file.is_open()) {
+        throw ExporterError();
+    }
+    dispatcher = std::make_unique<detail::AsyncDispatcher<Spans>>(
+        [this](const Spans &spans) { write(spans); },
+        options);
+}
+
+ChromeTraceWriter::~ChromeTraceWriter() { close(); }
+
+void ChromeTraceWriter::operator()(const Spans &spans) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (dispatcher == nullptr || spans->empty()) {
+        return;
+    }
+    dispatcher->push(spans);
+}
+
+void ChromeTraceWriter::close() {
+    std::unique_ptr<detail::AsyncDispatcher<Spans>> closed_dispatcher;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        closed_dispatcher = std::move(dispatcher);
+    }
+    if (closed_dispatcher == nullptr) {
+        return;
+    }
+    closed_dispatcher->flush();
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        closed_dispatch_stats = closed_dispatcher->get_stats();
+    }
+    // Joins the writer thread, so the file isn't touched by it anymore.
+    closed_dispatcher.reset();
+    complete_file();
+    SPDLOG_LOGGER_DEBUG(
+        logger,
+        "Closed Chrome trace, {} events have been written.",
+        written_events_count.load());
+}
+
+std::vector<std::string> ChromeTraceWriter::get_paths() {
+    const std::lock_guard<std::mutex> guard(paths_mutex);
+    return paths;
+}
+
+unsigned long long ChromeTraceWriter::get_written_events_count() const {
+    return written_events_count;
+}
+
+DispatchStats ChromeTraceWriter::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (dispatcher == nullptr) {
+        return closed_dispatch_stats;
+    }
+    return dispatcher->get_stats();
+}
+
+void ChromeTraceWriter::write(const Spans &spans) {
+    for (const auto &span : *spans) {
+        const ThreadKey key{span->process_id, span->thread_id};
+        auto            it = tracks.find(key);
+        if (it == tracks.end()) {
+            it = tracks.emplace(key, Track()).first;
+            it->second.tid = next_tid++;
+        }
+        auto &     track     = it->second;
+        const auto timestamp = static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                span->timestamp.time_since_epoch())
+                .count());
+        if (span->lifetime == Span::Start) {
+            name_track(key, track);
+            write_start(*span, track, timestamp);
+            track.open_spans.push_back(span);
+        } else {
+            // Spans are mostly ended from the innermost one.
+            auto open_it = std::find_if(
+                track.open_spans.rbegin(),
+                track.open_spans.rend(),
+                [&span](const std::shared_ptr<Span> &open_span) {
+                    return open_span->id == span->id;
+                });
+            if (open_it == track.open_spans.rend()) {
+                // Started before the writer has been subscribed.
+                continue;
+            }
+            // Viewers end the innermost open slice of the track, so spans
+            // opened inside the ended one are ended and started again.
+            const auto inner_count = static_cast<std::size_t>(
+                std::distance(track.open_spans.rbegin(), open_it));
+            const auto ended_it = std::next(open_it).base();
+            for (auto it = track.open_spans.rbegin(); it != open_it; it++) {
+                write_end(**it, track, timestamp);
+            }
+            write_end(*span, track, timestamp);
+            track.open_spans.erase(ended_it);
+            for (auto it = track.open_spans.end() - inner_count;
+                 it != track.open_spans.end();
+                 it++) {
+                write_start(**it, track, timestamp);
+            }
+        }
+        last_timestamp = std::max(last_timestamp, timestamp);
+        if (max_file_size != 0 && file_size >= max_file_size) {
+            rotate();
+        }
+    }
+    file.flush();
+}
+
+void ChromeTraceWriter::write_start(
+    const Span & span,
+    const Track &track,
+    long long    timestamp) {
+    std::string args = fmt::format(
+        R"("file_name":{},"line_number":{},"id":{})",
+        quote(span.file_name),
+        span.line_number,
+        quote(span.id));
+    for (const auto id : span.tags) {
+        const auto tag = detail::get_tag_registry().get(id);
+        if (tag) {
+            args += fmt::format(
+                ",{}:{}",
+                quote(tag->first),
+                quote(tag->second));
+        }
+    }
+    append(fmt::format(
+        R"({{"name":{},"cat":{},"ph":"B","ts":{},"pid":{},"tid":{},)"
+        R"("args":{{{}}}}})",
+        quote(span.symbolic_name),
+        quote(span.file_name),
+        format_timestamp(timestamp),
+        span.process_id,
+        track.tid,
+        args));
+}
+
+void ChromeTraceWriter::write_end(
+    const Span & span,
+    const Track &track,
+    long long    timestamp) {
+    std::string args;
+    if (span.repetition_count > 1) {
+        args = fmt::format(
+            R"(,"args":{{"repetition_count":{}}})",
+            span.repetition_count);
+    }
+    append(fmt::format(
+        R"({{"ph":"E","ts":{},"pid":{},"tid":{}{}}})",
+        format_timestamp(timestamp),
+        span.process_id,
+        track.tid,
+        args));
+}
+
+void ChromeTraceWriter::name_track(const ThreadKey &key, Track &track) {
+    if (track.is_named) {
+        return;
+    }
+    track.is_named = true;
+    append(fmt::format(
+        R"({{"name":"thread_name","ph":"M","pid":{},"tid":{},)"
+        R"("args":{{"name":"Thread {}"}}}})",
+        key.first,
+        track.tid,
+        key.second));
+}
+
+void ChromeTraceWriter::append(const std::string &event) {
+    if (!file.is_open()) {
+        return;
+    }
+    if (!is_empty) {
+        file << ",\n";
+        file_size += 2;
+    }
+    file << event;
+    file_size += event.size();
+    is_empty = false;
+    written_events_count++;
+}
+
+void ChromeTraceWriter::open_file(const std::string &file_path) {
+    file.open(file_path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Chrome trace file \"{}\" couldn't be opened.",
+            file_path);
+        return;
+    }
+    file << "[\n";
+    file_size = 2;
+    is_empty  = true;
+    for (auto &item : tracks) {
+        item.second.is_named = false;
+    }
+    const std::lock_guard<std::mutex> guard(paths_mutex);
+    paths.push_back(file_path);
+}
+
+void ChromeTraceWriter::complete_file() {
+    if (!file.is_open()) {
+        return;
+    }
+    file << "\n]\n";
+    file.close();
+    if (file.fail()) {
+        SPDLOG_LOGGER_ERROR(logger, "Chrome trace file couldn't be written.");
+    }
+}
+
+void ChromeTraceWriter::rotate() {
+    // Each file is a complete timeline - open spans are ended here and
+    // started again in the next file, innermost spans end first.
+    for (auto &item : tracks) {
+        auto &track = item.second;
+        const auto &open_spans = track.open_spans;
+        for (auto it = open_spans.rbegin(); it != open_spans.rend(); it++) {
+            write_end(**it, track, last_timestamp);
+        }
+    }
+    complete_file();
+    std::size_t number = 0;
+    {
+        const std::lock_guard<std::mutex> guard(paths_mutex);
+        number = paths.size();
+    }
+    open_file(get_path(number));
+    SPDLOG_LOGGER_DEBUG(logger, "Rotated Chrome trace file.");
+    for (auto &item : tracks) {
+        auto &track = item.second;
+        if (track.open_spans.empty()) {
+            continue;
+        }
+        name_track(item.first, track);
+        for (const auto &span : track.open_spans) {
+            write_start(*span, track, last_timestamp);
+        }
+    }
+}
+
+std::string ChromeTraceWriter::get_path(std::size_t number) const {
+    if (number == 0) {
+        return path;
+    }
+    const auto separator = path.find_last_of('/');
+    const auto dot       = path.find_last_of('.');
+    if (dot == std::string::npos ||
+        (separator != std::string::npos && dot < separator) ||
+        dot == (separator == std::string::npos ? 0 : separator + 1)) {
+        return fmt::format("{}.{}", path, number);
+    }
+    return fmt::format(
+        "{}.{}{}",
+        path.substr(0, dot),
+        number,
+        path.substr(dot));
+}
@@ -0,0 +1,261 @@
+#include <algorithm>
+
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/process/environment.hpp>
+#include <spdlog/spdlog.h>
+
+#include "gauge/gc_collector.hpp"
+#include "gauge/utils/clock.hpp"
+#include "gauge/utils/gil.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+GCCollector::GCCollector(
+    std::chrono::steady_clock::duration processing_interval)
+    : logger{detail::get_logger()},
+      clocks_base_measurements{detail::get_system_clock_mapping().get()},
+      processing_interval{processing_interval}, is_stopped_flag{true},
+      is_paused_flag{false}, dropped_events_count{0},
+      hostname{boost::asio::ip::host_name()},
+      process_id{static_cast<unsigned long long>(
+          boost::this_process::get_id())} {
+    for (std::size_t i = 0; i < stats.size(); i++) {
+        stats[i].generation = static_cast<unsigned int>(i);
+    }
+}
+
+GCCollector::~GCCollector() {
+    if (!is_stopped_flag) {
+        detail::GILGuard gil_guard;
+        stop();
+    }
+}
+
+void GCCollector::subscribe(
+    CallbackInterface &    callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(callback, options);
+}
+
+void GCCollector::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> GCCollector::get_dispatch_stats() const {
+    return subscribers.get_dispatch_stats();
+}
+
+void GCCollector::start() {
+    SPDLOG_LOGGER_DEBUG(logger, "Starting GC collector...");
+    if (!is_stopped_flag) {
+        throw CollectorHasAlreadyStarted();
+    }
+    gc_callback = py::cpp_function(
+        [this](const py::object &phase, const py::dict &info) {
+            // Taken first so that the pause isn't shortened.
+            const auto timestamp = detail::get_fast_clock().now_precise();
+            if (is_paused_flag || is_stopped_flag) {
+                return;
+            }
+            Event event;
+            event.kind =
+                PyUnicode_CompareWithASCIIString(phase.ptr(), "start") == 0
+                    ? Event::Start
+                    : Event::Stop;
+            event.generation = info["generation"].cast<unsigned int>();
+            if (event.kind == Event::Stop) {
+                event.collected_count =
+                    info["collected"].cast<unsigned long long>();
+                event.uncollectable_count =
+                    info["uncollectable"].cast<unsigned long long>();
+            }
+            event.thread_id = PyThread_get_thread_ident();
+            event.timestamp = timestamp;
+            record(event);
+        });
+    is_stopped_flag = false;
+    py::module::import("gc").attr("callbacks").attr("append")(gc_callback);
+    processor_thread = std::thread([this] { this->processor(); });
+    SPDLOG_LOGGER_DEBUG(logger, "Started GC collector.");
+}
+
+void GCCollector::stop() {
+    SPDLOG_LOGGER_DEBUG(logger, "Stopping GC collector...");
+    if (is_stopped_flag) {
+        return;
+    }
+    auto callbacks = py::module::import("gc").attr("callbacks");
+    if (PySequence_Contains(callbacks.ptr(), gc_callback.ptr()) == 1) {
+        callbacks.attr("remove")(gc_callback);
+    }
+    is_stopped_flag = true;
+    if (processor_thread.joinable()) {
+        py::gil_scoped_release release;
+        processor_thread.join();
+        subscribers.flush();
+    }
+    gc_callback = py::object();
+    SPDLOG_LOGGER_DEBUG(logger, "Stopped GC collector.");
+}
+
+bool GCCollector::is_stopped() const { return is_stopped_flag; }
+
+void GCCollector::resume() {
+    if (is_stopped()) {
+        throw CollectorIsStopped();
+    }
+    if (!is_paused_flag) {
+        throw CollectorIsNotPaused();
+    }
+    is_paused_flag = false;
+}
+
+bool GCCollector::is_paused() { return is_paused_flag; }
+
+void GCCollector::pause() {
+    if (is_paused_flag) {
+        throw CollectorIsAlreadyPaused();
+    }
+    is_paused_flag = true;
+}
+
+std::vector<GCStats> GCCollector::get_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return std::vector<GCStats>(stats.begin(), stats.end());
+}
+
+unsigned long long GCCollector::get_dropped_events_count() const {
+    return dropped_events_count;
+}
+
+void GCCollector::record(const Event &event) {
+    if (!events.push(event)) {
+        dropped_events_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void GCCollector::processor() {
+    SPDLOG_LOGGER_DEBUG(logger, "Launching processing of GC events...");
+    static constexpr auto sleep_interval = std::chrono::milliseconds(1);
+    try {
+        auto previous_timestamp = std::chrono::steady_clock::now();
+        while (!is_stopped_flag) {
+            std::this_thread::sleep_for(sleep_interval);
+            detail::calibrate_clocks();
+            auto current_timestamp = std::chrono::steady_clock::now();
+            if ((current_timestamp - previous_timestamp) <
+                processing_interval) {
+                continue;
+            }
+            previous_timestamp = current_timestamp;
+            process_events();
+        }
+        process_events();
+    } catch (const std::exception &e) {
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Processing of GC events has stopped due to the exception: "
+            "\"{}\".",
+            e.what());
+        return;
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Processing of GC events has stopped.");
+}
+
+void GCCollector::process_events() {
+    // Taken before draining so that all of the drained events are older.
+    const auto now = detail::get_fast_clock().now_precise();
+    // All of the traces of the batch are converted the same way.
+    clocks_base_measurements = detail::get_system_clock_mapping().get();
+    auto traces =
+        std::make_shared<std::vector<std::shared_ptr<TraceSample>>>();
+    bool  has_events = false;
+    Event event;
+    while (events.pop(event)) {
+        has_events = true;
+        if (event.kind == Event::Start) {
+            auto collection             = std::make_unique<Collection>();
+            collection->generation      = event.generation;
+            collection->cookie          = next_cookie++;
+            collection->thread_id       = event.thread_id;
+            collection->start_timestamp = event.timestamp;
+            traces->emplace_back(
+                construct_trace(*collection, event.timestamp));
+            current_collection = std::move(collection);
+            continue;
+        }
+        if (current_collection == nullptr ||
+            current_collection->generation != event.generation) {
+            // The start has been dropped.
+            continue;
+        }
+        // The collection is seen for the last time at this moment.
+        traces->emplace_back(
+            construct_trace(*current_collection, event.timestamp));
+        if (event.generation < stats.size()) {
+            const auto pause =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    event.timestamp - current_collection->start_timestamp);
+            const std::lock_guard<std::mutex> guard(mutex);
+            auto &generation_stats = stats[event.generation];
+            generation_stats.collections_count++;
+            generation_stats.collected_count += event.collected_count;
+            generation_stats.uncollectable_count += event.uncollectable_count;
+            generation_stats.total_pause += pause;
+            generation_stats.max_pause =
+                std::max(generation_stats.max_pause, pause);
+        }
+        current_collection.reset();
+    }
+    if (!has_events && current_collection != nullptr) {
+        // Keep the span of a long collection open, the whole trace is
+        // repeated if queued subscribers have missed it.
+        traces->emplace_back(construct_trace(
+            *current_collection,
+            now,
+            !subscribers.check_dropped_batches()));
+    }
+    if (!traces->empty()) {
+        subscribers(traces);
+    }
+}
+
+std::shared_ptr<TraceSample> GCCollector::construct_trace(
+    const Collection &                    collection,
+    std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+    bool                                  is_unchanged) {
+    auto trace_sample = std::make_shared<TraceSample>();
+    trace_sample->frames =
+        std::make_shared<std::vector<std::shared_ptr<Frame>>>();
+    trace_sample->monotonic_clock_timestamp = monotonic_clock_timestamp;
+    trace_sample->timestamp = TimePointConversionUtil::convert_time_point(
+        monotonic_clock_timestamp,
+        clocks_base_measurements);
+    trace_sample->thread_id  = collection.thread_id;
+    trace_sample->process_id = process_id;
+    trace_sample->hostname   = hostname;
+    if (is_unchanged) {
+        trace_sample->is_unchanged = true;
+        return trace_sample;
+    }
+    auto frame           = std::make_shared<Frame>();
+    frame->symbolic_name =
+        fmt::format("gc (generation {})", collection.generation);
+    frame->file_name     = file_name;
+    frame->line_number   = 0;
+    frame->is_coroutine  = false;
+    frame->is_generator  = false;
+    frame->cookie        = collection.cookie;
+    trace_sample->frames->emplace_back(std::move(frame));
+    return trace_sample;
+}
+
+const CollectionMethod GCCollector::collection_method;
+constexpr const char * GCCollector::file_name;
+constexpr std::size_t  GCCollector::events_capacity;
+constexpr std::size_t  GCCollector::generations_count;
@@ -0,0 +1,280 @@
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "gauge/latency_aggregator.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+namespace {
+void encode(std::string &buffer, std::uint64_t value) {
+    for (unsigned int i = 0; i < 8; i++) {
+        buffer.push_back(static_cast<char>((value >> (i * 8U)) & 0xFFU));
+    }
+}
+} // namespace
+
+LatencyAggregator::LatencyAggregator(
+    std::chrono::steady_clock::duration window,
+    unsigned int                        window_count,
+    bool                                by_top_span,
+    int                                 significant_digits,
+    std::size_t                         max_open_spans)
+    : logger{detail::get_logger()}, window{window},
+      window_count{window_count}, by_top_span{by_top_span},
+      significant_digits{significant_digits}, max_open_spans{max_open_spans} {
+    if (window_count == 0 || significant_digits < 1 ||
+        significant_digits > 4 || max_open_spans == 0) {
+        throw AggregatorError();
+    }
+    if (window == std::chrono::steady_clock::duration::zero()) {
+        this->window_count = 1;
+    }
+}
+
+void LatencyAggregator::subscribe(
+    std::function<void(const Snapshot &)> callback,
+    const DispatchOptions &               options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+void LatencyAggregator::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> LatencyAggregator::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return subscribers.get_dispatch_stats();
+}
+
+void LatencyAggregator::operator()(
+    const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans) {
+    SPDLOG_LOGGER_DEBUG(logger, "Counting durations of spans...");
+    std::vector<Snapshot> snapshots;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        for (const auto &span : *spans) {
+            if (span->lifetime == Span::SpanLifeTime::Start) {
+                std::shared_ptr<const Function> top;
+                if (by_top_span) {
+                    auto parent = open_spans.find(span->parent_id);
+                    if (!span->is_top && parent != open_spans.end()) {
+                        top = parent->second.top;
+                    } else {
+                        top = std::make_shared<const Function>(
+                            span->symbolic_name,
+                            span->file_name);
+                    }
+                }
+                if (open_spans.size() >= max_open_spans) {
+                    drop_oldest_open_spans();
+                }
+                open_spans[span->id] =
+                    OpenSpan{span->monotonic_clock_timestamp, std::move(top)};
+                continue;
+            }
+            auto it = open_spans.find(span->id);
+            if (it == open_spans.end()) {
+                continue;
+            }
+            const auto window_number =
+                get_window_number(span->monotonic_clock_timestamp);
+            if (window_number > current_window) {
+                if (!subscribers.empty() && !series.empty()) {
+                    std::vector<std::shared_ptr<Series>> all_series;
+                    for (const auto &item : series) {
+                        all_series.push_back(item.second);
+                    }
+                    snapshots.push_back(
+                        std::make_shared<std::vector<LatencyStats>>(
+                            collect(all_series, current_window)));
+                }
+                current_window = window_number;
+            }
+            record(
+                get_series(*span, it->second.top.get()),
+                span->monotonic_clock_timestamp - it->second.start,
+                window_number);
+            open_spans.erase(it);
+        }
+    }
+    for (const auto &snapshot : snapshots) {
+        subscribers(snapshot);
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Counted durations of spans.");
+}
+
+std::vector<LatencyStats> LatencyAggregator::snapshot() {
+    std::vector<std::shared_ptr<Series>> all_series;
+    long long                            window_number = 0;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        all_series.reserve(series.size());
+        for (const auto &item : series) {
+            all_series.push_back(item.second);
+        }
+        window_number = current_window;
+    }
+    return collect(all_series, window_number);
+}
+
+void LatencyAggregator::reset() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    series.clear();
+}
+
+void LatencyAggregator::drop_oldest_open_spans() {
+    // Dropping half at once keeps the cost of the sweeps amortized constant
+    // per span.
+    std::vector<std::chrono::steady_clock::time_point> starts;
+    starts.reserve(open_spans.size());
+    for (const auto &item : open_spans) {
+        starts.push_back(item.second.start);
+    }
+    const auto median = starts.begin() + starts.size() / 2;
+    std::nth_element(starts.begin(), median, starts.end());
+    const auto  threshold = *median;
+    std::size_t count     = 0;
+    for (auto it = open_spans.begin(); it != open_spans.end();) {
+        if (it->second.start < threshold ||
+            (it->second.start == threshold && count < starts.size() / 2)) {
+            it = open_spans.erase(it);
+            count++;
+        } else {
+            it++;
+        }
+    }
+    SPDLOG_LOGGER_WARN(
+        logger,
+        "Dropped {} open spans, their ends haven't been seen.",
+        count);
+}
+
+long long LatencyAggregator::get_window_number(
+    std::chrono::steady_clock::time_point timestamp) const {
+    if (window == std::chrono::steady_clock::duration::zero()) {
+        return 0;
+    }
+    return static_cast<long long>(timestamp.time_since_epoch() / window);
+}
+
+LatencyAggregator::Series &
+LatencyAggregator::get_series(const Span &span, const Function *top) {
+    static const std::string empty;
+    const auto &top_symbolic_name = top != nullptr ? top->first : empty;
+    const auto &top_file_name     = top != nullptr ? top->second : empty;
+
+    // Looked up by references to avoid copying of the names.
+    auto it = series.find(std::tie(
+        span.symbolic_name,
+        span.file_name,
+        top_symbolic_name,
+        top_file_name));
+    if (it != series.end()) {
+        return *it->second;
+    }
+    auto new_series               = std::make_shared<Series>();
+    new_series->symbolic_name     = span.symbolic_name;
+    new_series->file_name         = span.file_name;
+    new_series->top_symbolic_name = top_symbolic_name;
+    new_series->top_file_name     = top_file_name;
+    for (unsigned int i = 0; i < window_count; i++) {
+        new_series->windows.push_back(
+            std::make_unique<Window>(significant_digits));
+    }
+    auto &result = *new_series;
+    series.emplace(
+        SeriesKey{
+            span.symbolic_name,
+            span.file_name,
+            top_symbolic_name,
+            top_file_name},
+        std::move(new_series));
+    return result;
+}
+
+void LatencyAggregator::record(
+    Series &                            target,
+    std::chrono::steady_clock::duration duration,
+    long long                           window_number) {
+    if (window_number <= current_window - window_count) {
+        // The window has already left the sliding window.
+        return;
+    }
+    auto &slot = *target.windows[static_cast<std::size_t>(
+        window_number % static_cast<long long>(window_count))];
+    if (slot.number.load(std::memory_order_relaxed) != window_number) {
+        // The window is reused, readers skip it until it's reset.
+        slot.number.store(-1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.histogram.reset();
+        slot.number.store(window_number, std::memory_order_release);
+    }
+    const auto nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count();
+    slot.histogram.record(
+        static_cast<std::uint64_t>(std::max<decltype(nanoseconds)>(
+            nanoseconds,
+            0)));
+}
+
+std::vector<LatencyStats> LatencyAggregator::collect(
+    const std::vector<std::shared_ptr<Series>> &all_series,
+    long long                                   window_number) const {
+    std::vector<LatencyStats> all_stats;
+    all_stats.reserve(all_series.size());
+    detail::HdrHistogram copy(significant_digits);
+    for (const auto &item : all_series) {
+        detail::HdrHistogram histogram(significant_digits);
+        for (const auto &slot : item->windows) {
+            const auto number = slot->number.load(std::memory_order_acquire);
+            if (number < 0 || number > window_number ||
+                number <= window_number - window_count) {
+                continue;
+            }
+            copy.reset();
+            copy.add(slot->histogram);
+            // The window could have been reused while it was being copied,
+            // then the copy could be mixed with the next window's counts.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->number.load(std::memory_order_relaxed) == number) {
+                histogram.add(copy);
+            }
+        }
+        if (histogram.get_count() == 0) {
+            continue;
+        }
+        LatencyStats stats;
+        stats.symbolic_name     = item->symbolic_name;
+        stats.file_name         = item->file_name;
+        stats.top_symbolic_name = item->top_symbolic_name;
+        stats.top_file_name     = item->top_file_name;
+        stats.count             = histogram.get_count();
+        stats.min  = std::chrono::nanoseconds(histogram.get_min());
+        stats.max  = std::chrono::nanoseconds(histogram.get_max());
+        stats.mean = std::chrono::nanoseconds(
+            static_cast<std::chrono::nanoseconds::rep>(histogram.get_mean()));
+        stats.p50 =
+            std::chrono::nanoseconds(histogram.get_value_at_percentile(50));
+        stats.p90 =
+            std::chrono::nanoseconds(histogram.get_value_at_percentile(90));
+        stats.p99 =
+            std::chrono::nanoseconds(histogram.get_value_at_percentile(99));
+        stats.p999 =
+            std::chrono::nanoseconds(histogram.get_value_at_percentile(99.9));
+        const auto counts = histogram.get_counts();
+        stats.histogram.reserve(counts.size() * 16);
+        for (const auto &count : counts) {
+            encode(stats.histogram, count.first);
+            encode(stats.histogram, count.second);
+        }
+        all_stats.emplace_back(std::move(stats));
+    }
+    return all_stats;
+}
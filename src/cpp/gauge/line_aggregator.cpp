@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <tuple>
+
+#include <spdlog/spdlog.h>
+
+#include "gauge/line_aggregator.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+constexpr LineAggregator::LineKey LineAggregator::empty_key;
+constexpr std::size_t             LineAggregator::initial_capacity;
+
+LineAggregator::LineAggregator(
+    std::chrono::steady_clock::duration snapshot_interval)
+    : logger{detail::get_logger()}, snapshot_interval{snapshot_interval},
+      slots(initial_capacity) {}
+
+void LineAggregator::subscribe(
+    std::function<void(const Snapshot &)> callback,
+    const DispatchOptions &               options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+void LineAggregator::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> LineAggregator::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return subscribers.get_dispatch_stats();
+}
+
+void LineAggregator::operator()(
+    const std::shared_ptr<std::vector<std::shared_ptr<TraceSample>>> &traces) {
+    SPDLOG_LOGGER_DEBUG(logger, "Counting lines...");
+    // Subscribers are called after the mutex is released, Python callbacks
+    // take the GIL which is taken before the mutex elsewhere.
+    std::vector<Snapshot> snapshots;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        for (const auto &trace : *traces) {
+            const ThreadKey thread_key{trace->process_id, trace->thread_id};
+            if (trace->is_unchanged) {
+                auto it = last_stacks.find(thread_key);
+                if (it != last_stacks.end()) {
+                    it->second.is_seen = true;
+                    count_stack(
+                        it->second.lines,
+                        trace->weight,
+                        trace->cpu_time);
+                }
+            } else {
+                auto &stack   = last_stacks[thread_key];
+                stack.is_seen = true;
+                stack.lines.clear();
+                for (const auto &frame : *trace->frames) {
+                    stack.lines.push_back(intern(*frame));
+                }
+                count_stack(stack.lines, trace->weight, trace->cpu_time);
+            }
+            if (snapshot_interval ==
+                std::chrono::steady_clock::duration::zero()) {
+                continue;
+            }
+            if (last_snapshot_timestamp ==
+                decltype(last_snapshot_timestamp){}) {
+                last_snapshot_timestamp = trace->monotonic_clock_timestamp;
+            } else if (
+                (trace->monotonic_clock_timestamp -
+                 last_snapshot_timestamp) >= snapshot_interval) {
+                last_snapshot_timestamp = trace->monotonic_clock_timestamp;
+                snapshots.push_back(
+                    std::make_shared<std::vector<LineStats>>(collect(true)));
+            }
+        }
+    }
+    for (const auto &snapshot : snapshots) {
+        subscribers(snapshot);
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Counted lines.");
+}
+
+std::vector<LineStats> LineAggregator::snapshot(bool reset) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return collect(reset);
+}
+
+std::vector<LineStats>
+LineAggregator::top(std::size_t count, bool by_total, bool by_cpu_time) {
+    auto lines = snapshot(false);
+    count      = std::min(count, lines.size());
+    // CPU times are compared only when requested, zeros keep the order of
+    // times and counts otherwise.
+    const auto key = [by_total, by_cpu_time](const LineStats &stats) {
+        const auto zero = std::chrono::nanoseconds::zero();
+        if (by_total) {
+            return std::make_tuple(
+                by_cpu_time ? stats.total_cpu_time : zero,
+                stats.total_time,
+                stats.total_count);
+        }
+        return std::make_tuple(
+            by_cpu_time ? stats.self_cpu_time : zero,
+            stats.self_time,
+            stats.self_count);
+    };
+    std::partial_sort(
+        lines.begin(),
+        lines.begin() + count,
+        lines.end(),
+        [&key](const LineStats &a, const LineStats &b) {
+            return key(a) > key(b);
+        });
+    lines.resize(count);
+    return lines;
+}
+
+void LineAggregator::reset() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    reset_counters();
+}
+
+unsigned long long LineAggregator::get_samples_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return samples_count;
+}
+
+LineAggregator::LineKey LineAggregator::intern(const Frame &frame) {
+    auto it = file_ids.find(frame.file_name);
+    if (it == file_ids.end()) {
+        it = file_ids
+                 .emplace(
+                     frame.file_name,
+                     static_cast<std::uint32_t>(file_names.size()))
+                 .first;
+        file_names.push_back(frame.file_name);
+    }
+    return (static_cast<LineKey>(it->second) << 32U) |
+           static_cast<std::uint32_t>(frame.line_number);
+}
+
+LineAggregator::Slot &LineAggregator::find_slot(LineKey key) {
+    // Keys are spread by a multiplicative hash, collisions are resolved by
+    // linear probing.
+    const auto mask  = slots.size() - 1;
+    const auto hash  = (key * 0x9E3779B97F4A7C15ULL) >> 32U;
+    auto       index = static_cast<std::size_t>(hash) & mask;
+    while (slots[index].key != key && slots[index].key != empty_key) {
+        index = (index + 1) & mask;
+    }
+    return slots[index];
+}
+
+void LineAggregator::grow() {
+    std::vector<Slot> old_slots(slots.size() * 2);
+    old_slots.swap(slots);
+    for (const auto &slot : old_slots) {
+        if (slot.key != empty_key) {
+            find_slot(slot.key) = slot;
+        }
+    }
+}
+
+void LineAggregator::count_stack(
+    const std::vector<LineKey> &stack,
+    std::chrono::nanoseconds    weight,
+    std::chrono::nanoseconds    cpu_time) {
+    if (stack.empty()) {
+        return;
+    }
+    samples_count++;
+    bool is_bottommost = true;
+    for (const auto key : stack) {
+        // Keep the load factor below 0.75.
+        if ((slots_used + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        auto &slot = find_slot(key);
+        if (slot.key == empty_key) {
+            slot.key = key;
+            slots_used++;
+        }
+        if (is_bottommost) {
+            slot.self_count++;
+            slot.self_time += weight;
+            slot.self_cpu_time += cpu_time;
+            is_bottommost = false;
+        }
+        if (slot.last_sample != samples_count) {
+            slot.total_count++;
+            slot.total_time += weight;
+            slot.total_cpu_time += cpu_time;
+            slot.last_sample = samples_count;
+        }
+    }
+}
+
+std::vector<LineStats> LineAggregator::collect(bool reset) {
+    std::vector<LineStats> lines;
+    lines.reserve(slots_used);
+    for (const auto &slot : slots) {
+        if (slot.key == empty_key) {
+            continue;
+        }
+        LineStats stats;
+        stats.file_name   = file_names[slot.key >> 32U];
+        stats.line_number = static_cast<int>(slot.key & 0xFFFFFFFFU);
+        stats.self_count  = slot.self_count;
+        stats.total_count = slot.total_count;
+        stats.self_time   = slot.self_time;
+        stats.total_time  = slot.total_time;
+        stats.self_cpu_time  = slot.self_cpu_time;
+        stats.total_cpu_time = slot.total_cpu_time;
+        lines.emplace_back(std::move(stats));
+    }
+    if (reset) {
+        reset_counters();
+    }
+    return lines;
+}
+
+void LineAggregator::reset_counters() {
+    // Interned file names and stacks of threads are kept, the stacks are
+    // needed for counting of subsequent unchanged traces. Stacks of threads
+    // that haven't been seen since the previous reset are dropped.
+    slots.assign(initial_capacity, Slot{});
+    slots_used    = 0;
+    samples_count = 0;
+    for (auto it = last_stacks.begin(); it != last_stacks.end();) {
+        if (it->second.is_seen) {
+            it->second.is_seen = false;
+            it++;
+        } else {
+            it = last_stacks.erase(it);
+        }
+    }
+}
@@ -0,0 +1,272 @@
+#include <boost/asio/ip/host_name.hpp>
+#include <spdlog/spdlog.h>
+
+#include "gauge/remote_sampling_collector.hpp"
+#include "gauge/utils/clock.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+RemoteSamplingCollector::RemoteSamplingCollector(
+    pid_t                               pid,
+    std::chrono::steady_clock::duration sampling_interval,
+    std::chrono::steady_clock::duration processing_interval)
+    : pid{pid}, logger{detail::get_logger()},
+      hostname{boost::asio::ip::host_name()},
+      sampling_interval{sampling_interval},
+      processing_interval{processing_interval}, is_stopped_flag{true},
+      is_paused_flag{false}, dropped_samples_count{0},
+      failed_samples_count{0},
+      pending_traces{
+          std::make_shared<std::vector<std::shared_ptr<TraceSample>>>()},
+      snapshotter{pid} {}
+
+RemoteSamplingCollector::~RemoteSamplingCollector() { finalize(); }
+
+void RemoteSamplingCollector::subscribe(
+    CallbackInterface &    callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(callback, options);
+}
+
+void RemoteSamplingCollector::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats>
+RemoteSamplingCollector::get_dispatch_stats() const {
+    return subscribers.get_dispatch_stats();
+}
+
+void RemoteSamplingCollector::start() {
+    SPDLOG_LOGGER_DEBUG(logger, "Starting remote sampling collector...");
+    const std::lock_guard<std::mutex> guard(thread_management_mutex);
+    if (!is_stopped_flag) {
+        throw CollectorHasAlreadyStarted();
+    }
+    is_stopped_flag  = false;
+    processor_thread = std::thread([this] { this->processor(); });
+    collector_thread = std::thread([this] { this->collector(); });
+    SPDLOG_LOGGER_DEBUG(logger, "Started sampling of the process #{}.", pid);
+}
+
+void RemoteSamplingCollector::stop() { finalize(); }
+
+bool RemoteSamplingCollector::is_stopped() const { return is_stopped_flag; }
+
+void RemoteSamplingCollector::resume() {
+    if (is_stopped()) {
+        throw CollectorIsStopped();
+    }
+    if (!is_paused_flag) {
+        throw CollectorIsNotPaused();
+    }
+    is_paused_flag = false;
+}
+
+bool RemoteSamplingCollector::is_paused() { return is_paused_flag; }
+
+void RemoteSamplingCollector::pause() {
+    if (is_paused_flag) {
+        throw CollectorIsAlreadyPaused();
+    }
+    is_paused_flag = true;
+}
+
+pid_t RemoteSamplingCollector::get_pid() const { return pid; }
+
+std::chrono::steady_clock::duration
+RemoteSamplingCollector::get_sampling_interval() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return sampling_interval;
+}
+
+void RemoteSamplingCollector::set_sampling_interval(
+    std::chrono::steady_clock::duration interval) noexcept {
+    const std::lock_guard<std::mutex> guard(mutex);
+    sampling_interval = interval;
+}
+
+unsigned long long
+RemoteSamplingCollector::get_dropped_samples_count() const {
+    return dropped_samples_count;
+}
+
+unsigned long long
+RemoteSamplingCollector::get_failed_samples_count() const {
+    return failed_samples_count;
+}
+
+void RemoteSamplingCollector::finalize() {
+    const std::lock_guard<std::mutex> thread_management_guard(
+        thread_management_mutex);
+    pybind11::gil_scoped_release release;
+    if (is_stopped_flag) {
+        return;
+    }
+    is_stopped_flag = true;
+    if (collector_thread.joinable()) {
+        collector_thread.join();
+    }
+    if (processor_thread.joinable()) {
+        processor_thread.join();
+        subscribers.flush();
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Stopped sampling of the process #{}.", pid);
+}
+
+void RemoteSamplingCollector::collector() {
+    SPDLOG_LOGGER_DEBUG(logger, "Launching sampling of the process...");
+    std::vector<std::shared_ptr<TraceSample>> traces;
+    const auto &clock              = detail::get_fast_clock();
+    auto        previous_timestamp = clock.now();
+    while (!is_stopped_flag) {
+        if (is_paused_flag) {
+            std::this_thread::sleep_for(pause_sleep_interval);
+            continue;
+        }
+        const auto current_timestamp = clock.now();
+        bool       has_sampling_interval_passed = false;
+        {
+            const std::lock_guard<std::mutex> guard(mutex);
+            has_sampling_interval_passed =
+                ((current_timestamp - previous_timestamp) >=
+                 sampling_interval);
+        }
+        if (!has_sampling_interval_passed) {
+            std::this_thread::sleep_for(sleep_interval);
+            continue;
+        }
+        previous_timestamp = current_timestamp;
+        traces.clear();
+        if (!collect_traces(current_timestamp, traces)) {
+            failed_samples_count++;
+            SPDLOG_LOGGER_TRACE(
+                logger,
+                "Couldn't copy threads of the process, skipping...");
+            continue;
+        }
+        const std::lock_guard<std::mutex> guard(mutex);
+        if (pending_traces->size() >= max_pending_traces) {
+            dropped_samples_count++;
+            continue;
+        }
+        pending_traces->insert(
+            pending_traces->end(),
+            traces.begin(),
+            traces.end());
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Sampling of the process has stopped.");
+}
+
+void RemoteSamplingCollector::processor() {
+    SPDLOG_LOGGER_DEBUG(logger, "Launching processing of remote samples...");
+    try {
+        auto previous_timestamp = std::chrono::steady_clock::now();
+        while (!is_stopped_flag) {
+            std::this_thread::sleep_for(sleep_interval);
+            detail::calibrate_clocks();
+            const auto current_timestamp = std::chrono::steady_clock::now();
+            if ((current_timestamp - previous_timestamp) <
+                processing_interval) {
+                continue;
+            }
+            previous_timestamp = current_timestamp;
+            process_traces();
+        }
+        process_traces();
+    } catch (const std::exception &e) {
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Processing of remote samples has stopped due to the exception: "
+            "\"{}\".",
+            e.what());
+        return;
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Processing of remote samples has stopped.");
+}
+
+void RemoteSamplingCollector::process_traces() {
+    auto traces =
+        std::make_shared<std::vector<std::shared_ptr<TraceSample>>>();
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        std::swap(traces, pending_traces);
+    }
+    if (traces->empty()) {
+        return;
+    }
+    // All of the traces of the batch are converted the same way.
+    const auto clocks_base_measurements =
+        detail::get_system_clock_mapping().get();
+    for (const auto &trace : *traces) {
+        trace->timestamp = TimePointConversionUtil::convert_time_point(
+            trace->monotonic_clock_timestamp,
+            clocks_base_measurements);
+    }
+    subscribers(traces);
+}
+
+bool RemoteSamplingCollector::collect_traces(
+    std::chrono::steady_clock::time_point      monotonic_clock_timestamp,
+    std::vector<std::shared_ptr<TraceSample>> &traces) {
+    if (!snapshotter.snapshot_threads(thread_snapshots)) {
+        return false;
+    }
+    for (const auto &thread : thread_snapshots) {
+        if (thread.state.frame == nullptr) {
+            continue;
+        }
+        const unsigned long long thread_id = thread.state.thread_id;
+        if (!snapshotter.snapshot_frames(thread, frame_snapshots)) {
+            SPDLOG_LOGGER_TRACE(
+                logger,
+                "Couldn't copy stack of thread #{}, skipping it...",
+                thread_id);
+            continue;
+        }
+        if (frame_snapshots.empty()) {
+            continue;
+        }
+        traces.emplace_back(construct_trace(
+            monotonic_clock_timestamp,
+            thread_id,
+            frame_snapshots));
+    }
+    return true;
+}
+
+std::shared_ptr<TraceSample> RemoteSamplingCollector::construct_trace(
+    std::chrono::steady_clock::time_point     monotonic_clock_timestamp,
+    unsigned long long                        thread_id,
+    const std::vector<detail::FrameSnapshot> &frames) const {
+    // The system clock timestamp is set when the batch is processed.
+    auto trace = std::make_shared<TraceSample>(
+        std::make_shared<std::vector<std::shared_ptr<Frame>>>(),
+        monotonic_clock_timestamp,
+        std::chrono::system_clock::time_point{},
+        thread_id,
+        static_cast<unsigned long long>(pid),
+        hostname);
+    trace->frames->reserve(frames.size());
+    for (const auto &snapshot : frames) {
+        auto frame           = std::make_shared<Frame>();
+        frame->symbolic_name = snapshot.code->name;
+        frame->file_name     = snapshot.code->file_name;
+        frame->line_number   = snapshot.code->get_line_number(snapshot.lasti);
+        frame->is_coroutine  = snapshot.is_coroutine;
+        frame->is_generator  = snapshot.is_generator;
+        frame->cookie        = snapshot.address;
+        trace->frames->emplace_back(std::move(frame));
+    }
+    return trace;
+}
+
+constexpr std::chrono::microseconds RemoteSamplingCollector::sleep_interval;
+constexpr std::chrono::milliseconds
+    RemoteSamplingCollector::pause_sleep_interval;
+constexpr std::size_t RemoteSamplingCollector::max_pending_traces;
@@ -1,19 +1,26 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <functional>
 #include <list>
+#include <map>
 #include <vector>
 
 #include <Python.h>
 
 #include <boost/asio/ip/host_name.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/process/environment.hpp>
 #include <spdlog/spdlog.h>
 
 #include "gauge/sampling_collector.hpp"
 #include "gauge/utils/benchmark.hpp"
 #include "gauge/utils/chrono.hpp"
+#include "gauge/utils/clock.hpp"
 #include "gauge/utils/common.hpp"
 #include "gauge/utils/gil.hpp"
 #include "gauge/utils/logging.hpp"
+#include "gauge/utils/tag_registry.hpp"
 
 using namespace gauge;
 
@@ -25,23 +32,36 @@ SamplingCollector::SamplingCollector(
     : is_stopped_flag{true}, is_paused_flag{false},
       ignore_own_threads_flag{ignore_own_threads},
       sampling_interval{sampling_interval},
-      processing_interval{processing_interval},
-      clocks_base_measurements{
-          TimePointConversionUtil::get_base_measurements()},
-      logger{detail::get_logger()},
-      py_context(py::reinterpret_steal<py::object>(PyContext_New())),
-      own_thread_ids{} {}
+      sampling_schedule{SamplingSchedule::Fixed},
+      processing_interval{processing_interval}, dropped_samples_count{0},
+      logger{detail::get_logger()}, collect_async_tasks_flag{false},
+      own_thread_ids{}, suppress_unchanged_stacks_flag{false},
+      cpu_time_sampling_flag{false}, skip_idle_threads_flag{false},
+      gil_sampling_flag{false}, flight_recording_flag{false},
+      is_dump_requested{false},
+      schedule_random_generator{std::random_device()()} {}
 
 SamplingCollector::~SamplingCollector() { finalize(); }
 
-void SamplingCollector::subscribe(CallbackInterface &callback) {
+void SamplingCollector::subscribe(
+    CallbackInterface &    callback,
+    const DispatchOptions &options) {
     const std::lock_guard<std::mutex> guard(mutex);
-    collect_callbacks.push_front(callback);
+    subscribers.subscribe(callback, options);
+    // The new subscriber has no base for unchanged traces.
+    stack_fingerprints.clear();
 }
 
-void SamplingCollector::subscribe(py::object callback) {
+void SamplingCollector::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
     const std::lock_guard<std::mutex> guard(mutex);
-    py_collect_callbacks.emplace_front(std::move(callback));
+    subscribers.subscribe(std::move(callback), options);
+    stack_fingerprints.clear();
+}
+
+std::vector<DispatchStats> SamplingCollector::get_dispatch_stats() const {
+    return subscribers.get_dispatch_stats();
 }
 
 void SamplingCollector::start() {
@@ -60,13 +80,8 @@ void SamplingCollector::stop() { finalize(); }
 bool SamplingCollector::is_stopped() const { return is_stopped_flag; }
 
 void SamplingCollector::register_own_thread() {
-    unsigned long long own_thread_id = 0;
-    {
-        detail::GILGuard gil_guard;
-        own_thread_id = py::cast<unsigned long long>(
-            py::module::import("threading").attr("get_ident")());
-    }
-    own_thread_ids.insert(own_thread_id);
+    // Same as threading.get_ident(), but doesn't require the GIL.
+    own_thread_ids.insert(PyThread_get_thread_ident());
 }
 
 bool SamplingCollector::check_if_own_thread(unsigned long long thread_id) {
@@ -96,6 +111,8 @@ void SamplingCollector::finalize(
     if (processor_thread.joinable() && join_processor_thread) {
         SPDLOG_LOGGER_TRACE(logger, "Joining the processor thread...");
         processor_thread.join();
+        SPDLOG_LOGGER_TRACE(logger, "Flushing queues of subscribers...");
+        subscribers.flush();
     }
     {
         const std::lock_guard<std::mutex> guard(mutex);
@@ -116,6 +133,63 @@ void SamplingCollector::set_sampling_interval(
     sampling_interval = interval;
 }
 
+void SamplingCollector::set_sampling_schedule(
+    SamplingSchedule schedule) noexcept {
+    const std::lock_guard<std::mutex> guard(mutex);
+    sampling_schedule = schedule;
+}
+
+SamplingSchedule SamplingCollector::get_sampling_schedule() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return sampling_schedule;
+}
+
+void SamplingCollector::set_context_vars(
+    const std::vector<py::object> &vars) {
+    std::vector<ContextVar> new_context_vars;
+    for (const auto &var : vars) {
+        if (!PyContextVar_CheckExact(var.ptr())) {
+            throw CollectorError();
+        }
+        new_context_vars.push_back(
+            ContextVar{var, var.attr("name").cast<std::string>()});
+    }
+    // Values of the replaced tags are released after the mutex, their
+    // finalizers could run Python code.
+    decltype(tags_cache) stale_tags;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        context_vars.swap(new_context_vars);
+        tags_cache.swap(stale_tags);
+    }
+}
+
+std::chrono::steady_clock::duration
+SamplingCollector::draw_sampling_interval() {
+    using Duration = std::chrono::steady_clock::duration;
+    const auto mean = static_cast<double>(sampling_interval.count());
+    switch (sampling_schedule) {
+    case SamplingSchedule::Jittered: {
+        std::uniform_real_distribution<double> distribution(
+            mean * 0.5,
+            mean * 1.5);
+        return Duration(static_cast<Duration::rep>(
+            distribution(schedule_random_generator)));
+    }
+    case SamplingSchedule::Exponential: {
+        if (mean <= 0) {
+            return Duration::zero();
+        }
+        std::exponential_distribution<double> distribution(1.0 / mean);
+        return Duration(static_cast<Duration::rep>(
+            distribution(schedule_random_generator)));
+    }
+    case SamplingSchedule::Fixed:
+    default:
+        return sampling_interval;
+    }
+}
+
 std::chrono::steady_clock::duration
 SamplingCollector::get_collection_interval() {
     const std::lock_guard<std::mutex> guard(mutex);
@@ -128,15 +202,441 @@ void SamplingCollector::set_collection_interval(
     processing_interval = interval;
 }
 
+void SamplingCollector::set_async_tasks_collection(bool enabled) {
+    auto tasks = py::object();
+    if (enabled) {
+        auto asyncio_tasks = py::module::import("asyncio.tasks");
+        auto all_tasks     = py::object();
+        if (py::hasattr(asyncio_tasks, "_all_tasks")) {
+            // Python 3.7+.
+            all_tasks = asyncio_tasks.attr("_all_tasks");
+        } else {
+            all_tasks = asyncio_tasks.attr("Task").attr("_all_tasks");
+        }
+        // Reference the underlying set of weakref.WeakSet so that it could
+        // be iterated without calling any Python code.
+        tasks = all_tasks.attr("data");
+        if (!PySet_Check(tasks.ptr())) {
+            throw CollectorError();
+        }
+    }
+    async_tasks              = std::move(tasks);
+    collect_async_tasks_flag = enabled;
+}
+
+bool SamplingCollector::is_collecting_async_tasks() {
+    return collect_async_tasks_flag;
+}
+
+ThreadFilter &SamplingCollector::get_thread_filter() { return thread_filter; }
+
+void SamplingCollector::set_unchanged_stacks_suppression(bool enabled) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    suppress_unchanged_stacks_flag = enabled;
+    stack_fingerprints.clear();
+}
+
+bool SamplingCollector::is_suppressing_unchanged_stacks() {
+    return suppress_unchanged_stacks_flag;
+}
+
+void SamplingCollector::set_gil_free_sampling(bool enabled) {
+    std::shared_ptr<detail::FrameSnapshotter> snapshotter;
+    if (enabled) {
+        snapshotter = std::make_shared<detail::FrameSnapshotter>(
+            PyThreadState_Get()->interp);
+    }
+    const std::lock_guard<std::mutex> guard(mutex);
+    frame_snapshotter = std::move(snapshotter);
+}
+
+bool SamplingCollector::is_gil_free_sampling() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return frame_snapshotter != nullptr;
+}
+
+void SamplingCollector::set_cpu_time_sampling(
+    bool enabled,
+    bool skip_idle_threads) {
+    if (enabled && !detail::ThreadCPUClocks::is_supported()) {
+        throw CollectorError();
+    }
+    const std::lock_guard<std::mutex> guard(mutex);
+    cpu_clocks.clear();
+    cpu_time_sampling_flag = enabled;
+    skip_idle_threads_flag = skip_idle_threads;
+}
+
+bool SamplingCollector::is_cpu_time_sampling() {
+    return cpu_time_sampling_flag;
+}
+
+void SamplingCollector::set_gil_sampling(bool enabled) {
+#if PY_VERSION_HEX >= 0x030C0000
+    // The current thread state is thread-local since Python 3.12, so
+    // the holder of the GIL can't be found from another thread.
+    if (enabled) {
+        throw CollectorError();
+    }
+#endif
+    gil_sampling_flag = enabled;
+}
+
+bool SamplingCollector::is_gil_sampling() { return gil_sampling_flag; }
+
+unsigned long long SamplingCollector::get_dropped_samples_count() const {
+    return dropped_samples_count;
+}
+
+void SamplingCollector::set_flight_recording(
+    bool        enabled,
+    std::size_t capacity) {
+    const std::lock_guard<std::mutex> guard(flight_recorder_mutex);
+    // Recorded frames aren't referenced, so they could be released
+    // without the GIL.
+    recorded_samples.clear();
+    recorded_frames.clear();
+    recorded_tags.clear();
+    recorded_samples.set_capacity(enabled ? capacity : 0);
+    recorded_frames.set_capacity(enabled ? capacity : 0);
+    recorded_tags.set_capacity(enabled ? capacity : 0);
+    recorded_frames_count  = 0;
+    recorded_tags_count    = 0;
+    stacks_pruned_at_frame = 0;
+    recorded_codes.clear();
+    recorded_code_ids.clear();
+    recorded_stacks.clear();
+    flight_recording_flag = enabled;
+}
+
+bool SamplingCollector::is_flight_recording() {
+    return flight_recording_flag;
+}
+
+std::size_t SamplingCollector::dump(
+    const std::string &                 path,
+    std::chrono::steady_clock::duration window) {
+    const auto traces = get_recorded_traces(window);
+
+    // Stacks are written from the topmost frame to the bottommost one and
+    // identical stacks are counted together. Recorded unchanged stacks are
+    // already resolved into whole ones.
+    std::map<std::string, unsigned long long> stacks;
+    for (const auto &trace : traces) {
+        std::string stack;
+        for (auto it = trace->frames->rbegin(); it != trace->frames->rend();
+             it++) {
+            if (!stack.empty()) {
+                stack += ';';
+            }
+            stack += fmt::format(
+                "{} ({}:{})",
+                (*it)->symbolic_name,
+                (*it)->file_name,
+                (*it)->line_number);
+        }
+        stacks[stack]++;
+    }
+    const auto count = traces.size();
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    for (const auto &item : stacks) {
+        file << item.first << ' ' << item.second << '\n';
+    }
+    file.close();
+    if (file.fail()) {
+        throw CollectorError();
+    }
+    SPDLOG_LOGGER_INFO(
+        logger,
+        "Dumped {} recorded samples to \"{}\".",
+        count,
+        path);
+    return count;
+}
+
+std::size_t
+SamplingCollector::replay(std::chrono::steady_clock::duration window) {
+    auto traces = std::make_shared<std::vector<std::shared_ptr<TraceSample>>>(
+        get_recorded_traces(window));
+    if (!traces->empty()) {
+        subscribers(traces);
+    }
+    return traces->size();
+}
+
+void SamplingCollector::set_dump_watchdog(
+    const std::vector<py::object> &     functions,
+    std::chrono::steady_clock::duration threshold,
+    const std::string &                 path,
+    std::chrono::steady_clock::duration window) {
+    std::vector<detail::CodeInfo> infos;
+    for (const auto &function : functions) {
+        auto code_object = function;
+        if (!PyCode_Check(code_object.ptr())) {
+            code_object = function.attr("__code__");
+            if (!PyCode_Check(code_object.ptr())) {
+                throw CollectorError();
+            }
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto code = reinterpret_cast<PyCodeObject *>(code_object.ptr());
+        detail::CodeInfo info;
+        info.name              = detail::safe_encode(code->co_name);
+        info.file_name         = detail::safe_encode(code->co_filename);
+        info.first_line_number = code->co_firstlineno;
+        infos.emplace_back(std::move(info));
+    }
+    const std::lock_guard<std::mutex> guard(mutex);
+    watched_functions  = std::move(infos);
+    watchdog_threshold = threshold;
+    watchdog_path      = path;
+    watchdog_window    = window;
+    watched_calls.clear();
+    is_watched_cache.clear();
+}
+
+void SamplingCollector::record_frames(std::vector<RawFrame> &frames) {
+    watch_calls(frames);
+    if (std::any_of(frames.begin(), frames.end(), [](const RawFrame &frame) {
+            return frame.frame != nullptr;
+        })) {
+        // Recorded frames could stay in the buffer for a long time, so
+        // they must not keep frame objects alive.
+        const detail::GILGuard gil_guard;
+        for (auto &frame : frames) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            Py_XDECREF(reinterpret_cast<PyObject *>(frame.frame));
+            frame.frame = nullptr;
+        }
+    }
+    const std::lock_guard<std::mutex> guard(flight_recorder_mutex);
+    if (recorded_frames.capacity() == 0) {
+        // The recorder has been disabled meanwhile.
+        frames.clear();
+        return;
+    }
+    const auto oldest_frame = [this] {
+        return recorded_frames_count - recorded_frames.size();
+    };
+    std::size_t i = 0;
+    while (i < frames.size()) {
+        const auto &   bottommost = frames[i];
+        RecordedSample sample;
+        sample.monotonic_clock_timestamp =
+            bottommost.monotonic_clock_timestamp;
+        sample.thread_id = bottommost.thread_id;
+        sample.cpu_time  = bottommost.cpu_time;
+        sample.gil_state = bottommost.gil_state;
+        sample.gil_wait  = bottommost.gil_wait;
+        sample.weight    = bottommost.weight;
+        if (bottommost.is_unchanged) {
+            i++;
+            auto it = recorded_stacks.find(sample.thread_id);
+            if (it == recorded_stacks.end() ||
+                it->second.first_frame < oldest_frame()) {
+                // There is nothing to resolve the stack with.
+                continue;
+            }
+            sample.first_frame  = it->second.first_frame;
+            sample.frames_count = it->second.frames_count;
+        } else {
+            sample.first_frame = recorded_frames_count;
+            while (i < frames.size()) {
+                const auto &  frame = frames[i++];
+                RecordedFrame recorded_frame;
+                recorded_frame.cookie  = frame.cookie;
+                recorded_frame.code_id = intern_recorded_code(frame.code);
+                recorded_frame.line_number =
+                    frame.code->get_line_number(frame.lasti);
+                recorded_frame.is_coroutine = frame.is_coroutine;
+                recorded_frame.is_generator = frame.is_generator;
+                recorded_frames.push_back(recorded_frame);
+                recorded_frames_count++;
+                sample.frames_count++;
+                if (frame.is_topmost) {
+                    break;
+                }
+            }
+            recorded_stacks[sample.thread_id] =
+                RecordedStack{sample.first_frame, sample.frames_count};
+        }
+        sample.first_tag = recorded_tags_count;
+        for (const auto tag : bottommost.tags) {
+            recorded_tags.push_back(tag);
+            recorded_tags_count++;
+            sample.tags_count++;
+        }
+        recorded_samples.push_back(sample);
+    }
+    frames.clear();
+
+    if (recorded_frames_count - stacks_pruned_at_frame >=
+        recorded_frames.capacity()) {
+        // Forget stacks of exited threads.
+        for (auto it = recorded_stacks.begin(); it != recorded_stacks.end();) {
+            if (it->second.first_frame < oldest_frame()) {
+                it = recorded_stacks.erase(it);
+            } else {
+                it++;
+            }
+        }
+        stacks_pruned_at_frame = recorded_frames_count;
+    }
+}
+
+std::uint32_t SamplingCollector::intern_recorded_code(
+    const std::shared_ptr<const detail::CodeInfo> &code) {
+    auto it = recorded_code_ids.find(code.get());
+    if (it == recorded_code_ids.end()) {
+        it = recorded_code_ids
+                 .emplace(
+                     code.get(),
+                     static_cast<std::uint32_t>(recorded_codes.size()))
+                 .first;
+        // Codes are kept alive, so their addresses aren't reused.
+        recorded_codes.push_back(code);
+    }
+    return it->second;
+}
+
+void SamplingCollector::watch_calls(const std::vector<RawFrame> &frames) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (watched_functions.empty()) {
+        return;
+    }
+    watchdog_sample_count++;
+    for (std::size_t begin = 0; begin < frames.size();) {
+        // Frames of a sample go from the bottommost to the topmost one.
+        auto end = begin;
+        while (!frames[end].is_topmost) {
+            end++;
+        }
+        end++;
+        const auto &bottommost = frames[begin];
+        auto        it         = watched_calls.find(bottommost.thread_id);
+        if (!bottommost.is_unchanged) {
+            // Look for the outermost call of a watched function.
+            bool               is_found = false;
+            unsigned long long cookie   = 0;
+            for (auto i = end; i != begin; i--) {
+                if (is_watched(frames[i - 1].code)) {
+                    is_found = true;
+                    cookie   = frames[i - 1].cookie;
+                    break;
+                }
+            }
+            if (!is_found) {
+                if (it != watched_calls.end()) {
+                    watched_calls.erase(it);
+                }
+                begin = end;
+                continue;
+            }
+            if (it == watched_calls.end() || it->second.cookie != cookie) {
+                WatchedCall call;
+                call.cookie = cookie;
+                call.since  = bottommost.monotonic_clock_timestamp;
+                it = watched_calls.emplace(bottommost.thread_id, call).first;
+                it->second = call;
+            }
+        }
+        begin = end;
+        if (it == watched_calls.end()) {
+            continue;
+        }
+        auto &call        = it->second;
+        call.sample_count = watchdog_sample_count;
+        if (!call.is_triggered &&
+            (bottommost.monotonic_clock_timestamp - call.since) >=
+                watchdog_threshold) {
+            SPDLOG_LOGGER_INFO(
+                logger,
+                "Call in thread #{} has exceeded the threshold, requesting "
+                "a dump...",
+                bottommost.thread_id);
+            call.is_triggered = true;
+            is_dump_requested = true;
+        }
+    }
+    // Forget calls of threads that weren't sampled this time.
+    for (auto it = watched_calls.begin(); it != watched_calls.end();) {
+        if (it->second.sample_count != watchdog_sample_count) {
+            it = watched_calls.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+bool SamplingCollector::is_watched(
+    const std::shared_ptr<const detail::CodeInfo> &code) {
+    auto it = is_watched_cache.find(code.get());
+    if (it != is_watched_cache.end()) {
+        return it->second.second;
+    }
+    // Entries keep their code alive so that the address isn't reused, let's
+    // not allow the cache to grow unbounded.
+    static constexpr auto max_cache_size = 100000;
+    if (is_watched_cache.size() >= max_cache_size) {
+        is_watched_cache.clear();
+    }
+    const auto is_watched = std::any_of(
+        watched_functions.begin(),
+        watched_functions.end(),
+        [&code](const detail::CodeInfo &function) {
+            return function.first_line_number == code->first_line_number &&
+                   function.name == code->name &&
+                   function.file_name == code->file_name;
+        });
+    is_watched_cache.emplace(code.get(), std::make_pair(code, is_watched));
+    return is_watched;
+}
+
+std::vector<std::shared_ptr<TraceSample>>
+SamplingCollector::get_recorded_traces(
+    std::chrono::steady_clock::duration window) {
+    std::vector<std::shared_ptr<TraceSample>> traces;
+    const std::lock_guard<std::mutex>         guard(flight_recorder_mutex);
+    if (recorded_samples.empty()) {
+        return traces;
+    }
+    const auto cutoff =
+        recorded_samples.back().monotonic_clock_timestamp - window;
+    const auto oldest_frame = recorded_frames_count - recorded_frames.size();
+    const auto oldest_tag   = recorded_tags_count - recorded_tags.size();
+    const auto clocks_base_measurements =
+        detail::get_system_clock_mapping().get();
+    for (const auto &sample : recorded_samples) {
+        // Skip samples out of the window and the ones which frames or tags
+        // have been overwritten.
+        if ((window != std::chrono::steady_clock::duration::zero() &&
+             sample.monotonic_clock_timestamp < cutoff) ||
+            sample.first_frame < oldest_frame ||
+            sample.first_tag < oldest_tag) {
+            continue;
+        }
+        traces.emplace_back(construct_trace(sample, clocks_base_measurements));
+    }
+    return traces;
+}
+
 void SamplingCollector::collector() {
-    auto previous_timestamp           = std::chrono::steady_clock::now();
-    bool has_sampling_interval_passed = false;
+    const auto &clock = detail::get_fast_clock();
+    // Samples are scheduled at absolute time-points, so that time spent on
+    // sampling doesn't stretch intervals of the schedule.
+    auto previous_sample_timestamp = clock.now();
+    auto next_sample_timestamp     = previous_sample_timestamp;
 
     SPDLOG_LOGGER_DEBUG(logger, "Launching profile data sampling...");
     {
         const std::lock_guard<std::mutex> guard(mutex);
         register_own_thread();
     }
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        next_sample_timestamp += draw_sampling_interval();
+    }
     std::vector<RawFrame> frames_buffer;
     // Essentially vector with reserved memory is used as a memory pool.
     frames_buffer.reserve(frames_buffer_reserve);
@@ -150,20 +650,33 @@ void SamplingCollector::collector() {
         }
         if (is_paused_flag) {
             std::this_thread::sleep_for(pause_sleep_interval);
-            continue;
-        }
-        auto current_timestamp = std::chrono::steady_clock::now();
-        {
+            // Time of the pause isn't attributed to the next sample.
             const std::lock_guard<std::mutex> guard(mutex);
-            has_sampling_interval_passed =
-                ((current_timestamp - previous_timestamp) >=
-                 sampling_interval);
+            previous_sample_timestamp = clock.now();
+            next_sample_timestamp =
+                previous_sample_timestamp + draw_sampling_interval();
+            continue;
         }
-        previous_timestamp = current_timestamp;
-        if (has_sampling_interval_passed) {
+        auto current_timestamp = clock.now();
+        if (current_timestamp >= next_sample_timestamp) {
+            const auto weight =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    current_timestamp - previous_sample_timestamp);
+            previous_sample_timestamp = current_timestamp;
+            {
+                const std::lock_guard<std::mutex> guard(mutex);
+                next_sample_timestamp =
+                    current_timestamp + draw_sampling_interval();
+            }
             std::this_thread::sleep_for(half_sleep_interval);
             //            timer.start("collect_frames");
             auto result = collect_frames(current_timestamp, frames_buffer);
+            if (result && collect_async_tasks_flag) {
+                result = collect_task_frames(current_timestamp, frames_buffer);
+            }
+            for (auto &frame : frames_buffer) {
+                frame.weight = weight;
+            }
             //            timer.stop("collect_frames");
             //            if ((std::chrono::steady_clock::now() - t1) >=
             //            profile_interval) {
@@ -181,12 +694,44 @@ void SamplingCollector::collector() {
                 continue;
             }
 
-            const std::lock_guard<std::mutex> guard(mutex);
-            raw_frames.insert(
-                raw_frames.end(),
-                std::make_move_iterator(frames_buffer.begin()),
-                std::make_move_iterator(frames_buffer.end()));
-            frames_buffer.clear();
+            if (flight_recording_flag) {
+                record_frames(frames_buffer);
+            } else {
+                const std::lock_guard<std::mutex> guard(mutex);
+                if (raw_frames.size() < max_raw_frames) {
+                    raw_frames.insert(
+                        raw_frames.end(),
+                        std::make_move_iterator(frames_buffer.begin()),
+                        std::make_move_iterator(frames_buffer.end()));
+                    frames_buffer.clear();
+                }
+            }
+            if (!frames_buffer.empty()) {
+                // Processing has fallen behind, keep the memory bounded.
+                dropped_samples_count++;
+                SPDLOG_LOGGER_TRACE(
+                    logger,
+                    "Too many unprocessed frames, dropping the sample...");
+                {
+                    // Following unchanged traces of the threads would
+                    // extend stacks of older samples.
+                    const std::lock_guard<std::mutex> guard(mutex);
+                    for (const auto &frame : frames_buffer) {
+                        stack_fingerprints.erase(frame.thread_id);
+                    }
+                }
+                // Referenced frames have to be released with the GIL held.
+                std::unique_ptr<detail::GILGuard> gil_guard;
+                if (std::any_of(
+                        frames_buffer.begin(),
+                        frames_buffer.end(),
+                        [](const RawFrame &frame) {
+                            return frame.frame != nullptr;
+                        })) {
+                    gil_guard = std::make_unique<detail::GILGuard>();
+                }
+                frames_buffer.clear();
+            }
             if (frames_buffer.capacity() != frames_buffer_reserve) {
                 SPDLOG_LOGGER_TRACE(
                     logger,
@@ -196,7 +741,10 @@ void SamplingCollector::collector() {
                 frames_buffer.reserve(frames_buffer_reserve);
             }
         } else {
-            std::this_thread::sleep_for(sleep_interval);
+            // Sleeps are short, so that stopping and pausing aren't delayed.
+            std::this_thread::sleep_for(std::min(
+                next_sample_timestamp - current_timestamp,
+                std::chrono::steady_clock::duration(sleep_interval)));
         }
     }
     SPDLOG_LOGGER_DEBUG(logger, "Profile data sampling has stopped.");
@@ -221,6 +769,29 @@ void SamplingCollector::processor() {
                 continue;
             }
             std::this_thread::sleep_for(sleep_interval);
+            detail::calibrate_clocks();
+
+            if (is_dump_requested.exchange(false)) {
+                std::string                         path;
+                std::chrono::steady_clock::duration window{0};
+                {
+                    const std::lock_guard<std::mutex> guard(mutex);
+                    path   = watchdog_path;
+                    window = watchdog_window;
+                }
+                try {
+                    if (path.empty()) {
+                        replay(window);
+                    } else {
+                        dump(path, window);
+                    }
+                } catch (const CollectorError &) {
+                    SPDLOG_LOGGER_ERROR(
+                        logger,
+                        "Couldn't dump recorded samples to \"{}\".",
+                        path);
+                }
+            }
 
             if (!is_stopped_flag) {
                 auto current_processing_timestamp =
@@ -240,6 +811,10 @@ void SamplingCollector::processor() {
 
             auto begin = raw_frames.begin();
             auto end   = raw_frames.end();
+            if (begin == end) {
+                // Could happen if all of the threads are filtered out.
+                continue;
+            }
 
 #ifndef NDEBUG
             {
@@ -257,6 +832,9 @@ void SamplingCollector::processor() {
 #endif
             auto traces =
                 std::make_shared<std::vector<std::shared_ptr<TraceSample>>>();
+            // All of the traces of the batch are converted the same way.
+            const auto clocks_base_measurements =
+                detail::get_system_clock_mapping().get();
 
             SPDLOG_LOGGER_TRACE(logger, "Processing raw traces...");
             auto last_topmost_frame = end;
@@ -271,9 +849,11 @@ void SamplingCollector::processor() {
             last_topmost_frame--;
             // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
             BOOST_ASSERT(begin == end || last_topmost_frame->is_topmost);
+            bool has_references = false;
             for (auto it = begin; it != end;) {
                 auto frames = std::vector<RawFrame *>();
                 while (true) {
+                    has_references = has_references || it->frame != nullptr;
                     frames.emplace_back(&(*it));
                     if (it->is_topmost) {
                         it++;
@@ -283,21 +863,16 @@ void SamplingCollector::processor() {
                 }
                 // Extract necessary information from the raw data
                 // into specialized structures.
-                auto trace = construct_trace(frames);
-                {
-                    const std::lock_guard<std::mutex> guard(mutex);
-                    if (check_if_own_thread(trace->thread_id)) {
-                        SPDLOG_LOGGER_TRACE(
-                            logger,
-                            "Skipping trace with thread ID \"{}\" as own...",
-                            trace->thread_id);
-                        continue;
-                    }
-                }
+                auto trace = construct_trace(frames, clocks_base_measurements);
                 traces->emplace_back(std::move(trace));
             }
             {
-                detail::GILGuard gil_guard;
+                // Referenced frames have to be released with the GIL held.
+                std::unique_ptr<detail::GILGuard> gil_guard;
+                if (has_references) {
+                    gil_guard = std::make_unique<detail::GILGuard>();
+                }
+                const std::lock_guard<std::mutex> guard(mutex);
                 raw_frames.erase(begin, end);
             }
             SPDLOG_LOGGER_TRACE(logger, "Processed raw traces.");
@@ -316,40 +891,13 @@ void SamplingCollector::processor() {
             }
 #endif
             if (!traces->empty()) {
-                if (!collect_callbacks.empty()) {
-                    SPDLOG_LOGGER_TRACE(logger, "Calling callbacks...");
-                    for (auto &callback : collect_callbacks) {
-                        callback(traces);
-                    }
-                    SPDLOG_LOGGER_TRACE(
-                        logger,
-                        "Completed calling callbacks.");
-                }
-                if (!py_collect_callbacks.empty()) {
-                    SPDLOG_LOGGER_TRACE(logger, "Calling Python callbacks...");
-                    for (const auto &callback : py_collect_callbacks) {
-                        detail::GILGuard gil_guard;
-                        int              error_code = 0;
-                        error_code = PyContext_Enter(py_context.ptr());
-                        if (error_code != 0) {
-                            auto msg = "Failed to enter Python "
-                                       "contextvars context.";
-                            SPDLOG_LOGGER_ERROR(logger, msg);
-                            throw std::runtime_error(msg);
-                        }
-                        (*callback)(traces);
-                        error_code = PyContext_Exit(py_context.ptr());
-                        if (error_code != 0) {
-                            auto msg = "Failed to exit Python "
-                                       "contextvars context.";
-                            SPDLOG_LOGGER_ERROR(logger, msg);
-                            throw std::runtime_error(msg);
-                        }
-                    }
-                    SPDLOG_LOGGER_TRACE(
-                        logger,
-                        "Completed calling Python callbacks.");
-                }
+                subscribers(traces);
+            }
+            if (subscribers.check_dropped_batches()) {
+                // Queued subscribers have missed whole stacks, which
+                // the following unchanged traces would refer to.
+                const std::lock_guard<std::mutex> guard(mutex);
+                stack_fingerprints.clear();
             }
         }
     } catch (const std::exception &e) {
@@ -363,31 +911,111 @@ void SamplingCollector::processor() {
     SPDLOG_LOGGER_DEBUG(logger, "Processing has stopped.");
 }
 
-// TODO: It is possible to re-implement it using:
-//       https://docs.python.org/3/c-api/init.html#advanced-debugger-support
-//       This way also context ID could be retrieved to be used as an
-//       additional frame attribute along with process_id and so on. If it
-//       could be useful at all.
 bool SamplingCollector::collect_frames(
     std::chrono::steady_clock::time_point monotonic_clock_timestamp,
     std::vector<RawFrame> &               frames) {
+    std::shared_ptr<detail::FrameSnapshotter> snapshotter;
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        snapshotter = frame_snapshotter;
+    }
+    if (snapshotter) {
+        return snapshot_frames(
+            *snapshotter,
+            monotonic_clock_timestamp,
+            frames);
+    }
+    // The holder is found before the GIL is requested. Python code doesn't
+    // run while the collector holds the GIL, so the holder's stack stays
+    // where it has released the GIL.
+    const bool     is_sampling_gil = gil_sampling_flag;
+    PyThreadState *gil_holder      = nullptr;
+    auto           gil_wait        = std::chrono::nanoseconds(0);
+
+    std::chrono::steady_clock::time_point gil_request_timestamp;
+    if (is_sampling_gil) {
+        gil_holder            = _PyThreadState_UncheckedGet();
+        gil_request_timestamp = detail::get_fast_clock().now_precise();
+    }
     detail::GILGuard gil_guard;
-    PyObject *       raw_frames = _PyThread_CurrentFrames();
-    if (raw_frames == nullptr) {
-        return false;
+    if (gil_holder != nullptr) {
+        gil_wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            detail::get_fast_clock().now_precise() - gil_request_timestamp);
     }
+    // Walk thread states directly instead of using _PyThread_CurrentFrames()
+    // so that filtered out threads' frames are not touched at all.
+    auto interpreter = PyThreadState_Get()->interp;
 
-    PyObject * thread_id = nullptr, *value = nullptr;
-    Py_ssize_t position = 0;
-    while (PyDict_Next(raw_frames, &position, &thread_id, &value)) {
-        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-        auto frame         = reinterpret_cast<PyFrameObject *>(value);
-        bool is_bottommost = true;
+    // Released after the mutex, like in set_context_vars().
+    decltype(tags_cache) stale_tags;
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (tags_cache.size() >= tags_cache_capacity) {
+        tags_cache.swap(stale_tags);
+    }
+    for (auto thread_state = PyInterpreterState_ThreadHead(interpreter);
+         thread_state != nullptr;
+         thread_state = PyThreadState_Next(thread_state)) {
+        auto frame = thread_state->frame;
+        if (frame == nullptr) {
+            continue;
+        }
+        const unsigned long long thread_id = thread_state->thread_id;
+        if (ignore_own_threads_flag && check_if_own_thread(thread_id)) {
+            continue;
+        }
+        if (!thread_filter.is_sampled(thread_state)) {
+            continue;
+        }
+        // The holder could have exited and its thread state could have been
+        // reused by a new thread, which is harmless.
+        const auto gil_state =
+            !is_sampling_gil ? GILState::Unknown
+                             : thread_state == gil_holder ? GILState::Holding
+                                                          : GILState::Released;
+        auto cpu_time = std::chrono::nanoseconds(0);
+        if (cpu_time_sampling_flag) {
+            bool is_idle = false;
+            if (!measure_cpu_time(
+                    detail::get_unique_thread_id(thread_state),
+                    thread_id,
+                    cpu_time,
+                    is_idle)) {
+                continue;
+            }
+            // A thread could hold the GIL without running, e.g. while
+            // sleeping in an extension.
+            if (is_idle && gil_state != GILState::Holding &&
+                skip_idle_thread(
+                    monotonic_clock_timestamp,
+                    thread_id,
+                    frames)) {
+                continue;
+            }
+        }
+        std::vector<unsigned int> tags;
+        if (!context_vars.empty()) {
+            read_tags(thread_state, tags);
+        }
+        if (suppress_unchanged_stacks_flag &&
+            is_stack_unchanged(thread_id, fingerprint_stack(frame))) {
+            frames.emplace_back(monotonic_clock_timestamp, thread_id);
+            frames.back().cpu_time  = cpu_time;
+            frames.back().gil_state = gil_state;
+            if (gil_state == GILState::Holding) {
+                frames.back().gil_wait = gil_wait;
+            }
+            frames.back().tags = std::move(tags);
+            continue;
+        }
+        const auto bottommost_index = frames.size();
+        bool       is_bottommost    = true;
         bool is_topmost    = false;
         while (frame != nullptr) {
             is_topmost = frame->f_back == nullptr;
             frames.emplace_back(
                 frame,
+                code_registry.get(frame->f_code),
                 monotonic_clock_timestamp,
                 thread_id,
                 is_topmost,
@@ -395,19 +1023,381 @@ bool SamplingCollector::collect_frames(
             is_bottommost = false;
             frame         = frame->f_back;
         }
+        frames[bottommost_index].cpu_time  = cpu_time;
+        frames[bottommost_index].gil_state = gil_state;
+        if (gil_state == GILState::Holding) {
+            frames[bottommost_index].gil_wait = gil_wait;
+        }
+        frames[bottommost_index].tags = std::move(tags);
+    }
+    forget_stale_fingerprints();
+    if (cpu_time_sampling_flag) {
+        cpu_clocks.forget_stale_clocks();
     }
     return true;
 }
 
+void SamplingCollector::read_tags(
+    PyThreadState *            thread_state,
+    std::vector<unsigned int> &tags) {
+    auto *context = thread_state->context;
+    if (context == nullptr) {
+        // The thread hasn't touched any context variables yet.
+        return;
+    }
+    for (std::size_t i = 0; i < context_vars.size(); i++) {
+        auto *var = context_vars[i].var.ptr();
+        // Checked first, since a missing key would raise an exception.
+        if (PySequence_Contains(context, var) != 1) {
+            PyErr_Clear();
+            continue;
+        }
+        auto *value = PyObject_GetItem(context, var);
+        if (value == nullptr) {
+            PyErr_Clear();
+            continue;
+        }
+        auto object = py::reinterpret_steal<py::object>(value);
+        auto it     = tags_cache.find(TagKey{i, value});
+        if (it == tags_cache.end()) {
+            // The value is converted to a string only when it's first seen.
+            const auto id = detail::get_tag_registry().intern(
+                context_vars[i].name,
+                format_tag_value(value));
+            it = tags_cache.emplace(TagKey{i, value}, CachedTag{object, id})
+                     .first;
+        }
+        if (it->second.id != 0) {
+            tags.push_back(it->second.id);
+        }
+    }
+}
+
+std::string SamplingCollector::format_tag_value(PyObject *value) {
+    if (PyUnicode_CheckExact(value)) {
+        Py_ssize_t  size = 0;
+        const auto *data = PyUnicode_AsUTF8AndSize(value, &size);
+        if (data != nullptr) {
+            return std::string(data, static_cast<std::size_t>(size));
+        }
+        PyErr_Clear();
+    } else if (PyBool_Check(value)) {
+        return value == Py_True ? "True" : "False";
+    } else if (PyLong_CheckExact(value)) {
+        int        overflow = 0;
+        const auto number   = PyLong_AsLongLongAndOverflow(value, &overflow);
+        if (overflow == 0) {
+            return std::to_string(number);
+        }
+        // Formatting of exact integers doesn't run Python code either.
+        auto *string = PyObject_Str(value);
+        if (string != nullptr) {
+            return py::reinterpret_steal<py::str>(string).cast<std::string>();
+        }
+        PyErr_Clear();
+    } else if (PyFloat_CheckExact(value)) {
+        // Formatted the same way as by repr().
+        auto *string = PyOS_double_to_string(
+            PyFloat_AS_DOUBLE(value), 'r', 0, Py_DTSF_ADD_DOT_0, nullptr);
+        if (string != nullptr) {
+            std::string result(string);
+            PyMem_Free(string);
+            return result;
+        }
+        PyErr_Clear();
+    }
+    // Converting other values could run Python code, e.g. __str__().
+    return fmt::format("<{}>", Py_TYPE(value)->tp_name);
+}
+
+bool SamplingCollector::snapshot_frames(
+    detail::FrameSnapshotter &            snapshotter,
+    std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+    std::vector<RawFrame> &               frames) {
+    const bool is_sampling_gil = gil_sampling_flag;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto gil_holder = reinterpret_cast<std::uintptr_t>(
+        is_sampling_gil ? _PyThreadState_UncheckedGet() : nullptr);
+    if (!snapshotter.snapshot_threads(thread_snapshots)) {
+        return false;
+    }
+    for (auto &thread : thread_snapshots) {
+        if (thread.state.frame == nullptr) {
+            continue;
+        }
+        const unsigned long long thread_id = thread.state.thread_id;
+        {
+            const std::lock_guard<std::mutex> guard(mutex);
+            if (ignore_own_threads_flag && check_if_own_thread(thread_id)) {
+                continue;
+            }
+        }
+        // Might take the GIL once for each new thread to resolve its name,
+        // so the mutex must not be held.
+        if (!thread_filter.is_sampled(&thread.state)) {
+            continue;
+        }
+        const auto gil_state =
+            !is_sampling_gil ? GILState::Unknown
+                             : thread.address == gil_holder
+                                   ? GILState::Holding
+                                   : GILState::Released;
+        auto cpu_time = std::chrono::nanoseconds(0);
+        if (cpu_time_sampling_flag) {
+            const auto unique_id = detail::get_unique_thread_id(&thread.state);
+            // Clock of a new thread is resolved by its pthread_t, which is
+            // valid only while the thread state is alive. That is
+            // guaranteed only while the GIL is held.
+            std::unique_ptr<detail::GILGuard> gil_guard;
+            bool                              has_clock = false;
+            {
+                const std::lock_guard<std::mutex> guard(mutex);
+                has_clock = cpu_clocks.has_clock(unique_id);
+            }
+            if (!has_clock) {
+                gil_guard = std::make_unique<detail::GILGuard>();
+                if (!is_thread_alive(thread)) {
+                    continue;
+                }
+            }
+            const std::lock_guard<std::mutex> guard(mutex);
+            bool                              is_idle = false;
+            if (!measure_cpu_time(unique_id, thread_id, cpu_time, is_idle)) {
+                continue;
+            }
+            if (is_idle && gil_state != GILState::Holding &&
+                skip_idle_thread(
+                    monotonic_clock_timestamp,
+                    thread_id,
+                    frames)) {
+                continue;
+            }
+        }
+        if (!snapshotter.snapshot_frames(thread, frame_snapshots)) {
+            SPDLOG_LOGGER_TRACE(
+                logger,
+                "Couldn't copy stack of thread #{}, skipping it...",
+                thread_id);
+            continue;
+        }
+        if (frame_snapshots.empty()) {
+            continue;
+        }
+        if (suppress_unchanged_stacks_flag) {
+            const std::lock_guard<std::mutex> guard(mutex);
+            if (is_stack_unchanged(
+                    thread_id,
+                    fingerprint_stack(frame_snapshots))) {
+                frames.emplace_back(monotonic_clock_timestamp, thread_id);
+                frames.back().cpu_time  = cpu_time;
+                frames.back().gil_state = gil_state;
+                continue;
+            }
+        }
+        const auto bottommost_index = frames.size();
+        const auto last             = frame_snapshots.size() - 1;
+        for (std::size_t i = 0; i <= last; i++) {
+            frames.emplace_back(
+                frame_snapshots[i],
+                monotonic_clock_timestamp,
+                thread_id,
+                i == last,
+                i == 0);
+        }
+        frames[bottommost_index].cpu_time  = cpu_time;
+        frames[bottommost_index].gil_state = gil_state;
+    }
+    const std::lock_guard<std::mutex> guard(mutex);
+    forget_stale_fingerprints();
+    if (cpu_time_sampling_flag) {
+        cpu_clocks.forget_stale_clocks();
+    }
+    return true;
+}
+
+bool SamplingCollector::measure_cpu_time(
+    std::uint64_t             unique_id,
+    unsigned long long        thread_id,
+    std::chrono::nanoseconds &cpu_time,
+    bool &                    is_idle) {
+    detail::ThreadCPUClocks::Measurement measurement;
+    if (!cpu_clocks.measure(unique_id, thread_id, measurement)) {
+        return false;
+    }
+    cpu_time = measurement.cpu_time;
+    // A thread that hasn't been running since the previous sample
+    // couldn't have changed its stack.
+    is_idle = skip_idle_threads_flag && !measurement.is_first &&
+              cpu_time.count() == 0;
+    return true;
+}
+
+bool SamplingCollector::skip_idle_thread(
+    std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+    unsigned long long                    thread_id,
+    std::vector<RawFrame> &               frames) {
+    if (!suppress_unchanged_stacks_flag) {
+        return true;
+    }
+    // The whole stack is collected once, so that there is a base for
+    // the following unchanged traces.
+    auto it = stack_fingerprints.find(thread_id);
+    if (it == stack_fingerprints.end() ||
+        it->second.unchanged_count >= max_unchanged_samples) {
+        return false;
+    }
+    it->second.sample_count = sample_count;
+    it->second.unchanged_count++;
+    frames.emplace_back(monotonic_clock_timestamp, thread_id);
+    return true;
+}
+
+bool SamplingCollector::is_thread_alive(const detail::ThreadSnapshot &thread) {
+    for (auto thread_state =
+             PyInterpreterState_ThreadHead(PyThreadState_Get()->interp);
+         thread_state != nullptr;
+         thread_state = PyThreadState_Next(thread_state)) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (reinterpret_cast<std::uintptr_t>(thread_state) == thread.address &&
+            thread_state->thread_id == thread.state.thread_id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t SamplingCollector::fingerprint_stack(PyFrameObject *frame) {
+    std::size_t hash = 0;
+    for (; frame != nullptr; frame = frame->f_back) {
+        boost::hash_combine(hash, frame);
+        boost::hash_combine(hash, frame->f_lasti);
+    }
+    return hash;
+}
+
+std::size_t SamplingCollector::fingerprint_stack(
+    const std::vector<detail::FrameSnapshot> &frames) {
+    std::size_t hash = 0;
+    for (const auto &frame : frames) {
+        boost::hash_combine(hash, frame.address);
+        boost::hash_combine(hash, frame.lasti);
+    }
+    return hash;
+}
+
+bool SamplingCollector::is_stack_unchanged(
+    unsigned long long thread_id,
+    std::size_t        fingerprint) {
+    auto &previous = stack_fingerprints[thread_id];
+    // Zero sample number means that the fingerprint has just been created.
+    const bool is_unchanged =
+        previous.sample_count != 0 && previous.hash == fingerprint &&
+        previous.unchanged_count < max_unchanged_samples;
+    previous.hash            = fingerprint;
+    previous.sample_count    = sample_count;
+    previous.unchanged_count = is_unchanged ? previous.unchanged_count + 1 : 0;
+    return is_unchanged;
+}
+
+void SamplingCollector::forget_stale_fingerprints() {
+    if (!suppress_unchanged_stacks_flag) {
+        return;
+    }
+    for (auto it = stack_fingerprints.begin();
+         it != stack_fingerprints.end();) {
+        if (it->second.sample_count != sample_count) {
+            it = stack_fingerprints.erase(it);
+        } else {
+            it++;
+        }
+    }
+    sample_count++;
+}
+
+bool SamplingCollector::collect_task_frames(
+    std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+    std::vector<RawFrame> &               frames) {
+    detail::GILGuard gil_guard;
+    if (!async_tasks) {
+        return true;
+    }
+    // Copy the set in order to not be affected by tasks created or
+    // destroyed as a side-effect of code executed below.
+    PyObject *task_refs = PySequence_List(async_tasks.ptr());
+    if (task_refs == nullptr) {
+        PyErr_Clear();
+        return false;
+    }
+    std::vector<PyFrameObject *> chain;
+    const auto                   tasks_count = PyList_GET_SIZE(task_refs);
+    for (Py_ssize_t i = 0; i < tasks_count; i++) {
+        PyObject *task = PyWeakref_GET_OBJECT(PyList_GET_ITEM(task_refs, i));
+        if (task == Py_None) {
+            continue;
+        }
+        PyObject *awaitable = PyObject_GetAttrString(task, "_coro");
+        if (awaitable == nullptr) {
+            PyErr_Clear();
+            continue;
+        }
+        // Follow the await-chain from the task's coroutine down to
+        // the innermost awaited coroutine or generator.
+        chain.clear();
+        while (awaitable != nullptr) {
+            if (!PyCoro_CheckExact(awaitable) && !PyGen_Check(awaitable) &&
+                !PyAsyncGen_CheckExact(awaitable)) {
+                Py_DECREF(awaitable);
+                break;
+            }
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            auto generator = reinterpret_cast<PyGenObject *>(awaitable);
+            if (generator->gi_frame == nullptr) {
+                // Already finished.
+                Py_DECREF(awaitable);
+                break;
+            }
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            Py_INCREF(reinterpret_cast<PyObject *>(generator->gi_frame));
+            chain.push_back(generator->gi_frame);
+            auto awaited = _PyGen_yf(generator);
+            Py_DECREF(awaitable);
+            awaitable = awaited;
+        }
+        if (chain.empty()) {
+            continue;
+        }
+        // Same as id(task).
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto task_id = reinterpret_cast<std::uintptr_t>(task);
+        // Innermost frame is the bottommost.
+        for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+            frames.emplace_back(
+                *it,
+                code_registry.get((*it)->f_code),
+                monotonic_clock_timestamp,
+                task_id,
+                std::next(it) == chain.rend(),
+                it == chain.rbegin());
+        }
+        for (auto frame : chain) {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            Py_DECREF(reinterpret_cast<PyObject *>(frame));
+        }
+    }
+    Py_DECREF(task_refs);
+    return true;
+}
+
 SamplingCollector::RawFrame::RawFrame(
     decltype(frame)                     frame,
+    decltype(code)                      code,
     decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
     decltype(thread_id)                 thread_id,
     bool                                is_topmost,
     bool                                is_bottommost)
     : monotonic_clock_timestamp{monotonic_clock_timestamp},
-      is_topmost{is_topmost}, is_bottommost{is_bottommost} {
-    Py_XINCREF(thread_id);
+      is_topmost{is_topmost}, is_bottommost{is_bottommost},
+      code{std::move(code)}, lasti{frame->f_lasti} {
     this->thread_id = thread_id;
 
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
@@ -432,8 +1422,26 @@ SamplingCollector::RawFrame::RawFrame(
     }
 }
 
+SamplingCollector::RawFrame::RawFrame(
+    const detail::FrameSnapshot &       snapshot,
+    decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
+    decltype(thread_id)                 thread_id,
+    bool                                is_topmost,
+    bool                                is_bottommost)
+    : is_coroutine{snapshot.is_coroutine}, is_generator{snapshot.is_generator},
+      is_bottommost{is_bottommost}, is_topmost{is_topmost},
+      cookie{snapshot.address}, thread_id{thread_id},
+      monotonic_clock_timestamp{monotonic_clock_timestamp},
+      code{snapshot.code}, lasti{snapshot.lasti} {}
+
+SamplingCollector::RawFrame::RawFrame(
+    decltype(monotonic_clock_timestamp) monotonic_clock_timestamp,
+    decltype(thread_id)                 thread_id)
+    : is_bottommost{true}, is_topmost{true}, is_unchanged{true},
+      thread_id{thread_id}, monotonic_clock_timestamp{
+                                monotonic_clock_timestamp} {}
+
 SamplingCollector::RawFrame::~RawFrame() {
-    Py_XDECREF(thread_id);
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
     Py_XDECREF(reinterpret_cast<PyObject *>(frame));
 }
@@ -442,31 +1450,55 @@ SamplingCollector::RawFrame::RawFrame(RawFrame &&raw_frame) noexcept
     : frame{raw_frame.frame}, is_coroutine{raw_frame.is_coroutine},
       is_generator{raw_frame.is_generator},
       is_bottommost{raw_frame.is_bottommost}, is_topmost{raw_frame.is_topmost},
-      cookie{raw_frame.cookie}, thread_id{raw_frame.thread_id},
-      monotonic_clock_timestamp{raw_frame.monotonic_clock_timestamp} {
-    raw_frame.frame     = nullptr;
-    raw_frame.thread_id = nullptr;
+      is_unchanged{raw_frame.is_unchanged}, cookie{raw_frame.cookie},
+      thread_id{raw_frame.thread_id},
+      monotonic_clock_timestamp{raw_frame.monotonic_clock_timestamp},
+      code{std::move(raw_frame.code)}, lasti{raw_frame.lasti},
+      cpu_time{raw_frame.cpu_time}, gil_state{raw_frame.gil_state},
+      gil_wait{raw_frame.gil_wait}, weight{raw_frame.weight},
+      tags{std::move(raw_frame.tags)} {
+    raw_frame.frame = nullptr;
+}
+
+SamplingCollector::RawFrame &
+SamplingCollector::RawFrame::operator=(RawFrame &&raw_frame) noexcept {
+    std::swap(frame, raw_frame.frame);
+    is_coroutine              = raw_frame.is_coroutine;
+    is_generator              = raw_frame.is_generator;
+    is_bottommost             = raw_frame.is_bottommost;
+    is_topmost                = raw_frame.is_topmost;
+    is_unchanged              = raw_frame.is_unchanged;
+    cookie                    = raw_frame.cookie;
+    thread_id                 = raw_frame.thread_id;
+    monotonic_clock_timestamp = raw_frame.monotonic_clock_timestamp;
+    code                      = std::move(raw_frame.code);
+    lasti                     = raw_frame.lasti;
+    cpu_time                  = raw_frame.cpu_time;
+    gil_state                 = raw_frame.gil_state;
+    gil_wait                  = raw_frame.gil_wait;
+    weight                    = raw_frame.weight;
+    tags                      = std::move(raw_frame.tags);
+    return *this;
 }
 
 std::unique_ptr<Frame>
 SamplingCollector::construct_frame(const RawFrame &raw_frame) {
-    auto frame = std::make_unique<Frame>();
-
     // TODO: Implement retrieval of fully qualified name of the object.
-
-    frame->symbolic_name =
-        detail::safe_encode(raw_frame.frame->f_code->co_name);
-    frame->file_name =
-        detail::safe_encode(raw_frame.frame->f_code->co_filename);
-    frame->line_number  = raw_frame.frame->f_lineno;
+    auto frame           = std::make_unique<Frame>();
+    frame->symbolic_name = raw_frame.code->name;
+    frame->file_name     = raw_frame.code->file_name;
+    // f_lineno is accurate only while tracing, the line is resolved from
+    // the last executed instruction same as PyFrame_GetLineNumber() does.
+    frame->line_number  = raw_frame.code->get_line_number(raw_frame.lasti);
     frame->is_coroutine = raw_frame.is_coroutine;
     frame->is_generator = raw_frame.is_generator;
     frame->cookie       = raw_frame.cookie;
     return frame;
 }
 
-std::unique_ptr<TraceSample>
-SamplingCollector::construct_trace(const std::vector<RawFrame *> &raw_frames) {
+std::unique_ptr<TraceSample> SamplingCollector::construct_trace(
+    const std::vector<RawFrame *> &                  raw_frames,
+    const TimePointConversionUtil::BaseMeasurements &base_measurements) {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
     BOOST_ASSERT(!raw_frames.empty());
     auto trace_sample = std::make_unique<TraceSample>();
@@ -476,14 +1508,18 @@ SamplingCollector::construct_trace(const std::vector<RawFrame *> &raw_frames) {
         raw_frames[0]->monotonic_clock_timestamp;
     trace_sample->timestamp = TimePointConversionUtil::convert_time_point(
         raw_frames[0]->monotonic_clock_timestamp,
-        clocks_base_measurements);
+        base_measurements);
+    trace_sample->thread_id  = raw_frames[0]->thread_id;
     trace_sample->process_id = boost::this_process::get_id();
     trace_sample->hostname   = boost::asio::ip::host_name();
-
-    {
-        detail::GILGuard gil_guard;
-        trace_sample->thread_id =
-            py::cast<unsigned long long>(raw_frames[0]->thread_id);
+    trace_sample->cpu_time   = raw_frames[0]->cpu_time;
+    trace_sample->gil_state  = raw_frames[0]->gil_state;
+    trace_sample->gil_wait   = raw_frames[0]->gil_wait;
+    trace_sample->weight     = raw_frames[0]->weight;
+    trace_sample->tags       = raw_frames[0]->tags;
+    if (raw_frames[0]->is_unchanged) {
+        trace_sample->is_unchanged = true;
+        return trace_sample;
     }
 
     for (const auto &raw_frame : raw_frames) {
@@ -493,6 +1529,46 @@ SamplingCollector::construct_trace(const std::vector<RawFrame *> &raw_frames) {
     return trace_sample;
 }
 
+std::unique_ptr<TraceSample> SamplingCollector::construct_trace(
+    const RecordedSample &                           sample,
+    const TimePointConversionUtil::BaseMeasurements &base_measurements) {
+    auto trace_sample = std::make_unique<TraceSample>();
+    trace_sample->frames =
+        std::make_shared<std::vector<std::shared_ptr<Frame>>>();
+    trace_sample->monotonic_clock_timestamp = sample.monotonic_clock_timestamp;
+    trace_sample->timestamp = TimePointConversionUtil::convert_time_point(
+        sample.monotonic_clock_timestamp,
+        base_measurements);
+    trace_sample->thread_id  = sample.thread_id;
+    trace_sample->process_id = boost::this_process::get_id();
+    trace_sample->hostname   = boost::asio::ip::host_name();
+    trace_sample->cpu_time   = sample.cpu_time;
+    trace_sample->gil_state  = sample.gil_state;
+    trace_sample->gil_wait   = sample.gil_wait;
+    trace_sample->weight     = sample.weight;
+    const auto first_tag =
+        sample.first_tag - (recorded_tags_count - recorded_tags.size());
+    for (std::uint32_t i = 0; i < sample.tags_count; i++) {
+        trace_sample->tags.push_back(recorded_tags[first_tag + i]);
+    }
+    const auto first_frame =
+        sample.first_frame - (recorded_frames_count - recorded_frames.size());
+    trace_sample->frames->reserve(sample.frames_count);
+    for (std::uint32_t i = 0; i < sample.frames_count; i++) {
+        const auto &recorded_frame = recorded_frames[first_frame + i];
+        const auto &code           = *recorded_codes[recorded_frame.code_id];
+        auto        frame          = std::make_shared<Frame>();
+        frame->symbolic_name       = code.name;
+        frame->file_name           = code.file_name;
+        frame->line_number         = recorded_frame.line_number;
+        frame->is_coroutine        = recorded_frame.is_coroutine;
+        frame->is_generator        = recorded_frame.is_generator;
+        frame->cookie              = recorded_frame.cookie;
+        trace_sample->frames->emplace_back(std::move(frame));
+    }
+    return trace_sample;
+}
+
 void SamplingCollector::resume() {
     if (is_stopped()) {
         throw CollectorIsStopped();
@@ -515,3 +1591,4 @@ void SamplingCollector::pause() {
 constexpr std::chrono::microseconds SamplingCollector::sleep_interval;
 constexpr std::chrono::milliseconds SamplingCollector::pause_sleep_interval;
 constexpr int                       SamplingCollector::frames_buffer_reserve;
+constexpr unsigned int              SamplingCollector::max_unchanged_samples;
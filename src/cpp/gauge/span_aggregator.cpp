@@ -12,12 +12,36 @@
 
 using namespace gauge;
 
+namespace {
+/**
+ * Get size of memory allocated by the string outside of the object.
+ */
+std::size_t get_heap_size(const std::string &value) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *begin = reinterpret_cast<const char *>(&value);
+    if (value.data() >= begin && value.data() < begin + sizeof(value)) {
+        // Short strings are stored inside of the object.
+        return 0;
+    }
+    return value.capacity() + 1;
+}
+} // namespace
+
+std::size_t SpanAggregator::OpenSpan::get_size(const Span &span) {
+    // Roughly a node of each of the indexes and a control block of
+    // the pointer.
+    static constexpr std::size_t overhead = 8 * sizeof(void *);
+    return sizeof(OpenSpan) + sizeof(Span) + overhead +
+           get_heap_size(span.id) + get_heap_size(span.parent_id) +
+           get_heap_size(span.correlation_id) +
+           get_heap_size(span.symbolic_name) +
+           get_heap_size(span.file_name) + get_heap_size(span.hostname) +
+           span.tags.capacity() * sizeof(unsigned int);
+}
+
 SpanAggregator::SpanAggregator(std::chrono::steady_clock::duration span_ttl)
     : span_ttl{span_ttl}, offset{}, logger{detail::get_logger()},
-      clocks_base_measurements{
-          TimePointConversionUtil::get_base_measurements()},
-      random_generator{boost::uuids::random_generator()},
-      py_context{py::reinterpret_steal<py::object>(PyContext_New())} {}
+      random_generator{boost::uuids::random_generator()} {}
 
 void SpanAggregator::execute_callbacks(
     std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans) {
@@ -26,34 +50,7 @@ void SpanAggregator::execute_callbacks(
             logger,
             "Passing {} spans to callbacks...",
             spans->size());
-        if (!callbacks.empty()) {
-            SPDLOG_LOGGER_TRACE(logger, "Calling callbacks...");
-            for (const auto &callback : callbacks) {
-                callback(spans);
-            }
-            SPDLOG_LOGGER_TRACE(logger, "Completed calling callbacks.");
-        }
-        if (!py_callbacks.empty()) {
-            SPDLOG_LOGGER_TRACE(logger, "Calling Python callbacks...");
-            for (const auto &callback : py_callbacks) {
-                detail::GILGuard gil_guard;
-                int              error_code = 0;
-                error_code = PyContext_Enter(py_context.ptr());
-                if (error_code != 0) {
-                    auto msg = "Failed to enter Python contextvars context.";
-                    SPDLOG_LOGGER_ERROR(logger, msg);
-                    throw std::runtime_error(msg);
-                }
-                callback(spans);
-                error_code = PyContext_Exit(py_context.ptr());
-                if (error_code != 0) {
-                    auto msg = "Failed to exit Python contextvars context.";
-                    SPDLOG_LOGGER_ERROR(logger, msg);
-                    throw std::runtime_error(msg);
-                }
-            }
-            SPDLOG_LOGGER_TRACE(logger, "Completed calling Python callbacks.");
-        }
+        subscribers(spans);
     }
 }
 
@@ -69,24 +66,36 @@ void SpanAggregator::process_open_spans(
     bool                                                 force_finish) {
     SPDLOG_LOGGER_TRACE(logger, "Detecting complete spans...");
     std::vector<OpenSpan> spans_to_end;
-    for (const auto &open_span : open_spans) {
+    // Ending spans relocates them in the recency index.
+    for (const auto &open_span : open_spans.get<by_cookie>()) {
         const auto &span_ptr = open_span.span;
         BOOST_ASSERT_MSG(
             span_ptr->lifetime == Span::Start ||
                 span_ptr->lifetime == Span::End,
             "Unexpected Span lifetime.");
+        // Span could have been seen later in unchanged traces.
+        const auto last_seen   = get_last_seen(open_span);
+        const bool is_extended = last_seen.first >
+                                 span_ptr->monotonic_clock_timestamp;
         const auto has_span_ttl_expired =
-            ((offset - span_ptr->monotonic_clock_timestamp) > span_ttl);
+            ((offset - last_seen.first) > span_ttl);
         if (has_span_ttl_expired || force_finish) {
-            if (span_ptr->lifetime == Span::Start) {
-                auto end_span =
-                    std::shared_ptr<Span>(std::move(to_end_span(span_ptr)));
+            std::shared_ptr<Span> end_span = span_ptr;
+            if (span_ptr->lifetime == Span::Start || is_extended) {
+                end_span = std::shared_ptr<Span>(to_end_span(span_ptr));
+                end_span->monotonic_clock_timestamp = last_seen.first;
+                end_span->timestamp                 = last_seen.second;
                 add_span(end_span, open_span.cookie, *spans);
-                spans_to_end.emplace_back(open_span.cookie, end_span);
-            } else if (span_ptr->lifetime == Span::End) {
-                spans_to_end.push_back(open_span);
             }
-            continue;
+            spans_to_end.emplace_back(open_span.cookie, end_span);
+        }
+    }
+    for (auto it = thread_states.begin(); it != thread_states.end();) {
+        if (force_finish ||
+            (offset - it->second.monotonic_clock_timestamp) > span_ttl) {
+            it = thread_states.erase(it);
+        } else {
+            it++;
         }
     }
     SPDLOG_LOGGER_TRACE(logger, "Ending detected complete spans...");
@@ -118,6 +127,35 @@ void SpanAggregator::operator()(
         if (i == (size - 1)) {
             offset = trace->monotonic_clock_timestamp;
         }
+        const ThreadKey thread_key{trace->process_id, trace->thread_id};
+        if (trace->is_unchanged) {
+            // Just extend spans of the last complete trace of the thread.
+            // Without one the marker is skipped, the collector periodically
+            // emits whole stacks of unchanged threads.
+            auto thread_it = thread_states.find(thread_key);
+            if (thread_it != thread_states.end()) {
+                thread_it->second.monotonic_clock_timestamp =
+                    trace->monotonic_clock_timestamp;
+                thread_it->second.timestamp = trace->timestamp;
+                touch_open_spans(thread_it->second);
+            }
+            continue;
+        }
+        auto &thread_state = thread_states[thread_key];
+        // Open spans of the previous trace ended by this one were seen
+        // until the last unchanged trace.
+        thread_state.previous_generation = thread_state.generation;
+        thread_state.previous_last_seen = std::make_pair(
+            thread_state.monotonic_clock_timestamp,
+            thread_state.timestamp);
+        thread_state.generation = next_generation++;
+        thread_state.monotonic_clock_timestamp =
+            trace->monotonic_clock_timestamp;
+        thread_state.timestamp = trace->timestamp;
+        thread_state.cookies.clear();
+        for (const auto &frame : *trace->frames) {
+            thread_state.cookies.push_back(frame->cookie);
+        }
         auto correlation_id = boost::uuids::to_string(random_generator());
         // Iterate over frames starting from the topmost.
         for (auto frames_rev_it = trace->frames->rbegin();
@@ -143,10 +181,16 @@ void SpanAggregator::operator()(
                 span_ptr->is_top    = true;
                 span_ptr->parent_id = {};
             }
-            add_span(span_ptr, frame->cookie, *spans);
+            add_span(
+                span_ptr,
+                frame->cookie,
+                *spans,
+                thread_state.generation,
+                parent_frame != nullptr ? parent_frame->line_number : 0);
             parent_span  = span_ptr;
             parent_frame = frame;
         }
+        evict_open_spans(*spans, thread_state.generation);
     }
 
     process_open_spans(spans, false);
@@ -200,35 +244,197 @@ void SpanAggregator::sort_spans(
     SPDLOG_LOGGER_TRACE(logger, "Completed sorting spans.");
 }
 
+void SpanAggregator::evict_open_spans(
+    std::vector<std::shared_ptr<Span>> &spans,
+    unsigned long long                  generation) {
+    auto &by_recency_idx = open_spans.get<by_recency>();
+    while (!by_recency_idx.empty() &&
+           ((max_open_spans != 0 && open_spans.size() > max_open_spans) ||
+            (max_open_spans_bytes != 0 &&
+             open_spans_bytes > max_open_spans_bytes))) {
+        // Copied since the entry is erased when the span is ended.
+        const auto open_span = by_recency_idx.front();
+        if (open_span.generation == generation) {
+            break;
+        }
+        const auto &span = open_span.span;
+        // The span could have been seen later in unchanged traces.
+        const auto last_seen = get_last_seen(open_span);
+        SPDLOG_LOGGER_TRACE(
+            logger,
+            "Open spans are over the budget, evicting span \"{}\" with id "
+            "#{}...",
+            span->symbolic_name,
+            span->id);
+        const auto count = spans.size();
+        remove_span(
+            span,
+            open_span.cookie,
+            spans,
+            last_seen.first,
+            last_seen.second);
+        evicted_spans_count += spans.size() - count;
+    }
+}
+
+std::pair<
+    decltype(Span::monotonic_clock_timestamp),
+    decltype(Span::timestamp)>
+SpanAggregator::get_last_seen(const OpenSpan &open_span) const {
+    const auto &span   = *open_span.span;
+    auto        result = std::make_pair(
+        span.monotonic_clock_timestamp,
+        span.timestamp);
+    auto thread_it =
+        thread_states.find(ThreadKey{span.process_id, span.thread_id});
+    if (thread_it == thread_states.end()) {
+        return result;
+    }
+    const auto &thread_state = thread_it->second;
+    if (thread_state.generation == open_span.generation) {
+        if (thread_state.monotonic_clock_timestamp > result.first) {
+            result = std::make_pair(
+                thread_state.monotonic_clock_timestamp,
+                thread_state.timestamp);
+        }
+    } else if (thread_state.previous_generation == open_span.generation) {
+        if (thread_state.previous_last_seen.first > result.first) {
+            result = thread_state.previous_last_seen;
+        }
+    }
+    return result;
+}
+
+void SpanAggregator::touch_open_spans(const ThreadState &thread_state) {
+    // Otherwise spans of idle threads would be the first ones evicted.
+    auto &by_cookie_idx  = open_spans.get<by_cookie>();
+    auto &by_recency_idx = open_spans.get<by_recency>();
+    for (const auto &cookie : thread_state.cookies) {
+        auto it = by_cookie_idx.find(cookie);
+        if (it != by_cookie_idx.end() &&
+            it->generation == thread_state.generation) {
+            by_recency_idx.relocate(
+                by_recency_idx.end(),
+                open_spans.project<by_recency>(it));
+        }
+    }
+}
+
 void SpanAggregator::finish_open_spans() {
     SPDLOG_LOGGER_DEBUG(logger, "Finishing open spans...");
 
-    const std::lock_guard<std::mutex> guard(mutex);
-    auto spans = std::make_shared<std::vector<std::shared_ptr<Span>>>();
+    {
+        const std::lock_guard<std::mutex> guard(mutex);
+        auto spans = std::make_shared<std::vector<std::shared_ptr<Span>>>();
 
-    process_open_spans(spans, true);
-    sort_spans(spans);
-    execute_callbacks(spans);
+        process_open_spans(spans, true);
+        sort_spans(spans);
+        execute_callbacks(spans);
+    }
+    // So that all of the spans are passed further when this returns.
+    subscribers.flush();
 
     SPDLOG_LOGGER_DEBUG(logger, "Finished open spans.");
 }
 
 void SpanAggregator::subscribe(
     std::function<void(std::shared_ptr<std::vector<std::shared_ptr<Span>>>)>
-        callback) {
+                           callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+void SpanAggregator::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> SpanAggregator::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return subscribers.get_dispatch_stats();
+}
+
+void SpanAggregator::set_open_spans_budget(
+    std::size_t max_count,
+    std::size_t max_bytes) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    max_open_spans       = max_count;
+    max_open_spans_bytes = max_bytes;
+}
+
+std::size_t SpanAggregator::get_open_spans_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return open_spans.size();
+}
+
+std::size_t SpanAggregator::get_open_spans_bytes() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return open_spans_bytes;
+}
+
+unsigned long long SpanAggregator::get_evicted_spans_count() {
     const std::lock_guard<std::mutex> guard(mutex);
-    callbacks.emplace_front(std::move(callback));
+    return evicted_spans_count;
 }
 
-void SpanAggregator::subscribe(py::object callback) {
+void SpanAggregator::set_sibling_coalescing(bool enabled) {
     const std::lock_guard<std::mutex> guard(mutex);
-    py_callbacks.emplace_front(std::move(callback));
+    coalesce_siblings = enabled;
+}
+
+bool SpanAggregator::is_coalescing_siblings() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return coalesce_siblings;
+}
+
+bool SpanAggregator::coalesce_span(
+    const OpenSpan &                sibling,
+    const std::shared_ptr<Span> &   span,
+    const decltype(Frame::cookie) & cookie,
+    unsigned long long              generation,
+    int                             call_line_number) {
+    if (sibling.call_line_number != call_line_number ||
+        sibling.span->symbolic_name != span->symbolic_name ||
+        sibling.span->file_name != span->file_name) {
+        return false;
+    }
+    SPDLOG_LOGGER_TRACE(
+        logger,
+        "Coalescing span \"{}\" with its sibling with id #{}...",
+        span->symbolic_name,
+        sibling.span->id);
+    span->id       = sibling.span->id;
+    span->lifetime = Span::End;
+
+    OpenSpan open_span{cookie, span, generation, call_line_number};
+    open_span.repetition_count = sibling.repetition_count + 1;
+    // The previous call is considered finished when it was last seen.
+    open_span.summed_duration =
+        sibling.summed_duration +
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            get_last_seen(sibling).first - sibling.repetition_start);
+
+    auto &by_id_idx = open_spans.get<by_id>();
+    auto  it        = by_id_idx.find(span->id);
+    open_spans_bytes += open_span.size;
+    open_spans_bytes -= it->size;
+    by_id_idx.replace(it, open_span);
+    auto &by_recency_idx = open_spans.get<by_recency>();
+    by_recency_idx.relocate(
+        by_recency_idx.end(),
+        open_spans.project<by_recency>(it));
+    return true;
 }
 
 void SpanAggregator::add_span(
     const std::shared_ptr<Span> &       span,
     const decltype(Frame::cookie) &     cookie,
-    std::vector<std::shared_ptr<Span>> &spans) {
+    std::vector<std::shared_ptr<Span>> &spans,
+    unsigned long long                  generation,
+    int                                 call_line_number) {
     SPDLOG_LOGGER_TRACE(
         logger,
         "Adding open span \"{}\" with id #{}...",
@@ -241,7 +447,18 @@ void SpanAggregator::add_span(
         // Span is already indexed - replace it.
         // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
         BOOST_ASSERT(cookie == it->cookie);
-        by_id_idx.replace(it, {cookie, span});
+        OpenSpan open_span{cookie, span, generation, it->call_line_number};
+        open_span.repetition_count = it->repetition_count;
+        open_span.summed_duration  = it->summed_duration;
+        open_span.repetition_start = it->repetition_start;
+        open_spans_bytes += open_span.size;
+        open_spans_bytes -= it->size;
+        by_id_idx.replace(it, open_span);
+        // The span has just been seen.
+        auto &by_recency_idx = open_spans.get<by_recency>();
+        by_recency_idx.relocate(
+            by_recency_idx.end(),
+            open_spans.project<by_recency>(it));
         return;
     };
 
@@ -255,15 +472,36 @@ void SpanAggregator::add_span(
         BOOST_ASSERT(sibling_it->span->id != span->id);
         // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay)
         BOOST_ASSERT(cookie != sibling_it->cookie);
+        // Children of the sibling stay open, so that they could be
+        // coalesced with children of the span too.
+        if (coalesce_siblings && span->lifetime == Span::Start &&
+            coalesce_span(
+                *sibling_it,
+                span,
+                cookie,
+                generation,
+                call_line_number)) {
+            return;
+        }
         SPDLOG_LOGGER_TRACE(
             logger,
             "Found opened sibling-span \"{}\" with id #{}. Ending it...",
             sibling_it->span->symbolic_name,
             sibling_it->span->id);
-        remove_span(sibling_it->span, sibling_it->cookie, spans);
+        const auto last_seen = get_last_seen(*sibling_it);
+        remove_span(
+            sibling_it->span,
+            sibling_it->cookie,
+            spans,
+            last_seen.first,
+            last_seen.second);
     }
 
-    open_spans.emplace(cookie, span);
+    auto result =
+        open_spans.emplace_back(cookie, span, generation, call_line_number);
+    if (result.second) {
+        open_spans_bytes += result.first->size;
+    }
 
     if (span->lifetime == Span::Start) {
         spans.push_back(span);
@@ -310,7 +548,18 @@ void SpanAggregator::remove_span(
         end_span->timestamp                 = timestamp;
         end_span->monotonic_clock_timestamp = monotonic_clock_timestamp;
         spans.push_back(end_span);
-        by_id_idx.erase(current_span->id);
+        auto it = by_id_idx.find(current_span->id);
+        if (it != by_id_idx.end()) {
+            end_span->repetition_count = it->repetition_count;
+            if (it->repetition_count > 1) {
+                end_span->summed_duration =
+                    it->summed_duration +
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        monotonic_clock_timestamp - it->repetition_start);
+            }
+            open_spans_bytes -= it->size;
+            by_id_idx.erase(it);
+        }
         SPDLOG_LOGGER_TRACE(
             logger,
             "Ended open span \"{}\" with id #{}...",
@@ -0,0 +1,336 @@
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "gauge/span_filter.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+SpanFilter::SpanFilter(std::chrono::steady_clock::duration min_duration)
+    : logger{detail::get_logger()}, min_duration{min_duration} {}
+
+void SpanFilter::subscribe(
+    std::function<void(std::shared_ptr<std::vector<std::shared_ptr<Span>>>)>
+                           callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+void SpanFilter::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> SpanFilter::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return subscribers.get_dispatch_stats();
+}
+
+void SpanFilter::strip_levels(
+    unsigned int                        count,
+    boost::optional<unsigned long long> process_id,
+    boost::optional<unsigned long long> thread_id) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    auto                              key = StripKey{process_id, thread_id};
+    if (count == 0) {
+        strip_levels_by_key.erase(key);
+        return;
+    }
+    strip_levels_by_key[key] = count;
+}
+
+void SpanFilter::set_allowed_files(const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    allowed_files = std::move(globs);
+    is_file_allowed_cache.clear();
+}
+
+void SpanFilter::set_denied_files(const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    denied_files = std::move(globs);
+    is_file_allowed_cache.clear();
+}
+
+void SpanFilter::set_module_roots(const std::vector<std::string> &roots) {
+    std::vector<std::string> sorted_roots;
+    for (auto root : roots) {
+        while (root.size() > 1 &&
+               (root.back() == '/' || root.back() == '\\')) {
+            root.pop_back();
+        }
+        if (!root.empty()) {
+            sorted_roots.push_back(std::move(root));
+        }
+    }
+    std::sort(
+        sorted_roots.begin(),
+        sorted_roots.end(),
+        [](const std::string &a, const std::string &b) {
+            return a.size() > b.size();
+        });
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    module_roots = std::move(sorted_roots);
+    is_file_allowed_cache.clear();
+}
+
+void SpanFilter::set_allowed_modules(
+    const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    allowed_modules = std::move(globs);
+    is_file_allowed_cache.clear();
+}
+
+void SpanFilter::set_denied_modules(const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    denied_modules = std::move(globs);
+    is_file_allowed_cache.clear();
+}
+
+void SpanFilter::set_min_duration(
+    std::chrono::steady_clock::duration duration) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    min_duration = duration;
+}
+
+std::chrono::steady_clock::duration SpanFilter::get_min_duration() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return min_duration;
+}
+
+std::string SpanFilter::get_module_name(const std::string &file_name) const {
+    static const std::string frozen_prefix = "<frozen ";
+    if (file_name.compare(0, frozen_prefix.size(), frozen_prefix) == 0 &&
+        file_name.back() == '>') {
+        return file_name.substr(
+            frozen_prefix.size(),
+            file_name.size() - frozen_prefix.size() - 1);
+    }
+    std::string relative;
+    for (const auto &root : module_roots) {
+        if (file_name.size() > root.size() + 1 &&
+            file_name.compare(0, root.size(), root) == 0 &&
+            (file_name[root.size()] == '/' ||
+             file_name[root.size()] == '\\')) {
+            relative = file_name.substr(root.size() + 1);
+            break;
+        }
+    }
+    if (relative.empty()) {
+        return {};
+    }
+    // Extensions of native modules contain dots as well -
+    // "module.cpython-38-x86_64-linux-gnu.so".
+    const auto base_start = relative.find_last_of("/\\");
+    const auto extension  = relative.find(
+        '.',
+        base_start == std::string::npos ? 0 : base_start + 1);
+    if (extension != std::string::npos) {
+        relative.resize(extension);
+    }
+    static const std::string init_suffix = "__init__";
+    if (relative.size() > init_suffix.size() + 1 &&
+        (relative[relative.size() - init_suffix.size() - 1] == '/' ||
+         relative[relative.size() - init_suffix.size() - 1] == '\\') &&
+        relative.compare(
+            relative.size() - init_suffix.size(),
+            init_suffix.size(),
+            init_suffix) == 0) {
+        relative.resize(relative.size() - init_suffix.size() - 1);
+    }
+    std::replace(relative.begin(), relative.end(), '/', '.');
+    std::replace(relative.begin(), relative.end(), '\\', '.');
+    return relative;
+}
+
+bool SpanFilter::is_file_allowed(const std::string &file_name) {
+    if (allowed_files.empty() && denied_files.empty() &&
+        allowed_modules.empty() && denied_modules.empty()) {
+        return true;
+    }
+    auto it = is_file_allowed_cache.find(file_name);
+    if (it != is_file_allowed_cache.end()) {
+        return it->second;
+    }
+    // File names are few, but let's not allow the cache to grow unbounded
+    // in case of dynamically generated code.
+    static constexpr auto max_cache_size = 100000;
+    if (is_file_allowed_cache.size() >= max_cache_size) {
+        is_file_allowed_cache.clear();
+    }
+    auto is_allowed =
+        (allowed_files.empty() || allowed_files.matches(file_name)) &&
+        !denied_files.matches(file_name);
+    if (is_allowed && (!allowed_modules.empty() || !denied_modules.empty())) {
+        const auto module_name = get_module_name(file_name);
+        is_allowed = (allowed_modules.empty() ||
+                      allowed_modules.matches(module_name)) &&
+                     !denied_modules.matches(module_name);
+    }
+    is_file_allowed_cache.emplace(file_name, is_allowed);
+    return is_allowed;
+}
+
+bool SpanFilter::should_strip(const Span &span, unsigned int depth) const {
+    if (strip_levels_by_key.empty()) {
+        return false;
+    }
+    const StripKey keys[] = {
+        {span.process_id, span.thread_id},
+        {span.process_id, boost::none},
+        {boost::none, span.thread_id},
+        {boost::none, boost::none}};
+    for (const auto &key : keys) {
+        auto it = strip_levels_by_key.find(key);
+        if (it != strip_levels_by_key.end() && depth <= it->second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<Span> SpanFilter::reparent(
+    const std::shared_ptr<Span> &span,
+    const SpanState &            state) {
+    if (span->parent_id == state.parent_id && span->is_top == state.is_top) {
+        return span;
+    }
+    // Spans could be shared with other subscribers - so they are copied
+    // instead of being mutated.
+    auto reparented       = std::make_shared<Span>(*span);
+    reparented->parent_id = state.parent_id;
+    reparented->is_top    = state.is_top;
+    return reparented;
+}
+
+void SpanFilter::release_held_spans(
+    std::chrono::steady_clock::time_point now,
+    std::vector<std::shared_ptr<Span>> &  spans) {
+    while (!held_span_ids.empty()) {
+        auto it = states.find(held_span_ids.front());
+        if (it == states.end() || it->second.is_released) {
+            held_span_ids.pop_front();
+            continue;
+        }
+        auto &state = it->second;
+        if ((now - state.start_span->monotonic_clock_timestamp) <
+            min_duration) {
+            break;
+        }
+        state.is_released = true;
+        spans.push_back(reparent(state.start_span, state));
+        held_span_ids.pop_front();
+    }
+}
+
+void SpanFilter::process_start_span(
+    const std::shared_ptr<Span> &       span,
+    std::vector<std::shared_ptr<Span>> &spans) {
+    if (states.find(span->id) != states.end()) {
+        SPDLOG_LOGGER_DEBUG(
+            logger,
+            "Duplicate start-span with id #{}, skipping...",
+            span->id);
+        return;
+    }
+    SpanState state;
+    state.start_span = span;
+    state.depth      = 1;
+    state.parent_id  = span->parent_id;
+    state.is_top     = span->is_top;
+    if (!span->is_top) {
+        auto parent_it = states.find(span->parent_id);
+        if (parent_it != states.end()) {
+            const auto &parent = parent_it->second;
+            state.depth        = parent.depth + 1;
+            if (parent.is_dropped) {
+                state.parent_id = parent.parent_id;
+                state.is_top    = parent.is_top;
+            }
+        }
+    }
+    state.is_dropped =
+        should_strip(*span, state.depth) || !is_file_allowed(span->file_name);
+    if (state.is_dropped) {
+        SPDLOG_LOGGER_TRACE(
+            logger,
+            "Dropping span \"{}\" with id #{}...",
+            span->symbolic_name,
+            span->id);
+    } else if (min_duration > 0us) {
+        held_span_ids.push_back(span->id);
+    } else {
+        state.is_released = true;
+        spans.push_back(reparent(span, state));
+    }
+    states.emplace(span->id, std::move(state));
+}
+
+void SpanFilter::process_end_span(
+    const std::shared_ptr<Span> &       span,
+    std::vector<std::shared_ptr<Span>> &spans) {
+    auto it = states.find(span->id);
+    if (it == states.end()) {
+        // The span has started before the filter received anything,
+        // nothing is known about it.
+        spans.push_back(span);
+        return;
+    }
+    const auto &state = it->second;
+    if (state.is_dropped) {
+        // Nothing to do.
+    } else if (state.is_released) {
+        spans.push_back(reparent(span, state));
+    } else if (
+        (span->monotonic_clock_timestamp -
+         state.start_span->monotonic_clock_timestamp) >= min_duration) {
+        spans.push_back(reparent(state.start_span, state));
+        spans.push_back(reparent(span, state));
+    } else {
+        SPDLOG_LOGGER_TRACE(
+            logger,
+            "Dropping too short span \"{}\" with id #{}...",
+            span->symbolic_name,
+            span->id);
+    }
+    states.erase(it);
+}
+
+void SpanFilter::operator()(
+    const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans) {
+    SPDLOG_LOGGER_DEBUG(logger, "Filtering spans...");
+    const std::lock_guard<std::mutex> guard(mutex);
+
+    auto kept_spans = std::make_shared<std::vector<std::shared_ptr<Span>>>();
+    kept_spans->reserve(spans->size());
+    for (const auto &span : *spans) {
+        release_held_spans(span->monotonic_clock_timestamp, *kept_spans);
+        if (span->lifetime == Span::SpanLifeTime::Start) {
+            process_start_span(span, *kept_spans);
+        } else {
+            process_end_span(span, *kept_spans);
+        }
+    }
+    SPDLOG_LOGGER_TRACE(
+        logger,
+        "Kept {} of {} spans, {} spans are pending.",
+        kept_spans->size(),
+        spans->size(),
+        states.size());
+    if (!kept_spans->empty()) {
+        subscribers(kept_spans);
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Completed filtering spans.");
+}
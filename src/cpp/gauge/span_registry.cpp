@@ -0,0 +1,141 @@
+#include <spdlog/spdlog.h>
+
+#include "gauge/span_registry.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+SpanRegistry::SpanRegistry(
+    py::object                          context_factory,
+    std::chrono::steady_clock::duration context_ttl)
+    : logger{detail::get_logger()},
+      context_factory{std::move(context_factory)}, contexts{context_ttl} {}
+
+void SpanRegistry::strip_levels(
+    unsigned int                        count,
+    boost::optional<unsigned long long> process_id,
+    boost::optional<unsigned long long> thread_id) {
+    auto key = StripKey{process_id, thread_id};
+    if (count == 0) {
+        strip_levels_by_key.erase(key);
+        return;
+    }
+    strip_levels_by_key[key] = count;
+}
+
+std::size_t SpanRegistry::get_spans_count() { return entries.size(); }
+
+std::size_t SpanRegistry::get_contexts_count() {
+    // Released after the size is read.
+    const auto expired = contexts.expire(std::chrono::steady_clock::now());
+    return contexts.size();
+}
+
+SpanRegistry::ExportedSpans
+SpanRegistry::operator()(const std::vector<std::shared_ptr<Span>> &spans) {
+    const auto now = std::chrono::steady_clock::now();
+    // Released when the batch is registered.
+    const auto expired = contexts.expire(now);
+
+    ExportedSpans exported;
+    exported.reserve(spans.size());
+    for (const auto &span : spans) {
+        auto entry = span->lifetime == Span::Start ? start_span(span, now)
+                                                   : end_span(span);
+        if (entry != nullptr) {
+            exported.emplace_back(span, std::move(entry));
+        }
+    }
+    return exported;
+}
+
+bool SpanRegistry::should_strip(const Span &span, unsigned int depth) const {
+    if (strip_levels_by_key.empty()) {
+        return false;
+    }
+    const StripKey keys[] = {
+        {span.process_id, span.thread_id},
+        {span.process_id, boost::none},
+        {boost::none, span.thread_id},
+        {boost::none, boost::none}};
+    for (const auto &key : keys) {
+        auto it = strip_levels_by_key.find(key);
+        if (it != strip_levels_by_key.end() && depth <= it->second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+pybind11::object SpanRegistry::get_context(
+    const Span &                          span,
+    std::chrono::steady_clock::time_point now) {
+    const ThreadKey key{span.process_id, span.thread_id};
+    auto *          context = contexts.find(key, now);
+    if (context != nullptr) {
+        return *context;
+    }
+    // Tracers storing their state in context variables would mix up spans
+    // of different threads if they shared a context.
+    auto new_context = context_factory();
+    // The factory could have released the GIL and let another thread
+    // create the context.
+    context = contexts.find(key, now);
+    if (context != nullptr) {
+        return *context;
+    }
+    return contexts.insert(key, std::move(new_context), now);
+}
+
+std::shared_ptr<SpanRegistry::Entry> SpanRegistry::start_span(
+    const std::shared_ptr<Span> &         span,
+    std::chrono::steady_clock::time_point now) {
+    if (entries.count(span->id) != 0) {
+        SPDLOG_LOGGER_DEBUG(
+            logger,
+            "Duplicate span with lifetime 'Start' with id #{}.",
+            span->id);
+        return nullptr;
+    }
+    auto entry  = std::make_shared<Entry>();
+    entry->span = span;
+    if (!span->is_top) {
+        auto parent_it = entries.find(span->parent_id);
+        if (parent_it == entries.end()) {
+            SPDLOG_LOGGER_WARN(
+                logger,
+                "Parent span with id #{} is not found.",
+                span->parent_id);
+            return nullptr;
+        }
+        entry->parent = parent_it->second;
+        entry->depth  = entry->parent->depth + 1;
+        entry->is_top = entry->parent->is_top && entry->parent->is_stripped;
+    } else {
+        entry->is_top = true;
+    }
+    entry->is_stripped = should_strip(*span, entry->depth);
+    if (!entry->is_stripped) {
+        entry->context = get_context(*span, now);
+    }
+    entries.emplace(span->id, entry);
+    SPDLOG_LOGGER_TRACE(
+        logger,
+        "Registered span \"{}\" with id #{}{}.",
+        span->symbolic_name,
+        span->id,
+        entry->is_stripped ? " as stripped" : "");
+    return entry->is_stripped ? nullptr : entry;
+}
+
+std::shared_ptr<SpanRegistry::Entry>
+SpanRegistry::end_span(const std::shared_ptr<Span> &span) {
+    auto it = entries.find(span->id);
+    if (it == entries.end()) {
+        SPDLOG_LOGGER_WARN(logger, "Span with id #{} is not found.", span->id);
+        return nullptr;
+    }
+    auto entry = std::move(it->second);
+    entries.erase(it);
+    return entry->is_stripped ? nullptr : entry;
+}
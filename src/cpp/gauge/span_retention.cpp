@@ -0,0 +1,193 @@
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "gauge/span_retention.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+SpanRetention::SpanRetention(
+    std::chrono::steady_clock::duration min_duration,
+    double                              sample_rate,
+    std::size_t                         max_held_spans)
+    : logger{detail::get_logger()}, min_duration{min_duration},
+      sample_rate{std::min(std::max(sample_rate, 0.0), 1.0)},
+      max_held_spans{max_held_spans}, random_generator{
+                                          std::random_device{}()} {}
+
+void SpanRetention::subscribe(
+    std::function<void(std::shared_ptr<std::vector<std::shared_ptr<Span>>>)>
+                           callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+void SpanRetention::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> SpanRetention::get_dispatch_stats() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return subscribers.get_dispatch_stats();
+}
+
+void SpanRetention::set_min_duration(
+    std::chrono::steady_clock::duration duration) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    min_duration = duration;
+}
+
+std::chrono::steady_clock::duration SpanRetention::get_min_duration() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return min_duration;
+}
+
+void SpanRetention::set_sample_rate(double rate) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    sample_rate = std::min(std::max(rate, 0.0), 1.0);
+}
+
+double SpanRetention::get_sample_rate() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return sample_rate;
+}
+
+unsigned long long SpanRetention::get_kept_trees_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return kept_trees_count;
+}
+
+unsigned long long SpanRetention::get_dropped_trees_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return dropped_trees_count;
+}
+
+bool SpanRetention::should_keep(std::chrono::steady_clock::duration duration) {
+    if (duration >= min_duration) {
+        return true;
+    }
+    if (sample_rate <= 0.0) {
+        return false;
+    }
+    return std::uniform_real_distribution<double>(0.0, 1.0)(
+               random_generator) < sample_rate;
+}
+
+void SpanRetention::release_tree(
+    Tree &                              tree,
+    bool                                is_kept,
+    std::vector<std::shared_ptr<Span>> &spans) {
+    auto it = thread_trees.find(tree.thread_key);
+    it->second.held_spans_count -= tree.spans.size();
+    it->second.trees.erase(tree.position);
+    if (it->second.trees.empty()) {
+        thread_trees.erase(it);
+    }
+    if (is_kept) {
+        tree.state = Tree::Kept;
+        spans.insert(spans.end(), tree.spans.begin(), tree.spans.end());
+        kept_trees_count++;
+    } else {
+        SPDLOG_LOGGER_TRACE(
+            logger,
+            "Dropping tree of {} spans with top span id #{}...",
+            tree.spans.size(),
+            tree.top_id);
+        tree.state = Tree::Dropped;
+        dropped_trees_count++;
+    }
+    tree.spans.clear();
+    tree.spans.shrink_to_fit();
+}
+
+void SpanRetention::add_span(
+    Tree &                              tree,
+    const std::shared_ptr<Span> &       span,
+    std::vector<std::shared_ptr<Span>> &spans) {
+    switch (tree.state) {
+    case Tree::Kept:
+        spans.push_back(span);
+        return;
+    case Tree::Dropped:
+        return;
+    case Tree::Held:
+        break;
+    }
+    tree.spans.push_back(span);
+    thread_trees[tree.thread_key].held_spans_count++;
+    // The oldest trees are decided on early until the thread fits
+    // the bound.
+    for (auto it = thread_trees.find(tree.thread_key);
+         it != thread_trees.end() &&
+         it->second.held_spans_count > max_held_spans;
+         it = thread_trees.find(tree.thread_key)) {
+        const auto oldest = it->second.trees.front();
+        release_tree(
+            *oldest,
+            (span->monotonic_clock_timestamp - oldest->start) >= min_duration,
+            spans);
+    }
+}
+
+void SpanRetention::operator()(
+    const std::shared_ptr<std::vector<std::shared_ptr<Span>>> &spans) {
+    SPDLOG_LOGGER_DEBUG(logger, "Retaining spans...");
+    const std::lock_guard<std::mutex> guard(mutex);
+
+    auto kept_spans = std::make_shared<std::vector<std::shared_ptr<Span>>>();
+    for (const auto &span : *spans) {
+        if (span->lifetime == Span::SpanLifeTime::Start) {
+            std::shared_ptr<Tree> tree;
+            if (!span->is_top) {
+                auto it = trees.find(span->parent_id);
+                if (it == trees.end()) {
+                    // The tree has started before the retention received
+                    // anything, nothing is known about it.
+                    kept_spans->push_back(span);
+                    continue;
+                }
+                tree = it->second;
+            } else {
+                tree             = std::make_shared<Tree>();
+                tree->top_id     = span->id;
+                tree->start      = span->monotonic_clock_timestamp;
+                tree->thread_key = {span->process_id, span->thread_id};
+                auto &thread     = thread_trees[tree->thread_key];
+                tree->position =
+                    thread.trees.insert(thread.trees.end(), tree);
+            }
+            trees[span->id] = tree;
+            add_span(*tree, span, *kept_spans);
+            continue;
+        }
+        auto it = trees.find(span->id);
+        if (it == trees.end()) {
+            kept_spans->push_back(span);
+            continue;
+        }
+        const auto tree = it->second;
+        trees.erase(it);
+        add_span(*tree, span, *kept_spans);
+        if (span->id == tree->top_id && tree->state == Tree::Held) {
+            release_tree(
+                *tree,
+                should_keep(span->monotonic_clock_timestamp - tree->start),
+                *kept_spans);
+        }
+    }
+    SPDLOG_LOGGER_TRACE(
+        logger,
+        "Kept {} of {} spans, {} spans are open.",
+        kept_spans->size(),
+        spans->size(),
+        trees.size());
+    if (!kept_spans->empty()) {
+        subscribers(kept_spans);
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Completed retaining spans.");
+}
@@ -0,0 +1,155 @@
+#include "gauge/thread_filter.hpp"
+#include "gauge/utils/clock.hpp"
+#include "gauge/utils/common.hpp"
+#include "gauge/utils/gil.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Get name of the thread from threading module's registry of threads.
+ *
+ * Empty string is returned for threads unknown to the threading module.
+ */
+std::string get_thread_name(unsigned long thread_id) {
+    detail::GILGuard gil_guard;
+    // Borrowed reference, threading is not imported if it is not there.
+    auto threading =
+        PyDict_GetItemString(PyImport_GetModuleDict(), "threading");
+    if (threading == nullptr) {
+        return {};
+    }
+    auto active = PyObject_GetAttrString(threading, "_active");
+    if (active == nullptr) {
+        PyErr_Clear();
+        return {};
+    }
+    std::string name;
+    auto        key = PyLong_FromUnsignedLong(thread_id);
+    if (key != nullptr && PyDict_Check(active)) {
+        auto thread = PyDict_GetItem(active, key);
+        if (thread != nullptr) {
+            // Read the attribute behind Thread.name directly so that no
+            // Python code is executed and the GIL is never released.
+            auto attr_name = PyUnicode_InternFromString("_name");
+            auto py_name   = attr_name != nullptr
+                               ? PyObject_GenericGetAttr(thread, attr_name)
+                               : nullptr;
+            Py_XDECREF(attr_name);
+            if (py_name != nullptr && PyUnicode_Check(py_name)) {
+                name = detail::safe_encode(py_name);
+            }
+            Py_XDECREF(py_name);
+        }
+    }
+    Py_XDECREF(key);
+    Py_DECREF(active);
+    PyErr_Clear();
+    return name;
+}
+} // namespace
+
+void ThreadFilter::set_included_ids(
+    const std::vector<unsigned long long> &ids) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    included_ids = {ids.begin(), ids.end()};
+}
+
+void ThreadFilter::set_excluded_ids(
+    const std::vector<unsigned long long> &ids) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    excluded_ids = {ids.begin(), ids.end()};
+}
+
+void ThreadFilter::set_included_names(
+    const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    included_names = std::move(globs);
+    name_matches.clear();
+}
+
+void ThreadFilter::set_excluded_names(
+    const std::vector<std::string> &patterns) {
+    auto globs = detail::GlobSet(patterns);
+
+    const std::lock_guard<std::mutex> guard(mutex);
+    excluded_names = std::move(globs);
+    name_matches.clear();
+}
+
+void ThreadFilter::set_only_active(bool only_active) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    this->only_active = only_active;
+}
+
+bool ThreadFilter::is_only_active() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return only_active;
+}
+
+void ThreadFilter::mark_active(unsigned long long thread_id) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    active_ids.insert(thread_id);
+}
+
+void ThreadFilter::mark_inactive(unsigned long long thread_id) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    active_ids.erase(thread_id);
+}
+
+ThreadFilter::NameMatch ThreadFilter::match_name(
+    PyThreadState *               thread_state,
+    std::unique_lock<std::mutex> &lock) {
+    const auto unique_id = detail::get_unique_thread_id(thread_state);
+    const auto now       = detail::get_fast_clock().now();
+    auto       it        = name_matches.find(unique_id);
+    if (it != name_matches.end() && it->second.expires_at > now) {
+        return it->second;
+    }
+    // The GIL has to be taken before the mutex, so release it while the name
+    // is resolved.
+    lock.unlock();
+    const auto name = get_thread_name(thread_state->thread_id);
+    lock.lock();
+    static constexpr auto max_name_matches = 10000;
+    if (name_matches.size() >= max_name_matches) {
+        name_matches.clear();
+    }
+    NameMatch match;
+    match.is_included = included_names.matches(name);
+    match.is_excluded = excluded_names.matches(name);
+    match.expires_at  = now + name_match_ttl;
+    if (name.empty()) {
+        // The thread could be sampled before it registers in threading.
+        name_matches.erase(unique_id);
+    } else {
+        name_matches[unique_id] = match;
+    }
+    return match;
+}
+
+bool ThreadFilter::is_sampled(PyThreadState *thread_state) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const unsigned long long     thread_id = thread_state->thread_id;
+    if (excluded_ids.count(thread_id) != 0) {
+        return false;
+    }
+    if (only_active && active_ids.count(thread_id) == 0) {
+        return false;
+    }
+    if (included_names.empty() && excluded_names.empty()) {
+        return included_ids.empty() || included_ids.count(thread_id) != 0;
+    }
+    const auto name_match = match_name(thread_state, lock);
+    if (name_match.is_excluded) {
+        return false;
+    }
+    if (included_ids.empty() && included_names.empty()) {
+        return true;
+    }
+    return included_ids.count(thread_id) != 0 || name_match.is_included;
+}
+
+constexpr std::chrono::seconds ThreadFilter::name_match_ttl;
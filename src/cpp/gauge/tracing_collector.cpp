@@ -0,0 +1,428 @@
+#include <algorithm>
+
+#include <boost/asio/ip/host_name.hpp>
+#include <boost/process/environment.hpp>
+#include <spdlog/spdlog.h>
+
+#include "gauge/tracing_collector.hpp"
+#include "gauge/utils/clock.hpp"
+#include "gauge/utils/common.hpp"
+#include "gauge/utils/gil.hpp"
+#include "gauge/utils/logging.hpp"
+
+using namespace gauge;
+
+namespace {
+std::atomic<std::uint64_t> last_instance_id{0};
+
+/**
+ * Per-thread cache of the thread's buffer of the latest used collector.
+ */
+struct ThreadBufferCache {
+    std::uint64_t         instance_id = 0;
+    std::shared_ptr<void> buffer;
+};
+thread_local ThreadBufferCache thread_buffer_cache;
+
+/**
+ * Set the profile function of any thread, same as PyEval_SetProfile()
+ * does for the current thread.
+ */
+void set_profile(
+    PyThreadState *thread_state,
+    Py_tracefunc   function,
+    PyObject *     object) {
+    PyObject *previous_object = thread_state->c_profileobj;
+    Py_XINCREF(object);
+    thread_state->c_profilefunc = nullptr;
+    thread_state->c_profileobj  = nullptr;
+    thread_state->use_tracing   = thread_state->c_tracefunc != nullptr;
+    Py_XDECREF(previous_object);
+    thread_state->c_profilefunc = function;
+    thread_state->c_profileobj  = object;
+    thread_state->use_tracing =
+        (function != nullptr) || (thread_state->c_tracefunc != nullptr);
+}
+} // namespace
+
+TracingCollector::TracingCollector(
+    std::chrono::steady_clock::duration processing_interval)
+    : instance_id{++last_instance_id}, logger{detail::get_logger()},
+      clocks_base_measurements{detail::get_system_clock_mapping().get()},
+      processing_interval{processing_interval}, is_stopped_flag{true},
+      is_paused_flag{false}, next_cookie{1}, session{0},
+      dropped_events_count{0},
+      hostname{boost::asio::ip::host_name()},
+      process_id{static_cast<unsigned long long>(
+          boost::this_process::get_id())} {}
+
+TracingCollector::~TracingCollector() {
+    if (!is_stopped_flag) {
+        detail::GILGuard gil_guard;
+        stop();
+    }
+}
+
+void TracingCollector::subscribe(
+    CallbackInterface &    callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(callback, options);
+}
+
+void TracingCollector::subscribe(
+    py::object             callback,
+    const DispatchOptions &options) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    subscribers.subscribe(std::move(callback), options);
+}
+
+std::vector<DispatchStats> TracingCollector::get_dispatch_stats() const {
+    return subscribers.get_dispatch_stats();
+}
+
+void TracingCollector::set_traced_functions(
+    const std::vector<py::object> &functions) {
+    std::vector<py::object> code_objects;
+    decltype(traced_codes)  codes;
+    for (const auto &function : functions) {
+        auto code_object = function;
+        if (!PyCode_Check(code_object.ptr())) {
+            code_object = function.attr("__code__");
+            if (!PyCode_Check(code_object.ptr())) {
+                throw CollectorError();
+            }
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto code = reinterpret_cast<PyCodeObject *>(code_object.ptr());
+        auto it   = traced_codes.find(code);
+        if (it != traced_codes.end()) {
+            codes.emplace(code, it->second);
+        } else {
+            detail::CodeInfo info;
+            info.name              = detail::safe_encode(code->co_name);
+            info.file_name         = detail::safe_encode(code->co_filename);
+            info.first_line_number = code->co_firstlineno;
+            code_infos.emplace_back(std::move(info));
+            codes.emplace(code, &code_infos.back());
+        }
+        code_objects.emplace_back(std::move(code_object));
+    }
+    traced_codes        = std::move(codes);
+    traced_code_objects = std::move(code_objects);
+}
+
+unsigned long long TracingCollector::get_dropped_events_count() const {
+    return dropped_events_count;
+}
+
+void TracingCollector::start() {
+    SPDLOG_LOGGER_DEBUG(logger, "Starting tracing collector...");
+    if (!is_stopped_flag) {
+        throw CollectorHasAlreadyStarted();
+    }
+    {
+        // The processor thread has been joined, so stacks of the previous
+        // session can't be used for unchanged traces of this one.
+        const std::lock_guard<std::mutex> guard(buffers_mutex);
+        for (const auto &buffer : buffers) {
+            buffer->processed_stack.clear();
+        }
+    }
+    session.fetch_add(1, std::memory_order_relaxed);
+    profile_object  = py::capsule(this);
+    is_stopped_flag = false;
+    // Threads started later replace this Python-level profile function
+    // with the native one on their first event.
+    auto bootstrap = py::cpp_function(
+        [this](
+            const py::object & /* frame */,
+            const py::object & /* event */,
+            const py::object & /* arg */) {
+            if (is_stopped_flag) {
+                set_profile(PyThreadState_Get(), nullptr, nullptr);
+            } else {
+                install(PyThreadState_Get());
+            }
+            return py::none();
+        });
+    py::module::import("threading").attr("setprofile")(bootstrap);
+    for (auto thread_state =
+             PyInterpreterState_ThreadHead(PyThreadState_Get()->interp);
+         thread_state != nullptr;
+         thread_state = PyThreadState_Next(thread_state)) {
+        install(thread_state);
+    }
+    processor_thread = std::thread([this] { this->processor(); });
+    SPDLOG_LOGGER_DEBUG(logger, "Started tracing collector.");
+}
+
+void TracingCollector::stop() {
+    SPDLOG_LOGGER_DEBUG(logger, "Stopping tracing collector...");
+    if (is_stopped_flag) {
+        return;
+    }
+    py::module::import("threading").attr("setprofile")(py::none());
+    for (auto thread_state =
+             PyInterpreterState_ThreadHead(PyThreadState_Get()->interp);
+         thread_state != nullptr;
+         thread_state = PyThreadState_Next(thread_state)) {
+        uninstall(thread_state);
+    }
+    is_stopped_flag = true;
+    if (processor_thread.joinable()) {
+        py::gil_scoped_release release;
+        processor_thread.join();
+        subscribers.flush();
+    }
+    profile_object = py::object();
+    SPDLOG_LOGGER_DEBUG(logger, "Stopped tracing collector.");
+}
+
+bool TracingCollector::is_stopped() const { return is_stopped_flag; }
+
+void TracingCollector::resume() {
+    if (is_stopped()) {
+        throw CollectorIsStopped();
+    }
+    if (!is_paused_flag) {
+        throw CollectorIsNotPaused();
+    }
+    is_paused_flag = false;
+}
+
+bool TracingCollector::is_paused() { return is_paused_flag; }
+
+void TracingCollector::pause() {
+    if (is_paused_flag) {
+        throw CollectorIsAlreadyPaused();
+    }
+    is_paused_flag = true;
+}
+
+void TracingCollector::install(PyThreadState *thread_state) {
+    set_profile(
+        thread_state,
+        &TracingCollector::profile,
+        profile_object.ptr());
+}
+
+void TracingCollector::uninstall(PyThreadState *thread_state) {
+    if (thread_state->c_profileobj == profile_object.ptr()) {
+        set_profile(thread_state, nullptr, nullptr);
+    }
+}
+
+int TracingCollector::profile(
+    PyObject *     object,
+    PyFrameObject *frame,
+    int            what,
+    PyObject * /* arg */) {
+    if (what != PyTrace_CALL && what != PyTrace_RETURN) {
+        return 0;
+    }
+    auto self =
+        static_cast<TracingCollector *>(PyCapsule_GetPointer(object, nullptr));
+    if (self == nullptr) {
+        PyErr_Clear();
+        return 0;
+    }
+    if (what == PyTrace_CALL) {
+        if (self->is_paused_flag) {
+            return 0;
+        }
+        auto it = self->traced_codes.find(frame->f_code);
+        if (it == self->traced_codes.end()) {
+            return 0;
+        }
+        auto &buffer = self->get_thread_buffer();
+        Event event;
+        event.kind   = Event::Call;
+        event.code   = it->second;
+        event.cookie =
+            self->next_cookie.fetch_add(1, std::memory_order_relaxed);
+        event.timestamp = detail::get_fast_clock().now_precise();
+        buffer.stack.push_back({frame, event.cookie});
+        event.depth = buffer.stack.size();
+        self->record(buffer, event);
+        return 0;
+    }
+    if (self->traced_codes.count(frame->f_code) == 0) {
+        // Returns of untraced frames are the most frequent events.
+        return 0;
+    }
+    auto &buffer = self->get_thread_buffer();
+    if (buffer.stack.empty() || buffer.stack.back().frame != frame) {
+        // The call has happened before the collector has been started.
+        return 0;
+    }
+    Event event;
+    event.kind      = Event::Return;
+    event.cookie    = buffer.stack.back().cookie;
+    event.depth     = buffer.stack.size();
+    event.timestamp = detail::get_fast_clock().now_precise();
+    buffer.stack.pop_back();
+    self->record(buffer, event);
+    return 0;
+}
+
+TracingCollector::ThreadBuffer &TracingCollector::get_thread_buffer() {
+    auto &cache = thread_buffer_cache;
+    if (cache.instance_id != instance_id) {
+        auto buffer =
+            std::make_shared<ThreadBuffer>(PyThread_get_thread_ident());
+        {
+            const std::lock_guard<std::mutex> guard(buffers_mutex);
+            buffers.push_back(buffer);
+        }
+        cache.instance_id = instance_id;
+        cache.buffer      = buffer;
+    }
+    auto &buffer = *static_cast<ThreadBuffer *>(cache.buffer.get());
+    if (buffer.session != session.load(std::memory_order_relaxed)) {
+        // Frames of the previous session could have returned untraced and
+        // their addresses could have been reused since.
+        buffer.stack.clear();
+        buffer.session = session.load(std::memory_order_relaxed);
+    }
+    return buffer;
+}
+
+void TracingCollector::record(ThreadBuffer &buffer, const Event &event) {
+    if (!buffer.events.push(event)) {
+        dropped_events_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TracingCollector::processor() {
+    SPDLOG_LOGGER_DEBUG(logger, "Launching processing of traced events...");
+    static constexpr auto sleep_interval = std::chrono::milliseconds(1);
+    try {
+        auto previous_timestamp = std::chrono::steady_clock::now();
+        while (!is_stopped_flag) {
+            std::this_thread::sleep_for(sleep_interval);
+            detail::calibrate_clocks();
+            auto current_timestamp = std::chrono::steady_clock::now();
+            if ((current_timestamp - previous_timestamp) <
+                processing_interval) {
+                continue;
+            }
+            previous_timestamp = current_timestamp;
+            process_events();
+        }
+        process_events();
+    } catch (const std::exception &e) {
+        SPDLOG_LOGGER_ERROR(
+            logger,
+            "Processing of traced events has stopped due to the exception: "
+            "\"{}\".",
+            e.what());
+        return;
+    }
+    SPDLOG_LOGGER_DEBUG(logger, "Processing of traced events has stopped.");
+}
+
+void TracingCollector::process_events() {
+    // Taken before draining so that all of the drained events are older.
+    const auto now = detail::get_fast_clock().now_precise();
+    // All of the traces of the batch are converted the same way.
+    clocks_base_measurements = detail::get_system_clock_mapping().get();
+    std::vector<std::shared_ptr<ThreadBuffer>> current_buffers;
+    {
+        const std::lock_guard<std::mutex> guard(buffers_mutex);
+        // Forget buffers of exited threads.
+        buffers.erase(
+            std::remove_if(
+                buffers.begin(),
+                buffers.end(),
+                [](const std::shared_ptr<ThreadBuffer> &buffer) {
+                    return buffer.use_count() == 1 && buffer->events.empty();
+                }),
+            buffers.end());
+        current_buffers = buffers;
+    }
+    const bool has_dropped_batches = subscribers.check_dropped_batches();
+    auto       traces =
+        std::make_shared<std::vector<std::shared_ptr<TraceSample>>>();
+    for (const auto &buffer : current_buffers) {
+        auto &stack      = buffer->processed_stack;
+        bool  has_events = false;
+        Event event;
+        while (buffer->events.pop(event)) {
+            has_events = true;
+            // Depths restore consistency if some events were dropped.
+            if (event.kind == Event::Call) {
+                stack.resize(std::min(stack.size(), event.depth - 1));
+                stack.emplace_back(event.code, event.cookie);
+                traces->emplace_back(
+                    construct_trace(*buffer, event.timestamp));
+                continue;
+            }
+            stack.resize(std::min(stack.size(), event.depth));
+            if (stack.empty() || stack.back().second != event.cookie) {
+                continue;
+            }
+            // The returning frame is seen for the last time at this moment.
+            traces->emplace_back(construct_trace(*buffer, event.timestamp));
+            stack.pop_back();
+            if (!stack.empty()) {
+                // So that unchanged traces don't extend the ended span.
+                traces->emplace_back(
+                    construct_trace(*buffer, event.timestamp));
+            }
+        }
+        if (!has_events && !stack.empty()) {
+            // Keep spans of still running calls open, whole stacks are
+            // repeated if queued subscribers have missed them.
+            traces->emplace_back(
+                construct_trace(*buffer, now, !has_dropped_batches));
+        }
+    }
+    if (traces->empty()) {
+        return;
+    }
+    std::stable_sort(
+        traces->begin(),
+        traces->end(),
+        [](const std::shared_ptr<TraceSample> &a,
+           const std::shared_ptr<TraceSample> &b) {
+            return a->monotonic_clock_timestamp <
+                   b->monotonic_clock_timestamp;
+        });
+    subscribers(traces);
+}
+
+std::shared_ptr<TraceSample> TracingCollector::construct_trace(
+    const ThreadBuffer &                  buffer,
+    std::chrono::steady_clock::time_point monotonic_clock_timestamp,
+    bool                                  is_unchanged) {
+    auto trace_sample = std::make_shared<TraceSample>();
+    trace_sample->frames =
+        std::make_shared<std::vector<std::shared_ptr<Frame>>>();
+    trace_sample->monotonic_clock_timestamp = monotonic_clock_timestamp;
+    trace_sample->timestamp = TimePointConversionUtil::convert_time_point(
+        monotonic_clock_timestamp,
+        clocks_base_measurements);
+    trace_sample->thread_id  = buffer.thread_id;
+    trace_sample->process_id = process_id;
+    trace_sample->hostname   = hostname;
+    if (is_unchanged) {
+        trace_sample->is_unchanged = true;
+        return trace_sample;
+    }
+    // Bottommost frame goes first.
+    const auto &stack = buffer.processed_stack;
+    for (auto it = stack.rbegin(); it != stack.rend(); it++) {
+        auto frame           = std::make_shared<Frame>();
+        frame->symbolic_name = it->first->name;
+        frame->file_name     = it->first->file_name;
+        frame->line_number   = it->first->first_line_number;
+        frame->is_coroutine  = false;
+        frame->is_generator  = false;
+        frame->cookie        = it->second;
+        trace_sample->frames->emplace_back(std::move(frame));
+    }
+    return trace_sample;
+}
+
+const CollectionMethod TracingCollector::collection_method;
@@ -0,0 +1,191 @@
+#ifndef GAUGE_ASYNC_DISPATCHER_HPP
+#define GAUGE_ASYNC_DISPATCHER_HPP
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <spdlog/logger.h>
+#include <spdlog/spdlog.h>
+
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/gil.hpp"
+#include "gauge/utils/logging.hpp"
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Passes batches to a callback from a dedicated thread through a bounded
+ * queue.
+ *
+ * Producers only wait for the callback when the queue is full and the
+ * policy is BackpressurePolicy::Block. Exceptions thrown by the callback
+ * are logged and the batch is counted as dispatched.
+ */
+template <typename BatchType> class AsyncDispatcher {
+public:
+    using Callback = std::function<void(const BatchType &)>;
+
+    AsyncDispatcher(Callback callback, const DispatchOptions &options)
+        : logger{get_logger()}, callback{std::move(callback)},
+          capacity{std::max<std::size_t>(options.queue_capacity, 1)},
+          policy{options.policy} {
+        thread = std::thread([this] { this->dispatcher(); });
+    }
+
+    AsyncDispatcher(const AsyncDispatcher &)     = delete;
+    AsyncDispatcher(AsyncDispatcher &&) noexcept = delete;
+    AsyncDispatcher &operator=(const AsyncDispatcher &) = delete;
+    AsyncDispatcher &operator=(AsyncDispatcher &&) = delete;
+
+    /**
+     * Dispatch the remaining batches and stop the thread.
+     */
+    ~AsyncDispatcher() {
+        GILRelease gil_release;
+        {
+            const std::lock_guard<std::mutex> guard(mutex);
+            is_stopped = true;
+        }
+        queue_changed.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Queue the batch according to the policy.
+     */
+    void push(const BatchType &batch) {
+        // Destroyed after the lock, so the GIL is re-acquired without
+        // holding the mutex.
+        std::unique_ptr<GILRelease>  gil_release;
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.size() >= capacity) {
+            switch (policy) {
+            case BackpressurePolicy::Block:
+                // The callback could need the GIL to free the space.
+                gil_release = std::make_unique<GILRelease>();
+                queue_changed.wait(
+                    lock,
+                    [this] { return queue.size() < capacity || is_stopped; });
+                break;
+            case BackpressurePolicy::DropOldest:
+                queue.pop_front();
+                dropped_count++;
+                break;
+            case BackpressurePolicy::DropNewest:
+            case BackpressurePolicy::SampleDown:
+                dropped_count++;
+                return;
+            }
+        } else if (
+            policy == BackpressurePolicy::SampleDown &&
+            queue.size() >= capacity / 2) {
+            // Every other batch is dropped.
+            if (sample_down_count++ % 2 != 0) {
+                dropped_count++;
+                return;
+            }
+        }
+        queue.emplace_back(batch, std::chrono::steady_clock::now());
+        lock.unlock();
+        queue_changed.notify_all();
+    }
+
+    /**
+     * Wait until all of the queued batches are dispatched.
+     */
+    void flush() {
+        GILRelease                   gil_release;
+        std::unique_lock<std::mutex> lock(mutex);
+        queue_changed.wait(
+            lock,
+            [this] { return queue.empty() && !is_dispatching; });
+    }
+
+    unsigned long long get_dropped_count() {
+        const std::lock_guard<std::mutex> guard(mutex);
+        return dropped_count;
+    }
+
+    DispatchStats get_stats() {
+        const std::lock_guard<std::mutex> guard(mutex);
+        DispatchStats                     stats;
+        stats.queue_capacity   = capacity;
+        stats.queue_size       = queue.size();
+        stats.policy           = policy;
+        stats.dispatched_count = dispatched_count;
+        stats.dropped_count    = dropped_count;
+        stats.max_lag          = max_lag;
+        if (!queue.empty()) {
+            stats.lag =
+                std::chrono::steady_clock::now() - queue.front().second;
+        }
+        return stats;
+    }
+
+private:
+    std::shared_ptr<spdlog::logger> logger;
+    Callback                        callback;
+    const std::size_t               capacity;
+    const BackpressurePolicy        policy;
+
+    std::mutex              mutex;
+    std::condition_variable queue_changed;
+    std::deque<std::pair<BatchType, std::chrono::steady_clock::time_point>>
+                                        queue;
+    bool                                is_stopped        = false;
+    bool                                is_dispatching    = false;
+    unsigned long long                  dispatched_count  = 0;
+    unsigned long long                  dropped_count     = 0;
+    unsigned long long                  sample_down_count = 0;
+    std::chrono::steady_clock::duration max_lag{0};
+    std::thread                         thread;
+
+    void dispatcher() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            queue_changed.wait(
+                lock,
+                [this] { return !queue.empty() || is_stopped; });
+            if (queue.empty()) {
+                break;
+            }
+            {
+                auto batch = std::move(queue.front());
+                queue.pop_front();
+                max_lag = std::max<std::chrono::steady_clock::duration>(
+                    max_lag,
+                    std::chrono::steady_clock::now() - batch.second);
+                is_dispatching = true;
+                lock.unlock();
+                queue_changed.notify_all();
+                try {
+                    callback(batch.first);
+                } catch (const std::exception &e) {
+                    SPDLOG_LOGGER_ERROR(
+                        logger,
+                        "Subscriber has failed with the exception: \"{}\".",
+                        e.what());
+                }
+            }
+            lock.lock();
+            is_dispatching = false;
+            dispatched_count++;
+            queue_changed.notify_all();
+        }
+    }
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_ASYNC_DISPATCHER_HPP
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <limits>
+
+#include <time.h>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#include <x86intrin.h>
+#define GAUGE_HAS_TSC
+#endif
+
+#include "gauge/utils/clock.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Interval between calibrations of the project-wide clocks.
+ */
+constexpr auto calibration_interval = std::chrono::seconds(1);
+/**
+ * Shortest interval the frequency of the TSC is measured over.
+ */
+constexpr auto min_calibration_window = std::chrono::milliseconds(10);
+/**
+ * Interval an offset from the steady clock is slewed away over, unless
+ * the rate of slewing is too high.
+ */
+constexpr auto slew_interval = std::chrono::seconds(1);
+
+/**
+ * Check that the TSC ticks at a constant rate regardless of power states.
+ */
+bool is_invariant_tsc_supported() {
+#ifdef GAUGE_HAS_TSC
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+    return (edx & (1U << 8U)) != 0;
+#else
+    return false;
+#endif
+}
+} // namespace
+
+detail::FastClock::FastClock(std::chrono::nanoseconds max_coarse_resolution)
+    : is_tsc_invariant{is_invariant_tsc_supported()} {
+#ifdef CLOCK_MONOTONIC_COARSE
+    timespec resolution{};
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &resolution) == 0) {
+        is_coarse_usable =
+            (std::chrono::seconds(resolution.tv_sec) +
+             std::chrono::nanoseconds(resolution.tv_nsec)) <=
+            max_coarse_resolution;
+    }
+#else
+    (void)max_coarse_resolution;
+#endif
+    if (is_tsc_invariant) {
+        measure(reference_ticks, reference_time_point);
+    }
+}
+
+detail::FastClock::FastClock(Sources sources)
+    : sources{std::move(sources)}, is_tsc_invariant{true} {
+    measure(reference_ticks, reference_time_point);
+}
+
+std::chrono::steady_clock::time_point
+detail::FastClock::now() const noexcept {
+    std::chrono::steady_clock::time_point time_point;
+    if (read_tsc(time_point)) {
+        return time_point;
+    }
+    if (is_coarse_usable) {
+        return read_coarse();
+    }
+    return read_steady();
+}
+
+std::chrono::steady_clock::time_point
+detail::FastClock::now_precise() const noexcept {
+    std::chrono::steady_clock::time_point time_point;
+    if (read_tsc(time_point)) {
+        return time_point;
+    }
+    return read_steady();
+}
+
+void detail::FastClock::calibrate() {
+    if (!is_tsc_invariant) {
+        return;
+    }
+    const std::lock_guard<std::mutex> guard(calibration_mutex);
+    std::uint64_t                         ticks = 0;
+    std::chrono::steady_clock::time_point time_point;
+    measure(ticks, time_point);
+    if (ticks <= reference_ticks ||
+        (time_point - reference_time_point) < min_calibration_window) {
+        // Too early to measure the frequency precisely.
+        return;
+    }
+    const auto rate =
+        static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                time_point - reference_time_point)
+                .count()) /
+        static_cast<double>(ticks - reference_ticks);
+    std::int64_t nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time_point.time_since_epoch())
+            .count();
+    auto mapped_rate = rate;
+    // The previous mapping could be ahead of the steady clock, only this
+    // thread replaces it so it's read without the lock.
+    const auto previous_rate =
+        nanoseconds_per_tick.load(std::memory_order_relaxed);
+    const auto previous_ticks = base_ticks.load(std::memory_order_relaxed);
+    if (previous_rate != 0 && ticks > previous_ticks) {
+        const auto issued_nanoseconds =
+            base_nanoseconds.load(std::memory_order_relaxed) +
+            static_cast<std::int64_t>(
+                static_cast<double>(ticks - previous_ticks) * previous_rate);
+        if (issued_nanoseconds > nanoseconds) {
+            // Jumping back would make time-points go backwards, instead
+            // the mapping is slowed down until the steady clock catches up.
+            const auto offset = static_cast<double>(
+                issued_nanoseconds - nanoseconds);
+            const auto slew_rate = std::min(
+                max_slew_rate,
+                offset / static_cast<double>(
+                             std::chrono::duration_cast<
+                                 std::chrono::nanoseconds>(slew_interval)
+                                 .count()));
+            nanoseconds = issued_nanoseconds;
+            mapped_rate = rate * (1 - slew_rate);
+        }
+    }
+
+    const auto current_sequence = sequence.load(std::memory_order_relaxed);
+    sequence.store(current_sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_ticks.store(ticks, std::memory_order_relaxed);
+    base_nanoseconds.store(nanoseconds, std::memory_order_relaxed);
+    nanoseconds_per_tick.store(mapped_rate, std::memory_order_relaxed);
+    sequence.store(current_sequence + 2, std::memory_order_release);
+}
+
+detail::FastClock::Source detail::FastClock::get_source() const noexcept {
+    if (is_tsc_invariant &&
+        nanoseconds_per_tick.load(std::memory_order_relaxed) != 0) {
+        return Source::TSC;
+    }
+    if (is_coarse_usable) {
+        return Source::Coarse;
+    }
+    return Source::Steady;
+}
+
+std::uint64_t detail::FastClock::read_ticks() const noexcept {
+    if (sources.read_ticks) {
+        return sources.read_ticks();
+    }
+#ifdef GAUGE_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+std::chrono::steady_clock::time_point
+detail::FastClock::read_steady() const noexcept {
+    if (sources.read_steady) {
+        return sources.read_steady();
+    }
+    return std::chrono::steady_clock::now();
+}
+
+bool detail::FastClock::read_tsc(
+    std::chrono::steady_clock::time_point &time_point) const noexcept {
+    if (!is_tsc_invariant) {
+        return false;
+    }
+    const auto ticks = read_ticks();
+    while (true) {
+        const auto current_sequence = sequence.load(std::memory_order_acquire);
+        const auto rate = nanoseconds_per_tick.load(std::memory_order_relaxed);
+        const auto ticks_0 = base_ticks.load(std::memory_order_relaxed);
+        const auto nanoseconds_0 =
+            base_nanoseconds.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((current_sequence & 1U) != 0 ||
+            current_sequence != sequence.load(std::memory_order_relaxed)) {
+            // The mapping is being replaced.
+            continue;
+        }
+        if (rate == 0) {
+            return false;
+        }
+        // Ticks read on another core could be slightly behind the base.
+        const auto elapsed =
+            ticks > ticks_0 ? static_cast<std::int64_t>(
+                                  static_cast<double>(ticks - ticks_0) * rate)
+                            : 0;
+        time_point = std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::nanoseconds(nanoseconds_0 + elapsed)));
+        return true;
+    }
+}
+
+std::chrono::steady_clock::time_point
+detail::FastClock::read_coarse() const noexcept {
+#ifdef CLOCK_MONOTONIC_COARSE
+    // The steady clock is CLOCK_MONOTONIC which has the same epoch.
+    timespec value{};
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &value) == 0) {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::seconds(value.tv_sec) +
+                std::chrono::nanoseconds(value.tv_nsec)));
+    }
+#endif
+    return std::chrono::steady_clock::now();
+}
+
+void detail::FastClock::measure(
+    std::uint64_t &                        ticks,
+    std::chrono::steady_clock::time_point &time_point) const {
+    auto narrowest = std::numeric_limits<std::uint64_t>::max();
+    for (auto i = 0; i < 10; i++) {
+        const auto before  = read_ticks();
+        const auto between = read_steady();
+        const auto after   = read_ticks();
+        if (after >= before && (after - before) < narrowest) {
+            narrowest  = after - before;
+            ticks      = before + (after - before) / 2;
+            time_point = between;
+        }
+    }
+}
+
+detail::SystemClockMapping::SystemClockMapping()
+    : base_measurements{TimePointConversionUtil::get_base_measurements()} {}
+
+detail::SystemClockMapping::BaseMeasurements
+detail::SystemClockMapping::get() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return base_measurements;
+}
+
+void detail::SystemClockMapping::calibrate() {
+    const auto measurements = TimePointConversionUtil::get_base_measurements();
+    const std::lock_guard<std::mutex> guard(mutex);
+    base_measurements = measurements;
+}
+
+detail::FastClock &detail::get_fast_clock() {
+    static FastClock clock;
+    return clock;
+}
+
+detail::SystemClockMapping &detail::get_system_clock_mapping() {
+    static SystemClockMapping mapping;
+    return mapping;
+}
+
+void detail::calibrate_clocks() {
+    static std::atomic<std::chrono::steady_clock::rep> last_calibration{0};
+    const auto now      = std::chrono::steady_clock::now().time_since_epoch();
+    auto       previous = last_calibration.load(std::memory_order_relaxed);
+    if (now - std::chrono::steady_clock::duration(previous) <
+        calibration_interval) {
+        return;
+    }
+    // Only one of the concurrent callers calibrates.
+    if (!last_calibration.compare_exchange_strong(previous, now.count())) {
+        return;
+    }
+    get_fast_clock().calibrate();
+    get_system_clock_mapping().calibrate();
+}
+
+constexpr double detail::FastClock::max_slew_rate;
@@ -0,0 +1,174 @@
+#ifndef GAUGE_CLOCK_HPP
+#define GAUGE_CLOCK_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "gauge/utils/chrono.hpp"
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Cheap source of time-points of the steady clock.
+ *
+ * Reads the invariant TSC when the CPU provides it and maps its ticks
+ * to the steady clock by calibration. Until the first calibration or
+ * without the invariant TSC the coarse monotonic clock is read if its
+ * resolution is fine enough, otherwise the steady clock itself.
+ *
+ * Thread-safe, the mapping is replaced atomically by calibrate().
+ */
+class FastClock {
+public:
+    enum class Source { Steady, Coarse, TSC };
+
+    /**
+     * Replacements of readings of the TSC and the steady clock.
+     */
+    struct Sources {
+        std::function<std::uint64_t()>                         read_ticks;
+        std::function<std::chrono::steady_clock::time_point()> read_steady;
+    };
+
+    /**
+     * @param max_coarse_resolution Worst resolution of the coarse clock
+     *        that is still acceptable.
+     */
+    explicit FastClock(
+        std::chrono::nanoseconds max_coarse_resolution =
+            std::chrono::milliseconds(1));
+    /**
+     * Clock reading the given sources, the TSC is considered invariant
+     * and the coarse clock isn't read. Meant for tests.
+     */
+    explicit FastClock(Sources sources);
+
+    std::chrono::steady_clock::time_point now() const noexcept;
+    /**
+     * Same as now() but never reads the coarse clock.
+     */
+    std::chrono::steady_clock::time_point now_precise() const noexcept;
+
+    /**
+     * Measure frequency of the TSC against the steady clock.
+     *
+     * The frequency is measured since construction of the clock, so that
+     * it gets more precise with time. Time-points never go backwards when
+     * the mapping is replaced - if the previous mapping has run ahead of
+     * the steady clock, it's continued at a slightly lower rate until
+     * the steady clock catches up.
+     */
+    void calibrate();
+
+    /**
+     * Get the clock that is currently read.
+     */
+    Source get_source() const noexcept;
+
+private:
+    /*! Highest relative rate an offset from the steady clock is slewed. */
+    static constexpr double max_slew_rate = 0.0005;
+
+    Sources sources;
+    bool    is_tsc_invariant = false;
+    bool    is_coarse_usable = false;
+
+    /**
+     * Ticks and time-point of the first calibration.
+     */
+    std::uint64_t                         reference_ticks = 0;
+    std::chrono::steady_clock::time_point reference_time_point;
+    /**
+     * Serializes calibrations.
+     */
+    std::mutex calibration_mutex;
+
+    /* --- Mapping of ticks, guarded by the sequence lock --- */
+    /**
+     * Odd while the mapping is being replaced.
+     */
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> base_ticks{0};
+    std::atomic<std::int64_t>  base_nanoseconds{0};
+    /**
+     * Zero until the TSC is calibrated.
+     */
+    std::atomic<double> nanoseconds_per_tick{0};
+
+    std::uint64_t                         read_ticks() const noexcept;
+    std::chrono::steady_clock::time_point read_steady() const noexcept;
+    /**
+     * Map ticks to the steady clock.
+     *
+     * @return False if the TSC isn't calibrated yet.
+     */
+    bool read_tsc(std::chrono::steady_clock::time_point &time_point) const
+        noexcept;
+    std::chrono::steady_clock::time_point read_coarse() const noexcept;
+    /**
+     * Read ticks and the steady clock as close to each other as possible.
+     */
+    void measure(
+        std::uint64_t &                        ticks,
+        std::chrono::steady_clock::time_point &time_point) const;
+};
+
+/**
+ * Mapping of steady clock time-points to the system clock.
+ *
+ * The system clock is adjusted by NTP while the steady clock drifts away
+ * from it, so the mapping has to be re-measured periodically.
+ *
+ * Thread-safe, the mapping is replaced atomically by calibrate().
+ */
+class SystemClockMapping {
+public:
+    using TimePointConversionUtil = detail::TimePointConversionUtil<
+        std::chrono::steady_clock,
+        std::chrono::system_clock>;
+    using BaseMeasurements = TimePointConversionUtil::BaseMeasurements;
+
+    SystemClockMapping();
+
+    /**
+     * Get the current mapping.
+     *
+     * Meant to be taken once per batch of time-points, so that all of them
+     * are converted consistently.
+     */
+    BaseMeasurements get();
+
+    /**
+     * Re-measure the mapping.
+     */
+    void calibrate();
+
+private:
+    std::mutex       mutex;
+    BaseMeasurements base_measurements;
+};
+
+/**
+ * Get the project-wide fast clock.
+ */
+FastClock &get_fast_clock();
+
+/**
+ * Get the project-wide mapping of the steady clock to the system clock.
+ */
+SystemClockMapping &get_system_clock_mapping();
+
+/**
+ * Calibrate the project-wide clocks if they weren't calibrated recently.
+ *
+ * Cheap otherwise, meant to be called periodically by background threads.
+ */
+void calibrate_clocks();
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_CLOCK_HPP
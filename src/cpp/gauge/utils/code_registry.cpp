@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "gauge/utils/code_registry.hpp"
+#include "gauge/utils/common.hpp"
+#include "gauge/utils/gil.hpp"
+
+using namespace gauge;
+
+constexpr std::size_t detail::CodeRegistry::min_prune_threshold;
+
+detail::CodeRegistry::~CodeRegistry() { clear(); }
+
+std::shared_ptr<const detail::CodeInfo>
+detail::CodeRegistry::get(PyCodeObject *code) {
+    auto it = entries.find(code);
+    if (it != entries.end()) {
+        if (is_alive(it->second, code)) {
+            return it->second.info;
+        }
+        // The address is reused by another code object.
+        Py_DECREF(it->second.code_ref);
+        entries.erase(it);
+    }
+    auto info = decode(code);
+    auto code_ref =
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        PyWeakref_NewRef(reinterpret_cast<PyObject *>(code), nullptr);
+    if (code_ref == nullptr) {
+        PyErr_Clear();
+        return info;
+    }
+    if (entries.size() >= prune_threshold) {
+        prune();
+    }
+    entries.emplace(code, Entry{code_ref, info});
+    return info;
+}
+
+void detail::CodeRegistry::clear() {
+    if (entries.empty()) {
+        return;
+    }
+    GILGuard gil_guard;
+    for (auto &entry : entries) {
+        Py_DECREF(entry.second.code_ref);
+    }
+    entries.clear();
+    prune_threshold = min_prune_threshold;
+}
+
+std::shared_ptr<const detail::CodeInfo>
+detail::CodeRegistry::decode(PyCodeObject *code) {
+    auto info               = std::make_shared<CodeInfo>();
+    info->name              = safe_encode(code->co_name);
+    info->file_name         = safe_encode(code->co_filename);
+    info->first_line_number = code->co_firstlineno;
+    info->line_table        = std::string(
+        PyBytes_AS_STRING(code->co_lnotab),
+        PyBytes_GET_SIZE(code->co_lnotab));
+    return info;
+}
+
+bool detail::CodeRegistry::is_alive(const Entry &entry, PyCodeObject *code) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return PyWeakref_GET_OBJECT(entry.code_ref) ==
+           reinterpret_cast<PyObject *>(code);
+}
+
+void detail::CodeRegistry::prune() {
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (is_alive(it->second, it->first)) {
+            it++;
+        } else {
+            Py_DECREF(it->second.code_ref);
+            it = entries.erase(it);
+        }
+    }
+    prune_threshold = std::max(min_prune_threshold, 2 * entries.size());
+}
@@ -0,0 +1,65 @@
+#ifndef GAUGE_CODE_REGISTRY_HPP
+#define GAUGE_CODE_REGISTRY_HPP
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+
+#include <Python.h>
+
+#include "gauge/utils/frame_snapshot.hpp"
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Cache of decoded names and line tables of live code objects.
+ *
+ * Entries are created lazily on the first lookup of a code object. Each
+ * entry holds a weak reference to its code object, so an entry of
+ * a destroyed code object is never returned for another one allocated at
+ * the same address, such entries are rebuilt or pruned.
+ *
+ * Lines are resolved from the copied line tables, without the GIL.
+ *
+ * Not thread-safe, should be used with the GIL held.
+ */
+class CodeRegistry {
+public:
+    CodeRegistry() = default;
+    CodeRegistry(const CodeRegistry &) = delete;
+    CodeRegistry(CodeRegistry &&)      = delete;
+    CodeRegistry &operator=(const CodeRegistry &) = delete;
+    CodeRegistry &operator=(CodeRegistry &&) = delete;
+    ~CodeRegistry();
+
+    std::shared_ptr<const CodeInfo> get(PyCodeObject *code);
+
+    void clear();
+
+private:
+    struct Entry {
+        /**
+         * Owned weak reference to the code object.
+         */
+        PyObject *                      code_ref = nullptr;
+        std::shared_ptr<const CodeInfo> info;
+    };
+
+    static constexpr std::size_t min_prune_threshold = 1024;
+
+    std::unordered_map<PyCodeObject *, Entry> entries;
+    std::size_t                               prune_threshold =
+        min_prune_threshold;
+
+    static std::shared_ptr<const CodeInfo> decode(PyCodeObject *code);
+    static bool is_alive(const Entry &entry, PyCodeObject *code);
+    /**
+     * Drop entries of destroyed code objects.
+     */
+    void prune();
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_CODE_REGISTRY_HPP
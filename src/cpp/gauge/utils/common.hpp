@@ -4,6 +4,7 @@
 
 #ifndef GAUGE_COMMON_HPP
 #define GAUGE_COMMON_HPP
+#include <cstdint>
 #include <string>
 
 #include <Python.h>
@@ -24,6 +25,18 @@ inline std::string safe_encode(PyObject *unicode) {
     return result;
 }
 
+/**
+ * Get ID of the thread state which is unique during the process lifetime,
+ * unlike thread IDs which could be reused.
+ */
+inline std::uint64_t get_unique_thread_id(const PyThreadState *thread_state) {
+#if PY_VERSION_HEX >= 0x03070000
+    return thread_state->id;
+#else
+    return thread_state->thread_id;
+#endif
+}
+
 } // namespace detail
 } // namespace gauge
 
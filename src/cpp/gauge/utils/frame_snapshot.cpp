@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "gauge/base.hpp"
+#include "gauge/utils/frame_snapshot.hpp"
+#include "gauge/utils/process_symbols.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Leading fields of PyInterpreterState which is opaque since Python 3.8.
+ *
+ * These fields are the same in Python 3.5-3.8, the layout is verified
+ * at runtime anyway.
+ */
+struct InterpreterStateHead {
+    PyInterpreterState *next;
+    PyThreadState *     tstate_head;
+};
+
+template <typename T> std::uintptr_t to_address(T *pointer) {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return reinterpret_cast<std::uintptr_t>(pointer);
+}
+
+/**
+ * Find address of the pointer to the first interpreter in the process.
+ *
+ * Since Python 3.7 it's a field of _PyRuntime which structure is internal,
+ * the field's offset is found in the current process by the value of
+ * the pointer. Before that it's a static variable.
+ *
+ * @return Zero if it couldn't be found.
+ */
+std::uintptr_t find_interpreter_head(const detail::ProcessSymbols &symbols) {
+#if PY_VERSION_HEX >= 0x03070000
+    static constexpr std::size_t max_offset = 1024;
+
+    const auto runtime = symbols.find("_PyRuntime");
+    const auto own_runtime =
+        detail::ProcessSymbols(getpid()).find("_PyRuntime");
+    const auto *head = PyInterpreterState_Head();
+    if (runtime == 0 || own_runtime == 0 || head == nullptr) {
+        return 0;
+    }
+    for (std::size_t offset = 0; offset < max_offset;
+         offset += sizeof(PyInterpreterState *)) {
+        PyInterpreterState *value = nullptr;
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+        const auto *field = reinterpret_cast<void *>(own_runtime + offset);
+        std::memcpy(&value, field, sizeof(value));
+        if (value == head) {
+            return runtime + offset;
+        }
+    }
+    return 0;
+#else
+    return symbols.find("interp_head");
+#endif
+}
+
+void append_utf8(std::string &value, std::uint32_t code_point) {
+    if (code_point >= 0xD800 && code_point <= 0xDFFF) {
+        // Lone surrogates are replaced as with "replace" error handler.
+        code_point = 0xFFFD;
+    }
+    if (code_point < 0x80) {
+        value.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        value.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        value.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        value.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        value.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        value.push_back(
+            static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+template <typename CharType>
+void append_utf8(std::string &value, const std::string &data) {
+    const auto length = data.size() / sizeof(CharType);
+    for (std::size_t i = 0; i < length; i++) {
+        CharType character = 0;
+        std::copy_n(
+            data.data() + i * sizeof(CharType),
+            sizeof(CharType),
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            reinterpret_cast<char *>(&character));
+        append_utf8(value, character);
+    }
+}
+} // namespace
+
+int detail::CodeInfo::get_line_number(int lasti) const {
+    auto line_number = first_line_number;
+    auto address     = 0;
+    for (std::size_t i = 0; i + 1 < line_table.size(); i += 2) {
+        address += static_cast<unsigned char>(line_table[i]);
+        if (address > lasti) {
+            break;
+        }
+#if PY_VERSION_HEX >= 0x03060000
+        line_number += static_cast<signed char>(line_table[i + 1]);
+#else
+        line_number += static_cast<unsigned char>(line_table[i + 1]);
+#endif
+    }
+    return line_number;
+}
+
+detail::FrameSnapshotter::FrameSnapshotter(PyInterpreterState *interpreter)
+    : interpreter{interpreter},
+      thread_head_address{
+          to_address(interpreter) +
+          offsetof(InterpreterStateHead, tstate_head)} {
+    PyThreadState *thread_head = nullptr;
+    if (!ProcessMemory::is_supported() ||
+        !memory.read(thread_head_address, thread_head) ||
+        thread_head != PyInterpreterState_ThreadHead(interpreter)) {
+        throw CollectorError();
+    }
+    types.frame     = to_address(&PyFrame_Type);
+    types.code      = to_address(&PyCode_Type);
+    types.unicode   = to_address(&PyUnicode_Type);
+    types.bytes     = to_address(&PyBytes_Type);
+    types.coroutine = to_address(&PyCoro_Type);
+    types.generator = to_address(&PyGen_Type);
+}
+
+detail::FrameSnapshotter::FrameSnapshotter(pid_t pid)
+    : memory{pid}, interpreter{nullptr}, thread_head_address{0} {
+    if (!ProcessMemory::is_supported()) {
+        throw CollectorError();
+    }
+    const ProcessSymbols symbols(pid);
+    types.frame     = symbols.find("PyFrame_Type");
+    types.code      = symbols.find("PyCode_Type");
+    types.unicode   = symbols.find("PyUnicode_Type");
+    types.bytes     = symbols.find("PyBytes_Type");
+    types.coroutine = symbols.find("PyCoro_Type");
+    types.generator = symbols.find("PyGen_Type");
+    // Sizes of the objects differ between versions of Python.
+    if (!is_same_type(types.frame, PyFrame_Type) ||
+        !is_same_type(types.code, PyCode_Type) ||
+        !is_same_type(types.unicode, PyUnicode_Type) ||
+        !is_same_type(types.bytes, PyBytes_Type) ||
+        !is_same_type(types.coroutine, PyCoro_Type) ||
+        !is_same_type(types.generator, PyGen_Type)) {
+        throw CollectorError();
+    }
+    const auto head_address = find_interpreter_head(symbols);
+    if (head_address == 0 || !memory.read(head_address, interpreter) ||
+        interpreter == nullptr) {
+        throw CollectorError();
+    }
+    thread_head_address = to_address(interpreter) +
+                          offsetof(InterpreterStateHead, tstate_head);
+}
+
+bool detail::FrameSnapshotter::snapshot_threads(
+    std::vector<ThreadSnapshot> &threads) {
+    threads.clear();
+    PyThreadState *address = nullptr;
+    if (!memory.read(thread_head_address, address)) {
+        return false;
+    }
+    while (address != nullptr) {
+        if (threads.size() >= max_threads) {
+            return false;
+        }
+        threads.emplace_back();
+        auto &thread   = threads.back();
+        thread.address = to_address(address);
+        if (!memory.read(thread.address, thread.state) ||
+            thread.state.interp != interpreter) {
+            // The thread state has been freed while being read.
+            return false;
+        }
+        address = thread.state.next;
+    }
+    return true;
+}
+
+bool detail::FrameSnapshotter::snapshot_frames(
+    const ThreadSnapshot &      thread,
+    std::vector<FrameSnapshot> &frames) {
+    const auto current_frame_address =
+        thread.address + offsetof(PyThreadState, frame);
+    for (auto attempt = 0; attempt < max_attempts; attempt++) {
+        frames.clear();
+        PyFrameObject *frame = nullptr;
+        if (!memory.read(current_frame_address, frame)) {
+            return false;
+        }
+        if (!walk_frames(to_address(frame), frames) ||
+            !validate_frames(frames)) {
+            continue;
+        }
+        // Frames below the current one don't change until it is
+        // switched, so the same current frame after the walk means that
+        // the copy is consistent.
+        PyFrameObject *frame_after = nullptr;
+        if (!memory.read(current_frame_address, frame_after)) {
+            return false;
+        }
+        if (frame_after == frame) {
+            return true;
+        }
+    }
+    frames.clear();
+    return false;
+}
+
+bool detail::FrameSnapshotter::walk_frames(
+    std::uintptr_t              frame_address,
+    std::vector<FrameSnapshot> &frames) {
+    PyFrameObject frame;
+    frame_links.clear();
+    while (frame_address != 0) {
+        if (frames.size() >= max_depth) {
+            return false;
+        }
+        // Variable-size part of the frame is never needed.
+        if (!memory.read(
+                frame_address,
+                &frame,
+                offsetof(PyFrameObject, f_localsplus)) ||
+            to_address(Py_TYPE(&frame)) != types.frame) {
+            return false;
+        }
+        FrameSnapshot snapshot;
+        snapshot.address = frame_address;
+        snapshot.lasti   = frame.f_lasti;
+        snapshot.code    = resolve_code(to_address(frame.f_code));
+        if (!snapshot.code) {
+            return false;
+        }
+        if (frame.f_gen != nullptr) {
+            PyObject generator;
+            if (!memory.read(frame.f_gen, generator)) {
+                return false;
+            }
+            const auto type       = to_address(Py_TYPE(&generator));
+            snapshot.is_coroutine = type == types.coroutine;
+            snapshot.is_generator = type == types.generator;
+        }
+        frames.emplace_back(std::move(snapshot));
+        frame_address = to_address(frame.f_back);
+        frame_links.push_back({to_address(frame.f_code), frame_address});
+    }
+    return true;
+}
+
+bool detail::FrameSnapshotter::validate_frames(
+    const std::vector<FrameSnapshot> &frames) {
+    PyFrameObject frame;
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        if (!memory.read(
+                frames[i].address,
+                &frame,
+                offsetof(PyFrameObject, f_localsplus)) ||
+            to_address(Py_TYPE(&frame)) != types.frame ||
+            to_address(frame.f_code) != frame_links[i].code ||
+            to_address(frame.f_back) != frame_links[i].back) {
+            return false;
+        }
+        // Only the current frame is executed, callers wait at the same
+        // instruction until it returns.
+        if (i != 0 && frame.f_lasti != frames[i].lasti) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const detail::CodeInfo>
+detail::FrameSnapshotter::resolve_code(std::uintptr_t address) {
+    PyCodeObject code;
+    if (!memory.read(address, code) ||
+        to_address(Py_TYPE(&code)) != types.code) {
+        return nullptr;
+    }
+    const CodeKey key{
+        code.co_name,
+        code.co_filename,
+        code.co_lnotab,
+        code.co_firstlineno};
+    auto it = codes.find(address);
+    if (it != codes.end() && it->second.key == key) {
+        return it->second.info;
+    }
+    auto info               = std::make_shared<CodeInfo>();
+    info->first_line_number = code.co_firstlineno;
+    if (!read_unicode(code.co_name, info->name) ||
+        !read_unicode(code.co_filename, info->file_name) ||
+        !read_bytes(code.co_lnotab, info->line_table)) {
+        return nullptr;
+    }
+    if (codes.size() >= max_codes) {
+        codes.clear();
+    }
+    codes[address] = {key, info};
+    return info;
+}
+
+bool detail::FrameSnapshotter::read_unicode(
+    PyObject *   address,
+    std::string &value) {
+    PyCompactUnicodeObject unicode;
+    if (!memory.read(address, unicode._base) ||
+        to_address(Py_TYPE(&unicode._base)) != types.unicode) {
+        return false;
+    }
+    const auto &state  = unicode._base.state;
+    const auto  length = unicode._base.length;
+    if (!state.compact || !state.ready || length < 0 ||
+        length > max_string_length) {
+        // Legacy strings are never used for names of code objects.
+        return false;
+    }
+    if (state.ascii) {
+        value.resize(length);
+        return memory.read(
+            to_address(address) + sizeof(PyASCIIObject),
+            &value[0],
+            value.size());
+    }
+    if (!memory.read(address, unicode)) {
+        return false;
+    }
+    if (unicode.utf8 != nullptr && unicode.utf8_length >= 0 &&
+        unicode.utf8_length <= max_string_length * 4) {
+        value.resize(unicode.utf8_length);
+        return memory.read(
+            to_address(unicode.utf8),
+            &value[0],
+            value.size());
+    }
+    std::string data(length * state.kind, '\0');
+    if (!memory.read(
+            to_address(address) + sizeof(PyCompactUnicodeObject),
+            &data[0],
+            data.size())) {
+        return false;
+    }
+    value.clear();
+    switch (state.kind) {
+    case PyUnicode_1BYTE_KIND:
+        append_utf8<Py_UCS1>(value, data);
+        break;
+    case PyUnicode_2BYTE_KIND:
+        append_utf8<Py_UCS2>(value, data);
+        break;
+    case PyUnicode_4BYTE_KIND:
+        append_utf8<Py_UCS4>(value, data);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool detail::FrameSnapshotter::read_bytes(
+    PyObject *   address,
+    std::string &value) {
+    PyVarObject bytes;
+    if (!memory.read(address, bytes) ||
+        to_address(Py_TYPE(&bytes)) != types.bytes ||
+        Py_SIZE(&bytes) < 0 || Py_SIZE(&bytes) > max_bytes_length) {
+        return false;
+    }
+    value.resize(Py_SIZE(&bytes));
+    return memory.read(
+        to_address(address) + offsetof(PyBytesObject, ob_sval),
+        &value[0],
+        value.size());
+}
+
+bool detail::FrameSnapshotter::is_same_type(
+    std::uintptr_t      address,
+    const PyTypeObject &type) {
+    PyTypeObject copy;
+    if (!memory.read(address, copy) ||
+        copy.tp_basicsize != type.tp_basicsize ||
+        copy.tp_itemsize != type.tp_itemsize) {
+        return false;
+    }
+    const auto length = std::strlen(type.tp_name);
+    std::string name(length, '\0');
+    return memory.read(to_address(copy.tp_name), &name[0], length) &&
+           name == type.tp_name;
+}
+
+constexpr int detail::FrameSnapshotter::max_attempts;
+constexpr int detail::FrameSnapshotter::max_threads;
+constexpr int detail::FrameSnapshotter::max_depth;
+constexpr int detail::FrameSnapshotter::max_codes;
+constexpr int detail::FrameSnapshotter::max_string_length;
+constexpr int detail::FrameSnapshotter::max_bytes_length;
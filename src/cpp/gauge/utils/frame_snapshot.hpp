@@ -0,0 +1,190 @@
+#ifndef GAUGE_FRAME_SNAPSHOT_HPP
+#define GAUGE_FRAME_SNAPSHOT_HPP
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <Python.h>
+#include <frameobject.h>
+#include <sys/types.h>
+
+#include "gauge/utils/process_memory.hpp"
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Information about a code object decoded from its raw memory.
+ */
+struct CodeInfo {
+    std::string name;
+    std::string file_name;
+    int         first_line_number = 0;
+    /**
+     * Raw content of co_lnotab.
+     */
+    std::string line_table;
+
+    /**
+     * Map index of the last executed instruction to a line number.
+     *
+     * Same as PyCode_Addr2Line() but works on the copied line table.
+     */
+    int get_line_number(int lasti) const;
+};
+
+struct FrameSnapshot {
+    /**
+     * Address of the frame object, serves the same purpose as the address
+     * of a referenced frame.
+     */
+    std::uintptr_t                  address = 0;
+    std::shared_ptr<const CodeInfo> code;
+    int                             lasti        = -1;
+    bool                            is_coroutine = false;
+    bool                            is_generator = false;
+};
+
+struct ThreadSnapshot {
+    /**
+     * Address of the live thread state.
+     */
+    std::uintptr_t address = 0;
+    /**
+     * Copy of the thread state.
+     */
+    PyThreadState state{};
+};
+
+/**
+ * Copies stacks of threads of an interpreter without holding the GIL.
+ *
+ * The interpreter could belong to another process, in this case its
+ * structures are expected to have the same layout as the ones of
+ * the current process, which means the same version of Python.
+ *
+ * All of the interpreter's structures are copied through ProcessMemory
+ * and are validated after copying: type pointers of objects are checked
+ * and each thread's stack is walked optimistically - after the walk each
+ * copied frame is read again and its code, its caller and, for all but
+ * the current frame, its last executed instruction must be the same, as
+ * well as the thread's current frame. Otherwise the walk is retried and
+ * after a few failed attempts the thread is skipped. Frame objects are
+ * reused by CPython, so comparing addresses alone isn't enough. Strings
+ * are never read from live objects through the C API.
+ *
+ * The validation is best-effort - a stack rewritten between the reads into
+ * exactly the same frames passes, but such a copy is identical to a stack
+ * the thread has had.
+ *
+ * Not thread-safe, meant to be used by a single collector thread.
+ */
+class FrameSnapshotter {
+public:
+    /**
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If safe memory reads are not supported or
+     *         layout of the interpreter's structures is unexpected.
+     */
+    explicit FrameSnapshotter(PyInterpreterState *interpreter);
+    /**
+     * Copy stacks of the main interpreter of another process.
+     *
+     * Should be called with the GIL held.
+     *
+     * @throws CollectorError If the process couldn't be read, its Python
+     *         runtime couldn't be found or it's another version of Python.
+     */
+    explicit FrameSnapshotter(pid_t pid);
+
+    /**
+     * Copy states of all threads of the interpreter.
+     *
+     * @return False if the list of threads was torn during copying.
+     */
+    bool snapshot_threads(std::vector<ThreadSnapshot> &threads);
+
+    /**
+     * Copy the current stack of the thread, bottommost frame first.
+     *
+     * @return False if a consistent stack couldn't be copied.
+     */
+    bool snapshot_frames(
+        const ThreadSnapshot &      thread,
+        std::vector<FrameSnapshot> &frames);
+
+private:
+    using CodeKey = std::tuple<PyObject *, PyObject *, PyObject *, int>;
+    struct CachedCode {
+        CodeKey                         key;
+        std::shared_ptr<const CodeInfo> info;
+    };
+
+    static constexpr auto max_attempts       = 3;
+    static constexpr auto max_threads        = 4096;
+    static constexpr auto max_depth          = 4096;
+    static constexpr auto max_codes          = 100000;
+    static constexpr auto max_string_length  = 4096;
+    static constexpr auto max_bytes_length   = 1 << 20;
+
+    /**
+     * Addresses of type objects in the read process.
+     */
+    struct TypeAddresses {
+        std::uintptr_t frame     = 0;
+        std::uintptr_t code      = 0;
+        std::uintptr_t unicode   = 0;
+        std::uintptr_t bytes     = 0;
+        std::uintptr_t coroutine = 0;
+        std::uintptr_t generator = 0;
+    };
+
+    ProcessMemory memory;
+    /**
+     * Address of the interpreter in the read process, it's never
+     * dereferenced directly.
+     */
+    PyInterpreterState *interpreter;
+    std::uintptr_t      thread_head_address;
+    TypeAddresses       types;
+    /**
+     * Fields of copied frames that are checked again after the walk.
+     */
+    struct FrameLink {
+        std::uintptr_t code = 0;
+        std::uintptr_t back = 0;
+    };
+    /*! Buffer of links of the last walk, same order as the frames. */
+    std::vector<FrameLink> frame_links;
+    /**
+     * Decoded code objects by their addresses, entries are validated
+     * against the code object's fields on every lookup since the address
+     * could be reused by another code object.
+     */
+    std::unordered_map<std::uintptr_t, CachedCode> codes;
+
+    bool walk_frames(
+        std::uintptr_t              frame_address,
+        std::vector<FrameSnapshot> &frames);
+    /**
+     * Read the walked frames again and check that they haven't changed.
+     */
+    bool validate_frames(const std::vector<FrameSnapshot> &frames);
+    std::shared_ptr<const CodeInfo> resolve_code(std::uintptr_t address);
+    bool read_unicode(PyObject *address, std::string &value);
+    bool read_bytes(PyObject *address, std::string &value);
+    /**
+     * Check whether the type object in the read process matches the one
+     * of the current process.
+     */
+    bool is_same_type(std::uintptr_t address, const PyTypeObject &type);
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_FRAME_SNAPSHOT_HPP
@@ -5,3 +5,17 @@ using namespace gauge;
 detail::GILGuard::GILGuard() : gil_state(PyGILState_Ensure()) {}
 
 detail::GILGuard::~GILGuard() { PyGILState_Release(gil_state); }
+
+detail::GILRelease::GILRelease() {
+    auto current_thread_state = PyGILState_GetThisThreadState();
+    if (current_thread_state != nullptr &&
+        current_thread_state == _PyThreadState_UncheckedGet()) {
+        thread_state = PyEval_SaveThread();
+    }
+}
+
+detail::GILRelease::~GILRelease() {
+    if (thread_state != nullptr) {
+        PyEval_RestoreThread(thread_state);
+    }
+}
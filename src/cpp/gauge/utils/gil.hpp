@@ -18,6 +18,25 @@ private:
     PyGILState_STATE gil_state;
 };
 
+/**
+ * Releases the GIL for the scope if the current thread holds it.
+ *
+ * Lets a thread wait for other threads that might need the GIL, without
+ * knowing whether the GIL is held by the caller.
+ */
+class GILRelease {
+public:
+    GILRelease();
+    GILRelease(GILRelease &&) = delete;
+    GILRelease &operator=(GILRelease &&) = delete;
+    GILRelease(const GILRelease &)       = delete;
+    GILRelease &operator=(const GILRelease &) = delete;
+    ~GILRelease();
+
+private:
+    PyThreadState *thread_state = nullptr;
+};
+
 } // namespace detail
 } // namespace gauge
 
@@ -0,0 +1,78 @@
+#include "gauge/utils/glob.hpp"
+
+using namespace gauge;
+
+std::string detail::glob_to_regex(const std::string &pattern) {
+    std::string result;
+    result.reserve(pattern.size() * 2);
+    const auto size = pattern.size();
+    for (std::size_t i = 0; i < size; i++) {
+        const auto c = pattern[i];
+        if (c == '*') {
+            result += ".*";
+        } else if (c == '?') {
+            result += '.';
+        } else if (c == '[') {
+            auto j = i + 1;
+            if (j < size && pattern[j] == '!') {
+                j++;
+            }
+            if (j < size && pattern[j] == ']') {
+                j++;
+            }
+            while (j < size && pattern[j] != ']') {
+                j++;
+            }
+            if (j >= size) {
+                // Unterminated set is treated literally as fnmatch does.
+                result += "\\[";
+                continue;
+            }
+            auto set = pattern.substr(i + 1, j - i - 1);
+            result += '[';
+            std::size_t k = 0;
+            if (!set.empty() && set[0] == '!') {
+                result += '^';
+                k = 1;
+            }
+            for (; k < set.size(); k++) {
+                if (set[k] == '\\' || set[k] == '^' || set[k] == '[') {
+                    result += '\\';
+                }
+                result += set[k];
+            }
+            result += ']';
+            i = j;
+        } else if (std::string("\\.^$|()+{}]").find(c) != std::string::npos) {
+            result += '\\';
+            result += c;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+detail::GlobSet::GlobSet(const std::vector<std::string> &patterns)
+    : patterns{patterns} {
+    if (patterns.empty()) {
+        return;
+    }
+    std::string alternatives;
+    for (const auto &pattern : patterns) {
+        if (!alternatives.empty()) {
+            alternatives += '|';
+        }
+        alternatives += "(?:" + glob_to_regex(pattern) + ")";
+    }
+    regex = std::regex(
+        alternatives,
+        std::regex::ECMAScript | std::regex::optimize);
+}
+
+bool detail::GlobSet::matches(const std::string &value) const {
+    if (patterns.empty()) {
+        return false;
+    }
+    return std::regex_match(value, regex);
+}
@@ -0,0 +1,41 @@
+#ifndef GAUGE_GLOB_HPP
+#define GAUGE_GLOB_HPP
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Translate a shell-style glob pattern into an equivalent regex.
+ *
+ * Supports the same syntax as Python's fnmatch module: "*", "?",
+ * "[seq]" and "[!seq]".
+ */
+std::string glob_to_regex(const std::string &pattern);
+
+/**
+ * Set of glob patterns compiled once into a single regex.
+ */
+class GlobSet {
+public:
+    GlobSet() = default;
+    explicit GlobSet(const std::vector<std::string> &patterns);
+
+    /**
+     * Check whether the value matches any of the patterns.
+     */
+    bool matches(const std::string &value) const;
+    bool empty() const { return patterns.empty(); }
+    const std::vector<std::string> &get_patterns() const { return patterns; }
+
+private:
+    std::vector<std::string> patterns{};
+    std::regex               regex{};
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_GLOB_HPP
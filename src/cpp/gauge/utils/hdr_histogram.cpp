@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cmath>
+
+#include "gauge/utils/hdr_histogram.hpp"
+
+using namespace gauge;
+
+namespace {
+/**
+ * Get count of bits needed to represent the value.
+ */
+inline int get_bit_length(std::uint64_t value) {
+#if defined(__GNUC__)
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+#else
+    int length = 0;
+    while (value != 0) {
+        value >>= 1U;
+        length++;
+    }
+    return length;
+#endif
+}
+
+int get_sub_bucket_half_count_magnitude(int significant_digits) {
+    significant_digits = std::min(std::max(significant_digits, 1), 4);
+    // Values up to this one are counted exactly.
+    const auto single_unit_resolution =
+        2 * static_cast<std::uint64_t>(std::pow(10, significant_digits));
+    return get_bit_length(single_unit_resolution - 1) - 1;
+}
+} // namespace
+
+detail::HdrHistogram::HdrHistogram(int significant_digits)
+    : sub_bucket_half_count_magnitude{get_sub_bucket_half_count_magnitude(
+          significant_digits)},
+      sub_bucket_count{std::size_t{1}
+                       << (sub_bucket_half_count_magnitude + 1U)},
+      bucket_count{
+          static_cast<std::size_t>(64 - sub_bucket_half_count_magnitude)},
+      buckets{new std::atomic<Counter *>[bucket_count]()} {}
+
+detail::HdrHistogram::~HdrHistogram() {
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        delete[] buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+void detail::HdrHistogram::record(std::uint64_t value) {
+    const auto bucket_index = get_bucket_index(value);
+    auto       counter_index =
+        static_cast<std::size_t>(value >> bucket_index);
+    if (bucket_index != 0) {
+        counter_index -= sub_bucket_count / 2;
+    }
+    increase(get_bucket(bucket_index)[counter_index], 1);
+    increase(count, 1);
+    increase(sum, value);
+    if (value < min.load(std::memory_order_relaxed)) {
+        min.store(value, std::memory_order_relaxed);
+    }
+    if (value > max.load(std::memory_order_relaxed)) {
+        max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void detail::HdrHistogram::add(const HdrHistogram &other) {
+    const auto other_count = other.get_count();
+    if (other_count == 0 || other.bucket_count != bucket_count) {
+        return;
+    }
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        const auto *other_counters =
+            other.buckets[i].load(std::memory_order_acquire);
+        if (other_counters == nullptr) {
+            continue;
+        }
+        Counter *counters = nullptr;
+        for (std::size_t j = 0; j < get_bucket_size(i); j++) {
+            const auto value =
+                other_counters[j].load(std::memory_order_relaxed);
+            if (value == 0) {
+                continue;
+            }
+            if (counters == nullptr) {
+                counters = get_bucket(i);
+            }
+            increase(counters[j], value);
+        }
+    }
+    increase(count, other_count);
+    increase(sum, other.sum.load(std::memory_order_relaxed));
+    min.store(
+        std::min(min.load(std::memory_order_relaxed), other.get_min()),
+        std::memory_order_relaxed);
+    max.store(
+        std::max(max.load(std::memory_order_relaxed), other.get_max()),
+        std::memory_order_relaxed);
+}
+
+void detail::HdrHistogram::reset() {
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        auto *counters = buckets[i].load(std::memory_order_relaxed);
+        if (counters == nullptr) {
+            continue;
+        }
+        for (std::size_t j = 0; j < get_bucket_size(i); j++) {
+            counters[j].store(0, std::memory_order_relaxed);
+        }
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    min.store(UINT64_MAX, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t detail::HdrHistogram::get_count() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t detail::HdrHistogram::get_min() const {
+    return get_count() == 0 ? 0 : min.load(std::memory_order_relaxed);
+}
+
+std::uint64_t detail::HdrHistogram::get_max() const {
+    return max.load(std::memory_order_relaxed);
+}
+
+double detail::HdrHistogram::get_mean() const {
+    const auto count = get_count();
+    if (count == 0) {
+        return 0;
+    }
+    return static_cast<double>(sum.load(std::memory_order_relaxed)) /
+           static_cast<double>(count);
+}
+
+std::uint64_t
+detail::HdrHistogram::get_value_at_percentile(double percentile) const {
+    const auto    counts = get_counts();
+    std::uint64_t total  = 0;
+    for (const auto &item : counts) {
+        total += item.second;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    const auto target = std::max<std::uint64_t>(
+        static_cast<std::uint64_t>(
+            std::ceil(percentile / 100 * static_cast<double>(total))),
+        1);
+    std::uint64_t accumulated = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        accumulated += counts[i].second;
+        if (accumulated < target) {
+            continue;
+        }
+        // The highest value counted by the same counter.
+        const auto lowest_value = counts[i].first;
+        const auto bucket_index = get_bucket_index(lowest_value);
+        const auto highest_value =
+            lowest_value + ((std::uint64_t{1} << bucket_index) - 1);
+        return std::max(std::min(highest_value, get_max()), get_min());
+    }
+    return get_max();
+}
+
+std::vector<std::pair<std::uint64_t, std::uint64_t>>
+detail::HdrHistogram::get_counts() const {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> counts;
+    for (std::size_t i = 0; i < bucket_count; i++) {
+        const auto *counters = buckets[i].load(std::memory_order_acquire);
+        if (counters == nullptr) {
+            continue;
+        }
+        for (std::size_t j = 0; j < get_bucket_size(i); j++) {
+            const auto value = counters[j].load(std::memory_order_relaxed);
+            if (value != 0) {
+                counts.emplace_back(get_lowest_value(i, j), value);
+            }
+        }
+    }
+    return counts;
+}
+
+std::size_t
+detail::HdrHistogram::get_bucket_size(std::size_t bucket_index) const {
+    return bucket_index == 0 ? sub_bucket_count : sub_bucket_count / 2;
+}
+
+std::size_t detail::HdrHistogram::get_bucket_index(std::uint64_t value) const {
+    const auto sub_bucket_mask =
+        static_cast<std::uint64_t>(sub_bucket_count) - 1;
+    return static_cast<std::size_t>(
+        get_bit_length(value | sub_bucket_mask) -
+        (sub_bucket_half_count_magnitude + 1));
+}
+
+detail::HdrHistogram::Counter *
+detail::HdrHistogram::get_bucket(std::size_t bucket_index) {
+    auto *counters = buckets[bucket_index].load(std::memory_order_relaxed);
+    if (counters == nullptr) {
+        counters = new Counter[get_bucket_size(bucket_index)]();
+        // Published only after the counters are zeroed.
+        buckets[bucket_index].store(counters, std::memory_order_release);
+    }
+    return counters;
+}
+
+std::uint64_t detail::HdrHistogram::get_lowest_value(
+    std::size_t bucket_index,
+    std::size_t counter_index) const {
+    if (bucket_index != 0) {
+        counter_index += sub_bucket_count / 2;
+    }
+    return static_cast<std::uint64_t>(counter_index) << bucket_index;
+}
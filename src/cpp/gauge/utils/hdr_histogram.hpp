@@ -0,0 +1,100 @@
+#ifndef GAUGE_HDR_HISTOGRAM_HPP
+#define GAUGE_HDR_HISTOGRAM_HPP
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * High dynamic range histogram of non-negative integer values.
+ *
+ * Widths of counters grow with magnitudes of values, so that each value
+ * is counted with the given count of significant decimal digits. Counters
+ * of each power-of-two range of values are allocated on the first use.
+ *
+ * Recording is wait-free and must be done by one thread at a time,
+ * reading could be done concurrently from any thread - a reader could
+ * observe a recording half done.
+ */
+class HdrHistogram {
+public:
+    using Counter = std::atomic<std::uint64_t>;
+
+    /**
+     * @param significant_digits Precision of values, from 1 to 4.
+     */
+    explicit HdrHistogram(int significant_digits = 2);
+    HdrHistogram(const HdrHistogram &) = delete;
+    HdrHistogram(HdrHistogram &&)      = delete;
+    HdrHistogram &operator=(const HdrHistogram &) = delete;
+    HdrHistogram &operator=(HdrHistogram &&) = delete;
+    ~HdrHistogram();
+
+    void record(std::uint64_t value);
+    /**
+     * Add counts of the histogram of the same precision.
+     */
+    void add(const HdrHistogram &other);
+    /**
+     * Zero the counters, keeps them allocated.
+     */
+    void reset();
+
+    std::uint64_t get_count() const;
+    std::uint64_t get_min() const;
+    std::uint64_t get_max() const;
+    double        get_mean() const;
+    /**
+     * Get the highest value that the percentile of values doesn't exceed.
+     *
+     * @param percentile Percentile from 0 to 100.
+     */
+    std::uint64_t get_value_at_percentile(double percentile) const;
+
+    /**
+     * Get the non-zero counters as pairs of their lowest values and counts,
+     * ordered by values.
+     */
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> get_counts() const;
+
+private:
+    const int         sub_bucket_half_count_magnitude;
+    const std::size_t sub_bucket_count;
+    const std::size_t bucket_count;
+    /**
+     * Counters of the power-of-two ranges, the first range is counted by
+     * "sub_bucket_count" counters and the rest - by the upper halves.
+     */
+    std::unique_ptr<std::atomic<Counter *>[]> buckets;
+
+    Counter count{0};
+    Counter sum{0};
+    Counter min{UINT64_MAX};
+    Counter max{0};
+
+    std::size_t get_bucket_size(std::size_t bucket_index) const;
+    std::size_t get_bucket_index(std::uint64_t value) const;
+    /**
+     * Get counters of the bucket, allocating them if necessary.
+     */
+    Counter *get_bucket(std::size_t bucket_index);
+    std::uint64_t get_lowest_value(
+        std::size_t bucket_index,
+        std::size_t counter_index) const;
+
+    static void increase(Counter &counter, std::uint64_t value) {
+        // There is only one writer, so no read-modify-write is needed.
+        counter.store(
+            counter.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed);
+    }
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_HDR_HISTOGRAM_HPP
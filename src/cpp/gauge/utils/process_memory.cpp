@@ -0,0 +1,51 @@
+#include <cerrno>
+
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+#include "gauge/utils/process_memory.hpp"
+
+using namespace gauge;
+
+detail::ProcessMemory::ProcessMemory() : pid{getpid()} {}
+
+detail::ProcessMemory::ProcessMemory(pid_t pid) : pid{pid} {}
+
+bool detail::ProcessMemory::is_supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool detail::ProcessMemory::read(
+    std::uintptr_t address,
+    void *         buffer,
+    std::size_t    size) const {
+    if (size == 0) {
+        return true;
+    }
+    if (address == 0) {
+        return false;
+    }
+#ifdef __linux__
+    struct iovec local {};
+    struct iovec remote {};
+    local.iov_base = buffer;
+    local.iov_len  = size;
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast, performance-no-int-to-ptr)
+    remote.iov_base = reinterpret_cast<void *>(address);
+    remote.iov_len  = size;
+    ssize_t result  = 0;
+    do {
+        result = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+    } while (result < 0 && errno == EINTR);
+    return result == static_cast<ssize_t>(size);
+#else
+    (void)buffer;
+    return false;
+#endif
+}
@@ -0,0 +1,57 @@
+#ifndef GAUGE_PROCESS_MEMORY_HPP
+#define GAUGE_PROCESS_MEMORY_HPP
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Reads memory of a process without ever faulting.
+ *
+ * Reads are performed by the kernel (with process_vm_readv() on Linux),
+ * so reading of unmapped or concurrently freed memory results in
+ * a failed read instead of a crash, and concurrent writes to the memory
+ * may result in a torn copy but not in a data-race in terms of C++.
+ * Consistency of the copied data has to be validated by callers.
+ */
+class ProcessMemory {
+public:
+    /**
+     * Memory of the current process.
+     */
+    ProcessMemory();
+    explicit ProcessMemory(pid_t pid);
+
+    /**
+     * Check whether the current platform supports safe memory reads.
+     */
+    static bool is_supported();
+
+    /**
+     * Copy "size" bytes from the address in the process to the buffer.
+     *
+     * @return Whether all of the bytes were copied.
+     */
+    bool read(std::uintptr_t address, void *buffer, std::size_t size) const;
+
+    template <typename T> bool read(std::uintptr_t address, T &value) const {
+        return read(address, &value, sizeof(T));
+    }
+
+    template <typename T>
+    bool read(const void *address, T &value) const {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        return read(reinterpret_cast<std::uintptr_t>(address), value);
+    }
+
+private:
+    pid_t pid;
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_PROCESS_MEMORY_HPP
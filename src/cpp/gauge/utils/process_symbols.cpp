@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+#ifdef __linux__
+#include <elf.h>
+#endif
+
+#include "gauge/base.hpp"
+#include "gauge/utils/process_symbols.hpp"
+
+using namespace gauge;
+
+namespace {
+template <typename T>
+bool read_at(
+    std::ifstream &file,
+    std::uint64_t  offset,
+    T *            values,
+    std::size_t    count = 1) {
+    file.seekg(static_cast<std::streamoff>(offset));
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.read(reinterpret_cast<char *>(values), sizeof(T) * count);
+    return static_cast<bool>(file);
+}
+
+std::string get_base_name(const std::string &path) {
+    const auto position = path.rfind('/');
+    return position == std::string::npos ? path : path.substr(position + 1);
+}
+
+std::string read_link(const std::string &path) {
+    std::vector<char> buffer(4096);
+    const auto length = readlink(path.c_str(), buffer.data(), buffer.size());
+    if (length <= 0) {
+        return {};
+    }
+    return std::string(buffer.data(), static_cast<std::size_t>(length));
+}
+} // namespace
+
+detail::ProcessSymbols::ProcessSymbols(pid_t pid) {
+    std::uintptr_t load_address = 0;
+    if (!find_runtime(pid, path, load_address)) {
+        throw CollectorError();
+    }
+    // Files are opened through the process' root, so that processes in
+    // other mount namespaces are supported.
+    const auto root = "/proc/" + std::to_string(pid) + "/root";
+    if (!read_symbols(root + path, load_address)) {
+        throw CollectorError();
+    }
+}
+
+std::uintptr_t detail::ProcessSymbols::find(const std::string &name) const {
+    auto it = symbols.find(name);
+    return it == symbols.end() ? 0 : it->second;
+}
+
+const std::string &detail::ProcessSymbols::get_path() const { return path; }
+
+bool detail::ProcessSymbols::find_runtime(
+    pid_t           pid,
+    std::string &   runtime_path,
+    std::uintptr_t &load_address) {
+    const auto    process = "/proc/" + std::to_string(pid);
+    std::ifstream maps(process + "/maps");
+    if (!maps) {
+        return false;
+    }
+    const auto  executable_path = read_link(process + "/exe");
+    std::string executable_mapping;
+    std::string line;
+    while (std::getline(maps, line)) {
+        std::istringstream stream(line);
+        std::string        range;
+        std::string        permissions;
+        std::string        offset;
+        std::string        device;
+        std::string        inode;
+        std::string        mapped_path;
+        stream >> range >> permissions >> offset >> device >> inode;
+        std::getline(stream >> std::ws, mapped_path);
+        if (mapped_path.empty() || mapped_path[0] != '/' ||
+            std::stoull(offset, nullptr, 16) != 0) {
+            continue;
+        }
+        // Only the first mapping of each file has zero offset.
+        const auto address = static_cast<std::uintptr_t>(
+            std::stoull(range.substr(0, range.find('-')), nullptr, 16));
+        if (get_base_name(mapped_path).compare(0, 9, "libpython") == 0) {
+            runtime_path = mapped_path;
+            load_address = address;
+            return true;
+        }
+        if (mapped_path == executable_path && executable_mapping.empty()) {
+            executable_mapping = mapped_path;
+            load_address       = address;
+        }
+    }
+    if (executable_mapping.empty()) {
+        return false;
+    }
+    runtime_path = executable_mapping;
+    return true;
+}
+
+bool detail::ProcessSymbols::read_symbols(
+    const std::string &file_path,
+    std::uintptr_t     load_address) {
+#ifdef __linux__
+    std::ifstream file(file_path, std::ios::binary);
+    Elf64_Ehdr    header{};
+    if (!file || !read_at(file, 0, &header) ||
+        std::string(header.e_ident, header.e_ident + SELFMAG) != ELFMAG ||
+        header.e_ident[EI_CLASS] != ELFCLASS64 ||
+        header.e_shentsize != sizeof(Elf64_Shdr) ||
+        header.e_phentsize != sizeof(Elf64_Phdr)) {
+        return false;
+    }
+
+    // Shared objects and position-independent executables are relocated
+    // by the difference between the actual and the linked addresses of
+    // their first segment.
+    std::uintptr_t bias = 0;
+    if (header.e_type == ET_DYN) {
+        std::vector<Elf64_Phdr> segments(header.e_phnum);
+        if (!read_at(file, header.e_phoff, segments.data(), segments.size())) {
+            return false;
+        }
+        auto first = std::find_if(
+            segments.begin(),
+            segments.end(),
+            [](const Elf64_Phdr &segment) {
+                return segment.p_type == PT_LOAD;
+            });
+        if (first == segments.end()) {
+            return false;
+        }
+        bias = load_address - (first->p_vaddr & ~(first->p_align - 1));
+    }
+
+    std::vector<Elf64_Shdr> sections(header.e_shnum);
+    if (!read_at(file, header.e_shoff, sections.data(), sections.size())) {
+        return false;
+    }
+    for (const auto &section : sections) {
+        if ((section.sh_type != SHT_SYMTAB &&
+             section.sh_type != SHT_DYNSYM) ||
+            section.sh_entsize != sizeof(Elf64_Sym) ||
+            section.sh_link >= sections.size()) {
+            continue;
+        }
+        const auto &names_section = sections[section.sh_link];
+
+        std::string            names(names_section.sh_size, '\0');
+        std::vector<Elf64_Sym> entries(section.sh_size / sizeof(Elf64_Sym));
+        if (names.empty() ||
+            !read_at(
+                file,
+                names_section.sh_offset,
+                &names[0],
+                names.size()) ||
+            !read_at(
+                file,
+                section.sh_offset,
+                entries.data(),
+                entries.size())) {
+            return false;
+        }
+        for (const auto &entry : entries) {
+            const auto type = ELF64_ST_TYPE(entry.st_info);
+            if ((type != STT_OBJECT && type != STT_FUNC) ||
+                entry.st_shndx == SHN_UNDEF || entry.st_value == 0 ||
+                entry.st_name >= names.size()) {
+                continue;
+            }
+            symbols.emplace(
+                names.c_str() + entry.st_name,
+                bias + entry.st_value);
+        }
+    }
+    return !symbols.empty();
+#else
+    (void)file_path;
+    (void)load_address;
+    return false;
+#endif
+}
@@ -0,0 +1,65 @@
+#ifndef GAUGE_PROCESS_SYMBOLS_HPP
+#define GAUGE_PROCESS_SYMBOLS_HPP
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include <sys/types.h>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Resolves addresses of symbols of the Python runtime of another process.
+ *
+ * The runtime is looked up in the process' memory mappings - it's
+ * the mapped "libpython" shared library if there is any, otherwise it's
+ * the executable itself. Symbols are read from both dynamic and regular
+ * symbol tables of its ELF file and are relocated by the load address of
+ * the file.
+ *
+ * Linux and 64-bit ELF files only.
+ */
+class ProcessSymbols {
+public:
+    /**
+     * @throws CollectorError If the process' mappings or the runtime's ELF
+     *         file couldn't be read.
+     */
+    explicit ProcessSymbols(pid_t pid);
+
+    /**
+     * Get address of the symbol in the process.
+     *
+     * @return Zero if there is no such symbol.
+     */
+    std::uintptr_t find(const std::string &name) const;
+
+    /**
+     * Path of the file the symbols are read from.
+     */
+    const std::string &get_path() const;
+
+private:
+    std::string                                     path;
+    std::unordered_map<std::string, std::uintptr_t> symbols;
+
+    /**
+     * Find the mapped runtime and get its path and load address.
+     */
+    static bool find_runtime(
+        pid_t           pid,
+        std::string &   path,
+        std::uintptr_t &load_address);
+    /**
+     * Read symbols of the ELF file relocated by the load address.
+     */
+    bool read_symbols(
+        const std::string &file_path,
+        std::uintptr_t     load_address);
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_PROCESS_SYMBOLS_HPP
@@ -0,0 +1,49 @@
+#include "gauge/utils/py_string_cache.hpp"
+
+using namespace gauge;
+
+detail::PyStringCache::PyStringCache(std::size_t capacity, bool intern)
+    : capacity{capacity}, intern{intern} {}
+
+detail::PyStringCache::~PyStringCache() { clear(); }
+
+pybind11::object detail::PyStringCache::get(const std::string &value) {
+    auto address_it = strings_by_address.find(&value);
+    if (address_it != strings_by_address.end() &&
+        *address_it->second.first == value) {
+        return py::reinterpret_borrow<py::object>(address_it->second.second);
+    }
+    auto it = strings.find(value);
+    if (it == strings.end()) {
+        PyObject *string = PyUnicode_DecodeUTF8(
+            value.data(),
+            static_cast<Py_ssize_t>(value.size()),
+            nullptr);
+        if (string == nullptr) {
+            throw py::error_already_set();
+        }
+        if (intern) {
+            PyUnicode_InternInPlace(&string);
+        }
+        if (strings.size() >= capacity) {
+            clear();
+        }
+        it = strings.emplace(value, string).first;
+    }
+    if (strings_by_address.size() >= capacity) {
+        strings_by_address.clear();
+    }
+    // Nodes of the map aren't moved, so the key could be referred.
+    strings_by_address[&value] = std::make_pair(&it->first, it->second);
+    return py::reinterpret_borrow<py::object>(it->second);
+}
+
+std::size_t detail::PyStringCache::size() const { return strings.size(); }
+
+void detail::PyStringCache::clear() {
+    for (const auto &item : strings) {
+        Py_DECREF(item.second);
+    }
+    strings_by_address.clear();
+    strings.clear();
+}
@@ -0,0 +1,73 @@
+#ifndef GAUGE_PY_STRING_CACHE_HPP
+#define GAUGE_PY_STRING_CACHE_HPP
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <Python.h>
+#include <pybind11/pybind11.h>
+
+namespace gauge {
+namespace detail {
+
+namespace py = pybind11;
+
+/**
+ * Cache of Python strings made of C++ strings.
+ *
+ * Each distinct string is decoded once, afterwards the same Python object
+ * is handed out with its reference count increased. The cache is cleared
+ * when it grows over the capacity, so that strings that never repeat don't
+ * accumulate.
+ *
+ * Strings are looked up by their addresses first, so that reading the same
+ * attribute again doesn't hash its content. Addresses are reused once
+ * the strings are released, so a hit is confirmed by comparing
+ * the contents.
+ *
+ * Should be used with the GIL held.
+ */
+class PyStringCache {
+public:
+    /**
+     * @param capacity Maximum count of cached strings.
+     * @param intern Whether to intern the strings, meant for names that
+     *        are likely to be compared or used as keys in Python.
+     */
+    explicit PyStringCache(std::size_t capacity, bool intern = false);
+
+    PyStringCache(const PyStringCache &cache) = delete;
+    PyStringCache(PyStringCache &&cache)      = delete;
+    PyStringCache &operator=(const PyStringCache &cache) = delete;
+    PyStringCache &operator=(PyStringCache &&cache) = delete;
+    ~PyStringCache();
+
+    /**
+     * Get Python string equal to the value.
+     *
+     * @throws pybind11::error_already_set If the value isn't valid UTF-8.
+     */
+    py::object get(const std::string &value);
+
+    std::size_t size() const;
+    void        clear();
+
+private:
+    std::size_t                                 capacity;
+    bool                                        intern;
+    std::unordered_map<std::string, PyObject *> strings;
+    /**
+     * Keys and values of "strings" by addresses of the strings they were
+     * last looked up by.
+     */
+    std::unordered_map<
+        const std::string *,
+        std::pair<const std::string *, PyObject *>>
+        strings_by_address;
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_PY_STRING_CACHE_HPP
@@ -0,0 +1,68 @@
+#ifndef GAUGE_SPSC_RING_HPP
+#define GAUGE_SPSC_RING_HPP
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Bounded lock-free queue for a single producer and a single consumer.
+ *
+ * @tparam Capacity Maximum count of items, must be a power of two.
+ */
+template <typename T, std::size_t Capacity> class SPSCRing {
+    static_assert(
+        Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+        "Capacity must be a power of two.");
+
+public:
+    /**
+     * Push the item, should be called only by the producer.
+     *
+     * @return False if the ring is full.
+     */
+    bool push(const T &item) {
+        const auto tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        items[tail & (Capacity - 1)] = item;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pop the oldest item, should be called only by the consumer.
+     *
+     * @return False if the ring is empty.
+     */
+    bool pop(T &item) {
+        const auto head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[head & (Capacity - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> items{};
+    // Indices only grow, positions are taken modulo capacity. Kept on
+    // separate cache lines so that the producer and the consumer don't
+    // invalidate each other's caches.
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_SPSC_RING_HPP
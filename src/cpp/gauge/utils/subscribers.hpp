@@ -0,0 +1,225 @@
+#ifndef GAUGE_SUBSCRIBERS_HPP
+#define GAUGE_SUBSCRIBERS_HPP
+#include <forward_list>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <Python.h>
+#include <pybind11/pybind11.h>
+#include <spdlog/logger.h>
+#include <spdlog/spdlog.h>
+
+#include "gauge/dispatch.hpp"
+#include "gauge/utils/async_dispatcher.hpp"
+#include "gauge/utils/gil.hpp"
+#include "gauge/utils/logging.hpp"
+
+namespace gauge {
+namespace detail {
+
+namespace py = pybind11;
+
+/**
+ * Set of callbacks subscribed to batches produced by a pipeline stage.
+ *
+ * Native callbacks are called directly, Python callbacks - with the GIL
+ * taken and inside of a dedicated contextvars context. Callbacks
+ * subscribed with a queue are called from their own threads.
+ *
+ * Callbacks could be subscribed while batches are being passed, the lists
+ * of callbacks are only prepended to, so batches are passed to callbacks
+ * subscribed before the lists' heads were read, without holding the lock
+ * while calling them.
+ */
+template <typename BatchType> class Subscribers {
+public:
+    using Callback = std::function<void(const BatchType &)>;
+
+    Subscribers()
+        : logger{get_logger()}, py_context{py::reinterpret_steal<py::object>(
+                                    PyContext_New())} {}
+
+    void subscribe(Callback callback, const DispatchOptions &options = {}) {
+        const std::lock_guard<std::mutex> guard(mutex);
+        if (options.queue_capacity == 0) {
+            callbacks.emplace_front(std::move(callback));
+            return;
+        }
+        dispatchers.emplace_front(
+            std::make_unique<AsyncDispatcher<BatchType>>(
+                std::move(callback),
+                options));
+    }
+
+    void subscribe(py::object callback, const DispatchOptions &options = {}) {
+        const std::lock_guard<std::mutex> guard(mutex);
+        if (options.queue_capacity == 0) {
+            py_callbacks.emplace_front(std::move(callback));
+            return;
+        }
+        // Nodes of the list are never moved, so the callback could be
+        // referred by its address. Each thread enters its own context.
+        async_py_callbacks.emplace_front(
+            std::move(callback),
+            py::reinterpret_steal<py::object>(PyContext_New()));
+        const auto *py_callback = &async_py_callbacks.front();
+        dispatchers.emplace_front(std::make_unique<AsyncDispatcher<BatchType>>(
+            [this, py_callback](const BatchType &batch) {
+                call_py_callback(
+                    py_callback->first,
+                    py_callback->second,
+                    batch);
+            },
+            options));
+    }
+
+    bool empty() const {
+        const std::lock_guard<std::mutex> guard(mutex);
+        return callbacks.empty() && py_callbacks.empty() &&
+               dispatchers.empty();
+    }
+
+    /**
+     * Pass the batch to all of the subscribed callbacks.
+     */
+    void operator()(const BatchType &batch) {
+        const auto heads = get_heads();
+        for (auto it = heads.first_dispatcher; it != dispatchers.cend();
+             it++) {
+            (*it)->push(batch);
+        }
+        if (heads.first_callback != callbacks.cend()) {
+            SPDLOG_LOGGER_TRACE(logger, "Calling callbacks...");
+            for (auto it = heads.first_callback; it != callbacks.cend();
+                 it++) {
+                (*it)(batch);
+            }
+            SPDLOG_LOGGER_TRACE(logger, "Completed calling callbacks.");
+        }
+        if (heads.first_py_callback != py_callbacks.cend()) {
+            SPDLOG_LOGGER_TRACE(logger, "Calling Python callbacks...");
+            for (auto it = heads.first_py_callback; it != py_callbacks.cend();
+                 it++) {
+                call_py_callback(*it, py_context, batch);
+            }
+            SPDLOG_LOGGER_TRACE(logger, "Completed calling Python callbacks.");
+        }
+    }
+
+    /**
+     * Wait until callbacks with queues process all of the passed batches.
+     */
+    void flush() {
+        const auto heads = get_heads();
+        for (auto it = heads.first_dispatcher; it != dispatchers.cend();
+             it++) {
+            (*it)->flush();
+        }
+    }
+
+    /**
+     * Get metrics of the callbacks with queues.
+     */
+    std::vector<DispatchStats> get_dispatch_stats() const {
+        const auto                 heads = get_heads();
+        std::vector<DispatchStats> stats;
+        for (auto it = heads.first_dispatcher; it != dispatchers.cend();
+             it++) {
+            stats.emplace_back((*it)->get_stats());
+        }
+        return stats;
+    }
+
+    /**
+     * Check whether callbacks with queues have dropped batches since
+     * the previous check, then unchanged traces passed afterwards don't
+     * have a base.
+     *
+     * Should be called by the producer only.
+     */
+    bool check_dropped_batches() {
+        const auto         heads         = get_heads();
+        unsigned long long dropped_count = 0;
+        for (auto it = heads.first_dispatcher; it != dispatchers.cend();
+             it++) {
+            dropped_count += (*it)->get_dropped_count();
+        }
+        const bool has_dropped = dropped_count != checked_dropped_count;
+        checked_dropped_count  = dropped_count;
+        return has_dropped;
+    }
+
+private:
+    /**
+     * Guards heads of the lists, nodes are never changed once added.
+     */
+    mutable std::mutex              mutex;
+    std::shared_ptr<spdlog::logger> logger;
+    std::forward_list<Callback>     callbacks;
+    std::forward_list<py::object>   py_callbacks;
+    py::object                      py_context;
+    /**
+     * Callbacks with queues and their contextvars contexts.
+     */
+    std::forward_list<std::pair<py::object, py::object>> async_py_callbacks;
+    /**
+     * Declared last so that threads are stopped before the callbacks
+     * they use are destroyed.
+     */
+    std::forward_list<std::unique_ptr<AsyncDispatcher<BatchType>>>
+        dispatchers;
+    /**
+     * Count of dropped batches at the previous check, used by the producer.
+     */
+    unsigned long long checked_dropped_count = 0;
+
+    struct Heads {
+        typename decltype(callbacks)::const_iterator    first_callback;
+        typename decltype(py_callbacks)::const_iterator first_py_callback;
+        typename decltype(dispatchers)::const_iterator  first_dispatcher;
+    };
+
+    Heads get_heads() const {
+        const std::lock_guard<std::mutex> guard(mutex);
+        return Heads{
+            callbacks.cbegin(),
+            py_callbacks.cbegin(),
+            dispatchers.cbegin()};
+    }
+
+    void call_py_callback(
+        const py::object &callback,
+        const py::object &context,
+        const BatchType & batch) {
+        GILGuard gil_guard;
+        int      error_code = 0;
+        error_code          = PyContext_Enter(context.ptr());
+        if (error_code != 0) {
+            auto msg = "Failed to enter Python contextvars context.";
+            SPDLOG_LOGGER_ERROR(logger, msg);
+            throw std::runtime_error(msg);
+        }
+        try {
+            callback(batch);
+        } catch (...) {
+            // Otherwise the context couldn't be entered again.
+            PyContext_Exit(context.ptr());
+            throw;
+        }
+        error_code = PyContext_Exit(context.ptr());
+        if (error_code != 0) {
+            auto msg = "Failed to exit Python contextvars context.";
+            SPDLOG_LOGGER_ERROR(logger, msg);
+            throw std::runtime_error(msg);
+        }
+    }
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_SUBSCRIBERS_HPP
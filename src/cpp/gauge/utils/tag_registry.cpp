@@ -0,0 +1,48 @@
+#include "gauge/utils/tag_registry.hpp"
+
+using namespace gauge;
+
+detail::TagRegistry::TagRegistry(std::size_t capacity) : capacity{capacity} {}
+
+unsigned int detail::TagRegistry::intern(
+    const std::string &name,
+    const std::string &value) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    Tag  tag{name, value};
+    auto it = ids.find(tag);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    if (tags.size() >= capacity) {
+        refused_count++;
+        return 0;
+    }
+    tags.push_back(tag);
+    const auto id = static_cast<unsigned int>(tags.size());
+    ids.emplace(std::move(tag), id);
+    return id;
+}
+
+boost::optional<detail::TagRegistry::Tag>
+detail::TagRegistry::get(unsigned int id) {
+    const std::lock_guard<std::mutex> guard(mutex);
+    if (id == 0 || id > tags.size()) {
+        return boost::none;
+    }
+    return tags[id - 1];
+}
+
+std::size_t detail::TagRegistry::size() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return tags.size();
+}
+
+unsigned long long detail::TagRegistry::get_refused_count() {
+    const std::lock_guard<std::mutex> guard(mutex);
+    return refused_count;
+}
+
+detail::TagRegistry &detail::get_tag_registry() {
+    static TagRegistry registry;
+    return registry;
+}
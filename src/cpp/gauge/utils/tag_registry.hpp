@@ -0,0 +1,63 @@
+#ifndef GAUGE_TAG_REGISTRY_HPP
+#define GAUGE_TAG_REGISTRY_HPP
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Registry of tags - pairs of names and values interned as numeric IDs,
+ * so that traces and spans carry IDs instead of strings.
+ *
+ * IDs start from one and are never reused, tags are kept for the lifetime
+ * of the process. New tags are refused once the capacity is reached.
+ *
+ * Thread-safe.
+ */
+class TagRegistry {
+public:
+    using Tag = std::pair<std::string, std::string>;
+
+    explicit TagRegistry(std::size_t capacity = 1000000);
+
+    /**
+     * Get ID of the tag, the tag is registered if it's new.
+     *
+     * @return Zero if the registry is full.
+     */
+    unsigned int intern(const std::string &name, const std::string &value);
+
+    boost::optional<Tag> get(unsigned int id);
+
+    std::size_t size();
+
+    /**
+     * Get count of tags refused because the registry is full.
+     */
+    unsigned long long get_refused_count();
+
+private:
+    std::mutex                                              mutex;
+    std::size_t                                             capacity;
+    std::unordered_map<Tag, unsigned int, boost::hash<Tag>> ids;
+    std::vector<Tag>                                        tags;
+    unsigned long long                                      refused_count = 0;
+};
+
+/**
+ * Get the project-wide registry of tags.
+ */
+TagRegistry &get_tag_registry();
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_TAG_REGISTRY_HPP
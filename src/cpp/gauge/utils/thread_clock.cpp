@@ -0,0 +1,70 @@
+#include <pthread.h>
+#include <unistd.h>
+
+#include "gauge/utils/thread_clock.hpp"
+
+using namespace gauge;
+
+bool detail::ThreadCPUClocks::is_supported() {
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool detail::ThreadCPUClocks::has_clock(std::uint64_t unique_id) const {
+    return clocks.count(unique_id) != 0;
+}
+
+bool detail::ThreadCPUClocks::measure(
+    std::uint64_t      unique_id,
+    unsigned long long thread_id,
+    Measurement &      measurement) {
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+    auto it = clocks.find(unique_id);
+    measurement.is_first = it == clocks.end();
+    if (measurement.is_first) {
+        Clock clock;
+        // Thread IDs of Python threads are their pthread_t handles.
+        if (pthread_getcpuclockid(
+                static_cast<pthread_t>(thread_id),
+                &clock.id) != 0) {
+            return false;
+        }
+        it = clocks.emplace(unique_id, clock).first;
+    }
+    timespec value{};
+    if (clock_gettime(it->second.id, &value) != 0) {
+        // The thread has exited.
+        clocks.erase(it);
+        return false;
+    }
+    const auto cpu_time = std::chrono::seconds(value.tv_sec) +
+                          std::chrono::nanoseconds(value.tv_nsec);
+    measurement.cpu_time =
+        measurement.is_first ? std::chrono::nanoseconds(0)
+                             : cpu_time - it->second.cpu_time;
+    it->second.cpu_time          = cpu_time;
+    it->second.measurement_count = measurement_count;
+    return true;
+#else
+    (void)unique_id;
+    (void)thread_id;
+    (void)measurement;
+    return false;
+#endif
+}
+
+void detail::ThreadCPUClocks::forget_stale_clocks() {
+    for (auto it = clocks.begin(); it != clocks.end();) {
+        if (it->second.measurement_count != measurement_count) {
+            it = clocks.erase(it);
+        } else {
+            it++;
+        }
+    }
+    measurement_count++;
+}
+
+void detail::ThreadCPUClocks::clear() { clocks.clear(); }
@@ -0,0 +1,75 @@
+#ifndef GAUGE_THREAD_CLOCK_HPP
+#define GAUGE_THREAD_CLOCK_HPP
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include <time.h>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Measures CPU time consumed by threads between samples.
+ *
+ * Clocks are identified by unique IDs of thread states, so that reused
+ * thread IDs are never confused.
+ *
+ * Not thread-safe, the owner is responsible for synchronization.
+ */
+class ThreadCPUClocks {
+public:
+    struct Measurement {
+        /**
+         * CPU time consumed since the previous measurement.
+         */
+        std::chrono::nanoseconds cpu_time{0};
+        /**
+         * The thread is measured for the first time, "cpu_time" is zero.
+         */
+        bool is_first = false;
+    };
+
+    /**
+     * Check whether the platform provides per-thread CPU clocks.
+     */
+    static bool is_supported();
+
+    bool has_clock(std::uint64_t unique_id) const;
+
+    /**
+     * Measure CPU time consumed by the thread.
+     *
+     * If the thread is measured for the first time - its clock is resolved
+     * by the thread ID which requires the thread to be alive.
+     *
+     * @return False if the clock couldn't be resolved or read.
+     */
+    bool measure(
+        std::uint64_t      unique_id,
+        unsigned long long thread_id,
+        Measurement &      measurement);
+
+    /**
+     * Forget clocks of threads that haven't been measured since the previous
+     * call.
+     */
+    void forget_stale_clocks();
+
+    void clear();
+
+private:
+    struct Clock {
+        clockid_t                id = 0;
+        std::chrono::nanoseconds cpu_time{0};
+        unsigned long long       measurement_count = 0;
+    };
+
+    std::unordered_map<std::uint64_t, Clock> clocks;
+    unsigned long long                       measurement_count = 1;
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_THREAD_CLOCK_HPP
@@ -0,0 +1,104 @@
+#ifndef GAUGE_TTL_MAP_HPP
+#define GAUGE_TTL_MAP_HPP
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gauge {
+namespace detail {
+
+/**
+ * Map where items expire when they aren't accessed for longer than TTL.
+ *
+ * Items are kept in order of their last access, so expired ones are
+ * always at the front and expiry costs O(1) amortised. Expired items are
+ * only forgotten by expire(), which hands their values over, so that
+ * the owner decides when they are destroyed.
+ *
+ * Not thread-safe, the owner is responsible for synchronization.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class TTLMap {
+public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    explicit TTLMap(std::chrono::steady_clock::duration ttl) : ttl{ttl} {}
+
+    /**
+     * Find the value and prolong its life.
+     *
+     * @return Null if there is no such value or it has expired.
+     */
+    Value *find(const Key &key, TimePoint now) {
+        auto it = index.find(key);
+        if (it == index.end() || it->second->deadline <= now) {
+            return nullptr;
+        }
+        auto &item    = *it->second;
+        item.deadline = now + ttl;
+        items.splice(items.end(), items, it->second);
+        return &item.value;
+    }
+
+    /**
+     * Insert the value or replace the existing one.
+     */
+    Value &insert(const Key &key, Value value, TimePoint now) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            auto &item    = *it->second;
+            std::swap(item.value, value);
+            item.deadline = now + ttl;
+            items.splice(items.end(), items, it->second);
+            return item.value;
+        }
+        items.push_back(Item{key, std::move(value), now + ttl});
+        index.emplace(key, std::prev(items.end()));
+        return items.back().value;
+    }
+
+    /**
+     * Forget the values that have expired.
+     *
+     * @return Values of the forgotten items.
+     */
+    std::vector<Value> expire(TimePoint now) {
+        std::vector<Value> expired;
+        while (!items.empty() && items.front().deadline <= now) {
+            index.erase(items.front().key);
+            expired.push_back(std::move(items.front().value));
+            items.pop_front();
+        }
+        return expired;
+    }
+
+    std::size_t size() const { return items.size(); }
+
+    void clear() {
+        index.clear();
+        items.clear();
+    }
+
+private:
+    struct Item {
+        Key       key;
+        Value     value;
+        TimePoint deadline;
+    };
+
+    std::chrono::steady_clock::duration ttl;
+    /**
+     * The least recently accessed items come first.
+     */
+    std::list<Item>                                                   items;
+    std::unordered_map<Key, typename std::list<Item>::iterator, Hash> index;
+};
+
+} // namespace detail
+} // namespace gauge
+
+#endif // GAUGE_TTL_MAP_HPP
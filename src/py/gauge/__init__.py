@@ -8,11 +8,29 @@ from _gauge import (
     Frame,
     TraceSample,
     Span,
+    GILState,
+    SamplingSchedule,
+    BackpressurePolicy,
+    DispatchOptions,
+    DispatchStats,
+    LineStats,
+    LatencyStats,
+    GCStats,
     setup_logging,
+    get_tag,
 )
-from .collectors import CollectorInterface, SamplingCollector
-from .aggregators import SpanAggregator
-from .exporters import OpenTracingExporter
+from .collectors import (
+    AllocationCollector,
+    CollectorInterface,
+    GCCollector,
+    RemoteSamplingCollector,
+    SamplingCollector,
+    ThreadFilter,
+    TracingCollector,
+)
+from .aggregators import LatencyAggregator, LineAggregator, SpanAggregator
+from .filters import SpanFilter, SpanRetention
+from .exporters import ChromeTraceWriter, OpenTracingExporter
 
 __all__ = [
     "GaugeError",
@@ -24,9 +42,28 @@ __all__ = [
     "Frame",
     "TraceSample",
     "Span",
+    "GILState",
+    "SamplingSchedule",
+    "BackpressurePolicy",
+    "DispatchOptions",
+    "DispatchStats",
+    "LineStats",
+    "LatencyStats",
+    "GCStats",
+    "AllocationCollector",
     "CollectorInterface",
+    "GCCollector",
+    "RemoteSamplingCollector",
     "SamplingCollector",
+    "ThreadFilter",
+    "TracingCollector",
+    "LatencyAggregator",
+    "LineAggregator",
     "SpanAggregator",
+    "SpanFilter",
+    "SpanRetention",
+    "ChromeTraceWriter",
     "OpenTracingExporter",
     "setup_logging",
+    "get_tag",
 ]
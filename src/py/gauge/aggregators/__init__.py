@@ -1,4 +1,6 @@
+from .latency_aggregator import LatencyAggregator
+from .line_aggregator import LineAggregator
 from .span_aggregator import SpanAggregator
 
 
-__all__ = ["SpanAggregator"]
+__all__ = ["LatencyAggregator", "LineAggregator", "SpanAggregator"]
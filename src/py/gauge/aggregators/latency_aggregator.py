@@ -0,0 +1,68 @@
+import datetime as dt
+from typing import Callable, List
+
+from .. import Span
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import LatencyAggregator as LatencyAggregatorImpl
+from _gauge import LatencyStats
+
+
+class LatencyAggregator:
+    """Counts durations of calls per function in HDR histograms natively.
+
+    Durations are kept for a sliding window of ``window_count`` windows of
+    ``window`` each, stats of the sliding window are passed to subscribers
+    each time a window is switched. With ``by_top_span`` durations are
+    grouped by functions of top-level spans as well.
+
+    ``LatencyStats.histogram`` holds non-zero counters of the histogram
+    as little-endian 64-bit pairs of the lowest durations in nanoseconds
+    and counts, e.g. for NumPy:
+    ``numpy.frombuffer(stats.histogram, dtype="<u8").reshape(-1, 2)``.
+
+    At most ``max_open_spans`` spans are kept open, the older half of them
+    is dropped when the limit is reached.
+    """
+
+    def __init__(
+        self,
+        window: dt.timedelta = dt.timedelta(seconds=10),
+        window_count: int = 6,
+        by_top_span: bool = False,
+        significant_digits: int = 2,
+        max_open_spans: int = 65536,
+    ):
+        self.__impl = LatencyAggregatorImpl(
+            window=window,
+            window_count=window_count,
+            by_top_span=by_top_span,
+            significant_digits=significant_digits,
+            max_open_spans=max_open_spans,
+        )
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: Callable[[List[LatencyStats]], None],
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def snapshot(self) -> List[LatencyStats]:
+        return list(self.__impl.snapshot())
+
+    def reset(self):
+        self.__impl.reset()
+
+    def __call__(self, spans: List[Span]):
+        self.__impl(spans)
@@ -0,0 +1,57 @@
+import datetime as dt
+from typing import Callable, List
+
+from .. import TraceSample
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import LineAggregator as LineAggregatorImpl
+from _gauge import LineStats
+
+
+class LineAggregator:
+    """Counts samples per line of code natively.
+
+    With ``snapshot_interval`` set, counters are periodically passed to
+    subscribers and reset.
+    """
+
+    def __init__(self, snapshot_interval: dt.timedelta = dt.timedelta(0)):
+        self.__impl = LineAggregatorImpl(snapshot_interval=snapshot_interval)
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: Callable[[List[LineStats]], None],
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def snapshot(self, reset: bool = False) -> List[LineStats]:
+        return list(self.__impl.snapshot(reset))
+
+    def top(
+        self, count: int, by_total: bool = False, by_cpu_time: bool = False
+    ) -> List[LineStats]:
+        """Get lines with the highest self (or total) times and counts.
+
+        With ``by_cpu_time`` lines are ordered by CPU times first.
+        """
+        return list(self.__impl.top(count, by_total, by_cpu_time))
+
+    def reset(self):
+        self.__impl.reset()
+
+    def get_samples_count(self) -> int:
+        return self.__impl.get_samples_count()
+
+    def __call__(self, traces: List[TraceSample]):
+        self.__impl(traces)
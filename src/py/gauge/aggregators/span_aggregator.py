@@ -2,20 +2,83 @@ import datetime as dt
 from typing import Callable, List
 
 from .. import Span, TraceSample
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
 from _gauge import SpanAggregator as SpanAggregatorImpl
 
 
 class SpanAggregator:
     def __init__(
-        self, span_ttl: dt.timedelta = dt.timedelta(milliseconds=200)
+        self,
+        span_ttl: dt.timedelta = dt.timedelta(milliseconds=200),
+        max_open_spans: int = 0,
+        max_open_spans_bytes: int = 0,
+        coalesce_siblings: bool = False,
     ):
         self.__impl = SpanAggregatorImpl(span_ttl=span_ttl)
+        if max_open_spans or max_open_spans_bytes:
+            self.__impl.set_open_spans_budget(
+                max_open_spans, max_open_spans_bytes
+            )
+        if coalesce_siblings:
+            self.__impl.set_sibling_coalescing(True)
 
-    def subscribe(self, callback: Callable[[List[Span]], None]):
-        self.__impl.subscribe(callback)
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: Callable[[List[Span]], None],
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
 
     def finish_open_spans(self):
         self.__impl.finish_open_spans()
 
+    def set_open_spans_budget(self, max_count: int, max_bytes: int = 0):
+        """Bound open spans by count and estimated size, zero is no limit.
+
+        Over the budget the least recently seen spans are ended together
+        with their descendants.
+        """
+        self.__impl.set_open_spans_budget(max_count, max_bytes)
+
+    def get_open_spans_count(self) -> int:
+        return self.__impl.get_open_spans_count()
+
+    def get_open_spans_bytes(self) -> int:
+        """Get estimated memory used by open spans."""
+        return self.__impl.get_open_spans_bytes()
+
+    def get_evicted_spans_count(self) -> int:
+        """Get count of spans ended because of the budget."""
+        return self.__impl.get_evicted_spans_count()
+
+    def set_sibling_coalescing(self, enabled: bool):
+        """Merge consecutive calls of the same function into one span.
+
+        Calls are merged when they are made from the same line of the same
+        parent, the span carries ``repetition_count`` and
+        ``summed_duration`` of the calls.
+        """
+        self.__impl.set_sibling_coalescing(enabled)
+
+    def is_coalescing_siblings(self) -> bool:
+        return self.__impl.is_coalescing_siblings()
+
     def __call__(self, traces: List[TraceSample]):
         self.__impl(traces)
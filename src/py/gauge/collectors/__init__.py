@@ -1,5 +1,18 @@
+from .allocation_collector import AllocationCollector
 from .base import CollectorInterface
+from .gc_collector import GCCollector
+from .remote_sampling_collector import RemoteSamplingCollector
 from .sampling_collector import SamplingCollector
+from .thread_filter import ThreadFilter
+from .tracing_collector import TracingCollector
 
 
-__all__ = ["CollectorInterface", "SamplingCollector"]
+__all__ = [
+    "AllocationCollector",
+    "CollectorInterface",
+    "GCCollector",
+    "RemoteSamplingCollector",
+    "SamplingCollector",
+    "ThreadFilter",
+    "TracingCollector",
+]
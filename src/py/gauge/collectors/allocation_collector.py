@@ -0,0 +1,76 @@
+import datetime as dt
+from typing import List
+
+from .base import CollectorInterface
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import AllocationCollector as AllocationCollectorImpl
+
+
+class AllocationCollector(CollectorInterface):
+    """Samples allocations of memory, one per ``sampling_rate`` bytes."""
+
+    def __init__(
+        self,
+        sampling_rate: int = 512 * 1024,
+        processing_interval: dt.timedelta = dt.timedelta(seconds=1),
+    ):
+        self.__impl = AllocationCollectorImpl(
+            sampling_rate=sampling_rate,
+            processing_interval=processing_interval,
+        )
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: CollectorInterface.CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def start(self):
+        return self.__impl.start()
+
+    def pause(self):
+        return self.__impl.pause()
+
+    def is_paused(self):
+        return self.__impl.is_paused()
+
+    def resume(self):
+        return self.__impl.resume()
+
+    def stop(self):
+        return self.__impl.stop()
+
+    def is_stopped(self):
+        return self.__impl.is_stopped()
+
+    def get_sampling_rate(self) -> int:
+        return self.__impl.get_sampling_rate()
+
+    def dump(self, path: str, live: bool = False) -> int:
+        """Write the profile to the file as collapsed stacks of bytes.
+
+        With ``live`` only memory that hasn't been released yet is written.
+        Returns count of the written stacks.
+        """
+        return self.__impl.dump(path, live)
+
+    def get_live_samples_count(self) -> int:
+        return self.__impl.get_live_samples_count()
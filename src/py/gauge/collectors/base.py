@@ -1,12 +1,17 @@
 from typing import Callable, List
 
-from .. import TraceSample
+from .. import BackpressurePolicy, TraceSample
 
 
 class CollectorInterface:
     CollectCallback = Callable[[List[TraceSample]], None]
 
-    def subscribe(self, callback: CollectCallback):
+    def subscribe(
+        self,
+        callback: CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
         raise NotImplementedError
 
     def install(self):
@@ -0,0 +1,66 @@
+import datetime as dt
+from typing import List
+
+from .base import CollectorInterface
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import GCCollector as GCCollectorImpl
+from _gauge import GCStats
+
+
+class GCCollector(CollectorInterface):
+    """Records pauses of the garbage collector as traces of one frame."""
+
+    def __init__(
+        self,
+        processing_interval: dt.timedelta = dt.timedelta(microseconds=100000),
+    ):
+        self.__impl = GCCollectorImpl(processing_interval=processing_interval)
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: CollectorInterface.CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def start(self):
+        return self.__impl.start()
+
+    def pause(self):
+        return self.__impl.pause()
+
+    def is_paused(self):
+        return self.__impl.is_paused()
+
+    def resume(self):
+        return self.__impl.resume()
+
+    def stop(self):
+        return self.__impl.stop()
+
+    def is_stopped(self):
+        return self.__impl.is_stopped()
+
+    def get_stats(self) -> List[GCStats]:
+        """Get counts and pauses of processed collections by generations."""
+        return self.__impl.get_stats()
+
+    def get_dropped_events_count(self) -> int:
+        return self.__impl.get_dropped_events_count()
@@ -0,0 +1,88 @@
+import datetime as dt
+from typing import List
+
+from .base import CollectorInterface
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import RemoteSamplingCollector as RemoteSamplingCollectorImpl
+
+
+class RemoteSamplingCollector(CollectorInterface):
+    """Samples stacks of another Python process by its PID (Linux only).
+
+    The process' memory is read with ``process_vm_readv()``, so it's never
+    stopped and pays nothing for being sampled. It has to run the same
+    version of Python, reading its memory requires the same privileges as
+    attaching a debugger to it.
+    """
+
+    def __init__(
+        self,
+        pid: int,
+        sampling_interval: dt.timedelta = dt.timedelta(microseconds=1000),
+        processing_interval: dt.timedelta = dt.timedelta(microseconds=1000000),
+    ):
+        self.__impl = RemoteSamplingCollectorImpl(
+            pid=pid,
+            sampling_interval=sampling_interval,
+            processing_interval=processing_interval,
+        )
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    @property
+    def pid(self) -> int:
+        return self.__impl.get_pid()
+
+    def subscribe(
+        self,
+        callback: CollectorInterface.CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def start(self):
+        return self.__impl.start()
+
+    def pause(self):
+        return self.__impl.pause()
+
+    def is_paused(self):
+        return self.__impl.is_paused()
+
+    def resume(self):
+        return self.__impl.resume()
+
+    def stop(self):
+        return self.__impl.stop()
+
+    def is_stopped(self):
+        return self.__impl.is_stopped()
+
+    def get_sampling_interval(self):
+        return self.__impl.get_sampling_interval()
+
+    def set_sampling_interval(self, interval: dt.timedelta):
+        self.__impl.set_sampling_interval(interval)
+
+    def get_dropped_samples_count(self) -> int:
+        """Get count of samples dropped because processing fell behind."""
+        return self.__impl.get_dropped_samples_count()
+
+    def get_failed_samples_count(self) -> int:
+        """Get count of samples of the process that couldn't be copied."""
+        return self.__impl.get_failed_samples_count()
@@ -1,7 +1,14 @@
+import contextvars
 import datetime as dt
+import signal
+from typing import Callable, List, Optional, Sequence
 
 from .base import CollectorInterface
+from .thread_filter import ThreadFilter
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
 from _gauge import SamplingCollector as SamplingCollectorImpl
+from _gauge import SamplingSchedule
 
 
 class SamplingCollector(CollectorInterface):
@@ -9,14 +16,63 @@ class SamplingCollector(CollectorInterface):
         self,
         sampling_interval: dt.timedelta = dt.timedelta(microseconds=1000),
         processing_interval: dt.timedelta = dt.timedelta(microseconds=1000000),
+        collect_async_tasks: bool = False,
+        suppress_unchanged_stacks: bool = False,
+        gil_free_sampling: bool = False,
+        cpu_time_sampling: bool = False,
+        skip_idle_threads: bool = False,
+        gil_sampling: bool = False,
+        flight_recorder_capacity: int = 0,
+        sampling_schedule: SamplingSchedule = SamplingSchedule.Fixed,
+        context_vars: Sequence[contextvars.ContextVar] = (),
     ):
         self.__impl = SamplingCollectorImpl(
             sampling_interval=sampling_interval,
             processing_interval=processing_interval,
         )
+        if collect_async_tasks:
+            self.__impl.set_async_tasks_collection(True)
+        if suppress_unchanged_stacks:
+            self.__impl.set_unchanged_stacks_suppression(True)
+        if gil_free_sampling:
+            self.__impl.set_gil_free_sampling(True)
+        if cpu_time_sampling:
+            self.__impl.set_cpu_time_sampling(True, skip_idle_threads)
+        if gil_sampling:
+            self.__impl.set_gil_sampling(True)
+        if flight_recorder_capacity:
+            self.__impl.set_flight_recording(True, flight_recorder_capacity)
+        self.__impl.set_sampling_schedule(sampling_schedule)
+        if context_vars:
+            self.__impl.set_context_vars(list(context_vars))
+        self.__thread_filter = ThreadFilter(self.__impl.get_thread_filter())
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    @property
+    def thread_filter(self) -> ThreadFilter:
+        return self.__thread_filter
+
+    def subscribe(
+        self,
+        callback: CollectorInterface.CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
 
-    def subscribe(self, callback: CollectorInterface.CollectCallback):
-        self.__impl.subscribe(callback)
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
 
     def install(self):
         self.__impl.install()
@@ -53,3 +109,112 @@ class SamplingCollector(CollectorInterface):
 
     def set_collecting_interval(self, interval: dt.timedelta):
         self.__impl.set_collecting_interval(interval)
+
+    def set_async_tasks_collection(self, enabled: bool):
+        """Collect await-chains of asyncio tasks as separate threads."""
+        self.__impl.set_async_tasks_collection(enabled)
+
+    def is_collecting_async_tasks(self) -> bool:
+        return self.__impl.is_collecting_async_tasks()
+
+    def set_unchanged_stacks_suppression(self, enabled: bool):
+        """Emit unchanged stacks as ``TraceSample.is_unchanged`` markers."""
+        self.__impl.set_unchanged_stacks_suppression(enabled)
+
+    def is_suppressing_unchanged_stacks(self) -> bool:
+        return self.__impl.is_suppressing_unchanged_stacks()
+
+    def set_gil_free_sampling(self, enabled: bool):
+        """Copy stacks of threads without taking the GIL (experimental)."""
+        self.__impl.set_gil_free_sampling(enabled)
+
+    def is_gil_free_sampling(self) -> bool:
+        return self.__impl.is_gil_free_sampling()
+
+    def set_cpu_time_sampling(
+        self, enabled: bool, skip_idle_threads: bool = False
+    ):
+        """Measure CPU time consumed by threads between samples."""
+        self.__impl.set_cpu_time_sampling(enabled, skip_idle_threads)
+
+    def is_cpu_time_sampling(self) -> bool:
+        return self.__impl.is_cpu_time_sampling()
+
+    def set_gil_sampling(self, enabled: bool):
+        """Mark traces of threads holding the GIL with their GIL wait."""
+        self.__impl.set_gil_sampling(enabled)
+
+    def is_gil_sampling(self) -> bool:
+        return self.__impl.is_gil_sampling()
+
+    def set_sampling_schedule(self, schedule: SamplingSchedule):
+        """Choose how intervals between samples are drawn."""
+        self.__impl.set_sampling_schedule(schedule)
+
+    def get_sampling_schedule(self) -> SamplingSchedule:
+        return self.__impl.get_sampling_schedule()
+
+    def set_context_vars(self, context_vars: Sequence[contextvars.ContextVar]):
+        """Tag traces with values of the variables in threads' contexts.
+
+        Traces and spans carry IDs of the tags, :py:func:`gauge.get_tag`
+        resolves them to pairs of names and values.
+        """
+        self.__impl.set_context_vars(list(context_vars))
+
+    def get_dropped_samples_count(self) -> int:
+        """Get count of samples dropped because processing fell behind."""
+        return self.__impl.get_dropped_samples_count()
+
+    def set_flight_recording(self, enabled: bool, capacity: int = 1000000):
+        """Keep the latest ``capacity`` frames in memory instead of emitting.
+
+        Recorded samples are passed further only by :meth:`dump` or
+        :meth:`replay`.
+        """
+        self.__impl.set_flight_recording(enabled, capacity)
+
+    def is_flight_recording(self) -> bool:
+        return self.__impl.is_flight_recording()
+
+    def dump(self, path: str, window: dt.timedelta = dt.timedelta(0)) -> int:
+        """Write recorded samples to the file as collapsed stacks.
+
+        Only the samples of the latest ``window`` are written, all of them
+        if it's zero. Returns count of the written samples.
+        """
+        return self.__impl.dump(path, window)
+
+    def replay(self, window: dt.timedelta = dt.timedelta(0)) -> int:
+        """Pass recorded samples to the subscribers."""
+        return self.__impl.replay(window)
+
+    def set_dump_watchdog(
+        self,
+        functions: List[Callable],
+        threshold: dt.timedelta,
+        path: Optional[str] = None,
+        window: dt.timedelta = dt.timedelta(0),
+    ):
+        """Dump recorded samples when a call of the functions lasts too long.
+
+        Samples are replayed to the subscribers if ``path`` isn't given.
+        An empty list of functions disables the watchdog.
+        """
+        self.__impl.set_dump_watchdog(functions, threshold, path or "", window)
+
+    def dump_on_signal(
+        self,
+        signum: int,
+        path: str,
+        window: dt.timedelta = dt.timedelta(0),
+    ):
+        """Dump recorded samples when the process receives the signal.
+
+        Must be called from the main thread.
+        """
+
+        def handler(received_signum, frame):
+            self.dump(path, window)
+
+        signal.signal(signum, handler)
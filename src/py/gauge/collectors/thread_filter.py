@@ -0,0 +1,60 @@
+import contextlib
+import threading
+from typing import Iterable, Optional
+
+
+class ThreadFilter:
+    """Decides which threads are sampled by a collector.
+
+    Filtering is done before any of thread's frames are touched, so
+    filtered out threads cost almost nothing.
+    """
+
+    def __init__(self, impl):
+        self.__impl = impl
+
+    def set_included_ids(self, ids: Iterable[int]):
+        self.__impl.set_included_ids(list(ids))
+
+    def set_excluded_ids(self, ids: Iterable[int]):
+        self.__impl.set_excluded_ids(list(ids))
+
+    def set_included_names(self, patterns: Iterable[str]):
+        """Sample only threads with names matching any of glob patterns."""
+        self.__impl.set_included_names(list(patterns))
+
+    def set_excluded_names(self, patterns: Iterable[str]):
+        """Don't sample threads with names matching any of glob patterns."""
+        self.__impl.set_excluded_names(list(patterns))
+
+    def set_only_active(self, only_active: bool):
+        """Sample only threads marked as active."""
+        self.__impl.set_only_active(only_active)
+
+    def is_only_active(self) -> bool:
+        return self.__impl.is_only_active()
+
+    def mark_active(self, thread_id: Optional[int] = None):
+        if thread_id is None:
+            thread_id = threading.get_ident()
+        self.__impl.mark_active(thread_id)
+
+    def mark_inactive(self, thread_id: Optional[int] = None):
+        if thread_id is None:
+            thread_id = threading.get_ident()
+        self.__impl.mark_inactive(thread_id)
+
+    @contextlib.contextmanager
+    def active(self):
+        """Mark the current thread as active while in the context.
+
+        Meant to be used in request handlers together with
+        :py:meth:`set_only_active` so that only threads that handle requests
+        are sampled.
+        """
+        thread_id = threading.get_ident()
+        self.__impl.mark_active(thread_id)
+        try:
+            yield
+        finally:
+            self.__impl.mark_inactive(thread_id)
@@ -0,0 +1,67 @@
+import datetime as dt
+from typing import Any, Iterable, List
+
+from .base import CollectorInterface
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import TracingCollector as TracingCollectorImpl
+
+
+class TracingCollector(CollectorInterface):
+    def __init__(
+        self,
+        traced_functions: Iterable[Any] = (),
+        processing_interval: dt.timedelta = dt.timedelta(microseconds=100000),
+    ):
+        self.__impl = TracingCollectorImpl(
+            processing_interval=processing_interval
+        )
+        self.__impl.set_traced_functions(list(traced_functions))
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: CollectorInterface.CollectCallback,
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def start(self):
+        return self.__impl.start()
+
+    def pause(self):
+        return self.__impl.pause()
+
+    def is_paused(self):
+        return self.__impl.is_paused()
+
+    def resume(self):
+        return self.__impl.resume()
+
+    def stop(self):
+        return self.__impl.stop()
+
+    def is_stopped(self):
+        return self.__impl.is_stopped()
+
+    def set_traced_functions(self, functions: Iterable[Any]):
+        """Record calls of the functions (or code objects) only."""
+        self.__impl.set_traced_functions(list(functions))
+
+    def get_dropped_events_count(self) -> int:
+        return self.__impl.get_dropped_events_count()
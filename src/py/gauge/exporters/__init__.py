@@ -1,4 +1,5 @@
+from .chrome_trace_writer import ChromeTraceWriter
 from .opentracing_exporter import OpenTracingExporter
 
 
-__all__ = ["OpenTracingExporter"]
+__all__ = ["ChromeTraceWriter", "OpenTracingExporter"]
@@ -0,0 +1,52 @@
+"""Provides :py:class:`ChromeTraceWriter` class."""
+from typing import List
+
+from .. import Span
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import ChromeTraceWriter as ChromeTraceWriterImpl
+
+
+class ChromeTraceWriter:
+    """Streams spans to files in the Chrome trace event format.
+
+    The files are opened by ``chrome://tracing`` and Perfetto UI, spans of
+    each thread are shown on a track of their own. Spans are written by a
+    dedicated thread, up to ``queue_capacity`` batches are queued for it.
+
+    With ``max_file_size`` the file is rotated once it grows over the size
+    in bytes, numbers of the following files are inserted before
+    the extension - ``trace.1.json``. Each file is a complete trace.
+    """
+
+    def __init__(
+        self,
+        path: str,
+        max_file_size: int = 0,
+        queue_capacity: int = 64,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        self.__impl = ChromeTraceWriterImpl(
+            path=path,
+            max_file_size=max_file_size,
+            options=DispatchOptions(queue_capacity, policy),
+        )
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def close(self):
+        """Write queued spans and complete the current file."""
+        self.__impl.close()
+
+    def get_paths(self) -> List[str]:
+        return self.__impl.get_paths()
+
+    def get_written_events_count(self) -> int:
+        return self.__impl.get_written_events_count()
+
+    def get_dispatch_stats(self) -> DispatchStats:
+        return self.__impl.get_dispatch_stats()
+
+    def __call__(self, spans: List[Span]):
+        self.__impl(spans)
@@ -3,14 +3,15 @@ import contextvars
 import logging
 import sys
 from threading import Lock
-from typing import Dict, List, Optional, Tuple
+from typing import List
 
 import opentracing
 
 from .. import Span
-from ..utils.ttldict import TTLDict
+from _gauge import SpanRegistry, get_tag
 
 LOGGER = logging.getLogger("gauge")
+_START = Span.SpanLifeTime.Start
 
 
 class OpenTracingExporter:
@@ -29,19 +30,14 @@ class OpenTracingExporter:
         self.__tracer = tracer
         self.__ignore_active_span = ignore_active_span
 
-        self.__span_by_id: Dict[int, Tuple[Span, opentracing.Span, bool]] = {}
-        # Execution contexts mapped to process ids and thread ids of the
-        # spans.
+        # Started spans and execution contexts mapped to process ids and
+        # thread ids of the spans.
         # This is needed to make it possible to run calls to 'tracer' in
         # separate contexts distinguished by process ids and thread ids.
         # So that tracer implementations that store spans using contextvars
         # (namely Elastic APM Python client) would not mix up spans from
         # different threads.
-        self.__context_by_pid_tid = TTLDict(ttl=30.0)
-
-        self.__strip_levels: Dict[
-            Tuple[Optional[int], Optional[int]], int
-        ] = {}
+        self.__registry = SpanRegistry(contextvars.Context)
         self.__lock = Lock()
 
     def strip_levels(self, count: int, process_id=None, thread_id=None):
@@ -65,86 +61,10 @@ class OpenTracingExporter:
             Thread ID of spans that should be striped. ``None`` value serves as
             a wildcard.
         """
-        with self.__lock:
-            key = (process_id, thread_id)
-            if count == 0:
-                try:
-                    del self.__strip_levels[key]
-                except KeyError:
-                    pass
-                return
-
-            self.__strip_levels[(process_id, thread_id)] = count
-
-    def __get_ancestor_spans(self, span: Span):
-        while True:
-            if span.is_top:
-                break
-            try:
-                parent_span, ot_span, is_stripped = self.__span_by_id[
-                    span.parent_id
-                ]
-            except KeyError:
-                break
-            yield parent_span, ot_span, is_stripped
-            span = parent_span
-
-    def __should_strip(self, span):
-        n_ancestors = len(list(self.__get_ancestor_spans(span)))
-
-        for key in [
-            (span.process_id, span.thread_id),
-            (span.process_id, None),
-            (None, span.thread_id),
-            (None, None),
-        ]:
-            try:
-                strip_levels = self.__strip_levels[key]
-            except KeyError:
-                continue
-            if (n_ancestors + 1) <= strip_levels:
-                return True
-        return False
-
-    def __is_top(self, span):
-        for _, __, is_stripped in self.__get_ancestor_spans(span):
-            if not is_stripped:
-                return False
-
-        return True
+        self.__registry.strip_levels(count, process_id, thread_id)
 
-    def __start_span(self, span):
-        if span.id in self.__span_by_id:
-            LOGGER.debug(
-                "Duplicate span with lifetime 'Start' " "with id '%s'", span.id
-            )
-            return
-        kwargs = {
-            "operation_name": span.symbolic_name,
-            "start_time": span.timestamp.timestamp(),
-            "ignore_active_span": (
-                self.__ignore_active_span and self.__is_top(span)
-            ),
-        }
-        if not span.is_top:
-            try:
-                parent_span, parent_ot_span, is_stripped = self.__span_by_id[
-                    span.parent_id
-                ]
-            except KeyError:
-                LOGGER.warning(
-                    "Parent span with id '%s' is not found.", span.parent_id
-                )
-                return
-            kwargs["child_of"] = parent_ot_span
-            LOGGER.debug(
-                "%s is child of %s",
-                span.symbolic_name,
-                parent_span.symbolic_name,
-            )
-        else:
-            LOGGER.debug("Top span: %s", span.symbolic_name)
-        kwargs["tags"] = {
+    def __start_span(self, span, entry):
+        tags = {
             "hostname": span.hostname,
             "process_id": span.process_id,
             "thread_id": span.thread_id,
@@ -153,81 +73,45 @@ class OpenTracingExporter:
             "is_coroutine": span.is_coroutine,
             "is_generator": span.is_generator,
         }
-        context = self.__context_by_pid_tid.setdefault(
-            (span.process_id, span.thread_id), contextvars.Context()
-        )
-        should_strip = self.__should_strip(span)
-        ot_span = None
-        if not should_strip:
-            ot_span = context.run(self.__tracer.start_span, **kwargs)
-
-        self.__span_by_id[span.id] = (span, ot_span, should_strip)
-        LOGGER.debug(
-            "Started span with id '%s' and name '%s'%s.",
-            span.id,
-            span.symbolic_name,
-            " as stripped" if should_strip else "",
+        for tag_id in span.tags:
+            tag = get_tag(tag_id)
+            if tag is not None:
+                tags[tag[0]] = tag[1]
+        kwargs = {
+            "operation_name": span.symbolic_name,
+            "start_time": span.timestamp.timestamp(),
+            "ignore_active_span": self.__ignore_active_span and entry.is_top,
+            "tags": tags,
+        }
+        parent = entry.parent
+        if parent is not None:
+            kwargs["child_of"] = parent.tracer_span
+        entry.tracer_span = entry.context.run(
+            self.__tracer.start_span, **kwargs
         )
 
-    def __get_span_by_id(self, span_id, remove=False, quiet=False):
-        try:
-            if remove:
-                return self.__span_by_id.pop(span_id)
-            else:
-                return self.__span_by_id[span_id]
-        except KeyError:
-            if not quiet:
-                LOGGER.warning("Span with id '%s' is not found.", span_id)
-            raise
-
-    def __end_span(self, span):
-        try:
-            start_span, start_ot_span, is_stripped = self.__get_span_by_id(
-                span.id, remove=True
-            )
-        except KeyError:
+    def __end_span(self, span, entry):
+        tracer_span = entry.tracer_span
+        if tracer_span is None:
             return
-        if is_stripped:
-            LOGGER.debug(
-                "Span '%s' is stripped, skipping ending it.",
-                start_span.symbolic_name,
+        if span.repetition_count > 1:
+            tracer_span.set_tag("repetition_count", span.repetition_count)
+            tracer_span.set_tag(
+                "summed_duration", span.summed_duration.total_seconds()
             )
-            return
-
-        LOGGER.debug(
-            "Ending span '%s'. Duration: %s...",
-            start_span.symbolic_name,
-            span.timestamp - start_span.timestamp,
-        )
-        context = self.__context_by_pid_tid.setdefault(
-            (span.process_id, span.thread_id), contextvars.copy_context()
-        )
         try:
-            context.run(
-                start_ot_span.finish, finish_time=span.timestamp.timestamp()
+            entry.context.run(
+                tracer_span.finish, finish_time=span.timestamp.timestamp()
             )
         except Exception as exc:
             LOGGER.warning(exc, exc_info=sys.exc_info())
 
     def __call__(self, spans: List[Span]):
-        for span in spans:
-            if span.lifetime == Span.SpanLifeTime.Start:
-                LOGGER.debug(
-                    "Processing start-span with id '%s', name '%s' and "
-                    "timestamp '%s'.",
-                    span.id,
-                    span.symbolic_name,
-                    span.timestamp,
-                )
-                with self.__lock:
-                    self.__start_span(span)
-            elif span.lifetime == Span.SpanLifeTime.End:
-                LOGGER.debug(
-                    "Processing end-span with id '%s', name '%s' and "
-                    "timestamp '%s'.",
-                    span.id,
-                    span.symbolic_name,
-                    span.timestamp,
-                )
-                with self.__lock:
-                    self.__end_span(span)
+        # Bookkeeping of the whole batch is done natively, only the calls
+        # to 'tracer' are left.
+        with self.__lock:
+            for span, entry in self.__registry(spans):
+                if span.lifetime == _START:
+                    self.__start_span(span, entry)
+                else:
+                    self.__end_span(span, entry)
@@ -0,0 +1,5 @@
+from .span_filter import SpanFilter
+from .span_retention import SpanRetention
+
+
+__all__ = ["SpanFilter", "SpanRetention"]
@@ -0,0 +1,98 @@
+import datetime as dt
+import os
+import sys
+from typing import Callable, Iterable, List, Optional
+
+from .. import Span
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import SpanFilter as SpanFilterImpl
+
+
+class SpanFilter:
+    """Filters spans natively before they are converted to Python objects.
+
+    Should be subscribed to an aggregator and exporters should be
+    subscribed to it instead of the aggregator.
+
+    Names of modules are derived from file names relative to entries of
+    ``sys.path`` as they are when the module lists are set.
+    """
+
+    def __init__(
+        self,
+        min_duration: dt.timedelta = dt.timedelta(0),
+        allowed_files: Iterable[str] = (),
+        denied_files: Iterable[str] = (),
+        allowed_modules: Iterable[str] = (),
+        denied_modules: Iterable[str] = (),
+    ):
+        self.__impl = SpanFilterImpl(min_duration=min_duration)
+        self.__impl.set_allowed_files(list(allowed_files))
+        self.__impl.set_denied_files(list(denied_files))
+        self.set_allowed_modules(allowed_modules)
+        self.set_denied_modules(denied_modules)
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: Callable[[List[Span]], None],
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        """Subscribe the callback, optionally with its own queue and thread.
+
+        With ``queue_capacity`` above zero the callback is called from
+        a dedicated thread, ``policy`` decides what happens when the queue
+        is full.
+        """
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def strip_levels(
+        self,
+        count: int,
+        process_id: Optional[int] = None,
+        thread_id: Optional[int] = None,
+    ):
+        """Strip 'count' of topmost levels, ``None`` serves as a wildcard."""
+        self.__impl.strip_levels(count, process_id, thread_id)
+
+    def set_allowed_files(self, patterns: Iterable[str]):
+        """Keep only spans with file names matching any of glob patterns."""
+        self.__impl.set_allowed_files(list(patterns))
+
+    def set_denied_files(self, patterns: Iterable[str]):
+        """Drop spans with file names matching any of glob patterns."""
+        self.__impl.set_denied_files(list(patterns))
+
+    def set_allowed_modules(self, patterns: Iterable[str]):
+        """Keep only spans of modules matching any of glob patterns."""
+        self.__update_module_roots()
+        self.__impl.set_allowed_modules(list(patterns))
+
+    def set_denied_modules(self, patterns: Iterable[str]):
+        """Drop spans of modules matching any of glob patterns."""
+        self.__update_module_roots()
+        self.__impl.set_denied_modules(list(patterns))
+
+    def __update_module_roots(self):
+        self.__impl.set_module_roots(
+            [os.path.abspath(path or os.curdir) for path in sys.path]
+        )
+
+    def get_min_duration(self) -> dt.timedelta:
+        return self.__impl.get_min_duration()
+
+    def set_min_duration(self, duration: dt.timedelta):
+        self.__impl.set_min_duration(duration)
+
+    def __call__(self, spans: List[Span]):
+        self.__impl(spans)
@@ -0,0 +1,67 @@
+import datetime as dt
+from typing import Callable, List
+
+from .. import Span
+from ..utils.native import unwrap
+from _gauge import BackpressurePolicy, DispatchOptions, DispatchStats
+from _gauge import SpanRetention as SpanRetentionImpl
+
+
+class SpanRetention:
+    """Keeps only slow call-trees, deciding once their top-level spans end.
+
+    Spans of each tree are held natively until the tree's top-level span
+    ends, the whole tree is passed further if the top-level span has
+    lasted at least ``min_duration`` or with probability of
+    ``sample_rate``. At most ``max_held_spans`` spans are held per thread.
+    """
+
+    def __init__(
+        self,
+        min_duration: dt.timedelta = dt.timedelta(milliseconds=100),
+        sample_rate: float = 0.0,
+        max_held_spans: int = 10000,
+    ):
+        self.__impl = SpanRetentionImpl(
+            min_duration=min_duration,
+            sample_rate=sample_rate,
+            max_held_spans=max_held_spans,
+        )
+
+    @property
+    def _native(self):
+        return self.__impl
+
+    def subscribe(
+        self,
+        callback: Callable[[List[Span]], None],
+        queue_capacity: int = 0,
+        policy: BackpressurePolicy = BackpressurePolicy.Block,
+    ):
+        self.__impl.subscribe(
+            unwrap(callback), DispatchOptions(queue_capacity, policy)
+        )
+
+    def get_dispatch_stats(self) -> List[DispatchStats]:
+        return self.__impl.get_dispatch_stats()
+
+    def get_min_duration(self) -> dt.timedelta:
+        return self.__impl.get_min_duration()
+
+    def set_min_duration(self, duration: dt.timedelta):
+        self.__impl.set_min_duration(duration)
+
+    def get_sample_rate(self) -> float:
+        return self.__impl.get_sample_rate()
+
+    def set_sample_rate(self, rate: float):
+        self.__impl.set_sample_rate(rate)
+
+    def get_kept_trees_count(self) -> int:
+        return self.__impl.get_kept_trees_count()
+
+    def get_dropped_trees_count(self) -> int:
+        return self.__impl.get_dropped_trees_count()
+
+    def __call__(self, spans: List[Span]):
+        self.__impl(spans)
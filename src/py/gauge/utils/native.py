@@ -0,0 +1,10 @@
+"""Helpers for wrappers of native (C++) pipeline components."""
+
+
+def unwrap(obj):
+    """Get native implementation of a pipeline component if there is one.
+
+    Native components connected to each other exchange data without
+    converting it to Python objects and without taking the GIL.
+    """
+    return getattr(obj, "_native", obj)
@@ -0,0 +1,93 @@
+"""Helpers shared by the tests."""
+import datetime as dt
+
+import pytest
+
+from _gauge import Frame, Frames, Span, TraceSample
+
+EPOCH = dt.datetime(2020, 1, 1)
+
+
+@pytest.fixture
+def make_span():
+    """Make a span, fields that aren't given are filled with defaults.
+
+    ``offset`` is the time since the start of the test's timeline, it is
+    used for both the monotonic and the wall-clock timestamps.
+    """
+
+    def make(
+        lifetime,
+        span_id,
+        parent_id="",
+        offset=dt.timedelta(0),
+        file_name="/app/module.py",
+        symbolic_name="function",
+        thread_id=1,
+    ):
+        return Span(
+            lifetime=lifetime,
+            id=span_id,
+            parent_id=parent_id,
+            correlation_id="",
+            is_top=not parent_id,
+            symbolic_name=symbolic_name,
+            file_name=file_name,
+            line_number=1,
+            is_coroutine=False,
+            is_generator=False,
+            monotonic_clock_timestamp=offset,
+            timestamp=EPOCH + offset,
+            thread_id=thread_id,
+            process_id=1,
+            hostname="localhost",
+        )
+
+    return make
+
+
+
+@pytest.fixture
+def make_trace():
+    """Make a trace of frames given as (file name, line number) pairs,
+    bottommost first.
+
+    ``cookies`` identify calls of the frames, all zeros by default. A trace
+    without lines is an unchanged trace.
+    """
+
+    def make(
+        lines,
+        offset=dt.timedelta(0),
+        thread_id=1,
+        weight=dt.timedelta(0),
+        cpu_time=dt.timedelta(0),
+        cookies=None,
+    ):
+        frames = Frames(
+            Frame(
+                symbolic_name="function",
+                file_name=file_name,
+                line_number=line_number,
+                is_coroutine=False,
+                is_generator=False,
+                cookie=cookie,
+            )
+            for (file_name, line_number), cookie in zip(
+                lines, cookies or [0] * len(lines)
+            )
+        )
+        trace = TraceSample(
+            frames=frames,
+            monotonic_clock_timestamp=offset,
+            timestamp=EPOCH + offset,
+            thread_id=thread_id,
+            process_id=1,
+            hostname="localhost",
+        )
+        trace.is_unchanged = not lines
+        trace.weight = weight
+        trace.cpu_time = cpu_time
+        return trace
+
+    return make
@@ -0,0 +1,58 @@
+import datetime as dt
+import tracemalloc
+
+import pytest
+
+from gauge import AllocationCollector, CollectorError
+
+
+def allocate_and_release(count):
+    for _ in range(count):
+        bytearray(1024)
+
+
+def allocate_and_keep(count):
+    return [bytearray(1024) for _ in range(count)]
+
+
+def read_profile(path):
+    with open(path) as file:
+        return [line.rsplit(" ", 1) for line in file.read().splitlines()]
+
+
+def test_samples_allocated_and_live_memory(tmp_path):
+    collector = AllocationCollector(
+        sampling_rate=16 * 1024,
+        processing_interval=dt.timedelta(milliseconds=10),
+    )
+    collector.start()
+    allocate_and_release(1000)
+    kept = allocate_and_keep(1000)
+    collector.stop()
+
+    assert collector.dump(str(tmp_path / "allocated.txt")) > 0
+    allocated = read_profile(tmp_path / "allocated.txt")
+    assert any("allocate_and_release" in stack for stack, _ in allocated)
+    assert any("allocate_and_keep" in stack for stack, _ in allocated)
+    assert all(int(bytes_) > 0 for _, bytes_ in allocated)
+
+    collector.dump(str(tmp_path / "live.txt"), live=True)
+    live = read_profile(tmp_path / "live.txt")
+    assert any("allocate_and_keep" in stack for stack, _ in live)
+    del kept
+
+
+def test_stop_fails_while_allocator_is_wrapped():
+    collector = AllocationCollector(sampling_rate=16 * 1024)
+    collector.start()
+    tracemalloc.start()
+    try:
+        with pytest.raises(CollectorError):
+            collector.stop()
+        # The hooks are still installed and keep forwarding allocations.
+        allocate_and_keep(100)
+        assert not collector.is_stopped()
+    finally:
+        tracemalloc.stop()
+    collector.stop()
+    assert collector.is_stopped()
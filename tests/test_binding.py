@@ -0,0 +1,26 @@
+from _gauge import Frame
+
+
+def make_frame(file_name):
+    return Frame(
+        symbolic_name="function",
+        file_name=file_name,
+        line_number=1,
+        is_coroutine=False,
+        is_generator=False,
+        cookie=0,
+    )
+
+
+def test_strings_are_cached():
+    frame = make_frame("/app/module.py")
+    assert frame.file_name is frame.file_name
+    assert make_frame("/app/module.py").file_name is frame.file_name
+
+
+def test_cached_strings_follow_changed_attributes():
+    frame = make_frame("/app/module.py")
+    assert frame.file_name == "/app/module.py"
+    # Same address, different content.
+    frame.file_name = "/app/other.py"
+    assert frame.file_name == "/app/other.py"
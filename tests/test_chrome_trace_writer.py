@@ -0,0 +1,139 @@
+import datetime as dt
+import json
+
+from gauge import BackpressurePolicy, ChromeTraceWriter, Span
+from _gauge import Spans
+
+START = Span.SpanLifeTime.Start
+END = Span.SpanLifeTime.End
+
+
+def read_events(path):
+    with open(path) as file:
+        return [event for event in json.load(file) if event["ph"] != "M"]
+
+
+def test_names_are_quoted(tmp_path, make_span):
+    path = str(tmp_path / "trace.json")
+    writer = ChromeTraceWriter(path)
+    name = 'say "hi"\\\n\t\x01 привет'
+    writer(
+        Spans(
+            [
+                make_span(START, "1", symbolic_name=name),
+                make_span(END, "1", offset=dt.timedelta(microseconds=1500)),
+            ]
+        )
+    )
+    writer.close()
+
+    assert writer.get_paths() == [path]
+    start, end = read_events(path)
+    assert start["name"] == name
+    assert start["ph"] == "B"
+    assert end["ph"] == "E"
+    assert end["ts"] - start["ts"] == 1500
+
+
+def test_files_are_rotated(tmp_path, make_span):
+    path = str(tmp_path / "trace.json")
+    writer = ChromeTraceWriter(path, max_file_size=1024)
+    spans = [make_span(START, "top")]
+    for number in range(20):
+        offset = dt.timedelta(milliseconds=number)
+        spans.append(make_span(START, str(number), "top", offset=offset))
+        spans.append(make_span(END, str(number), "top", offset=offset))
+    spans.append(make_span(END, "top", offset=dt.timedelta(seconds=1)))
+    writer(Spans(spans))
+    writer.close()
+
+    paths = writer.get_paths()
+    assert len(paths) > 2
+    assert paths[:3] == [
+        path,
+        str(tmp_path / "trace.1.json"),
+        str(tmp_path / "trace.2.json"),
+    ]
+    for file_path in paths:
+        events = read_events(file_path)
+        # Spans open at rotation are ended and started again, so each file
+        # is balanced on its own.
+        phases = [event["ph"] for event in events]
+        assert phases.count("B") == phases.count("E")
+        if events:
+            assert events[0]["name"] == "function"
+
+
+def test_numbers_are_appended_to_paths_without_extensions(
+    tmp_path, make_span
+):
+    directory = tmp_path / "traces.d"
+    directory.mkdir()
+    path = str(directory / "trace")
+    writer = ChromeTraceWriter(path, max_file_size=1)
+    writer(Spans([make_span(START, "1"), make_span(END, "1")]))
+    writer.close()
+
+    assert writer.get_paths()[:2] == [path, path + ".1"]
+
+
+def test_rotation_does_not_block_producers(tmp_path, make_span):
+    writer = ChromeTraceWriter(
+        str(tmp_path / "trace.json"),
+        max_file_size=256,
+        queue_capacity=1,
+        policy=BackpressurePolicy.Block,
+    )
+    # The queue is full most of the time, so batches are pushed while
+    # the writer thread rotates files.
+    for number in range(200):
+        offset = dt.timedelta(milliseconds=number)
+        writer(
+            Spans(
+                [
+                    make_span(START, str(number), offset=offset),
+                    make_span(END, str(number), offset=offset),
+                ]
+            )
+        )
+    writer.close()
+
+    assert writer.get_written_events_count() >= 400
+    assert len(writer.get_paths()) > 10
+
+
+def test_spans_ended_out_of_order_close_their_own_slices(tmp_path, make_span):
+    path = str(tmp_path / "trace.json")
+    writer = ChromeTraceWriter(path)
+    writer(
+        Spans(
+            [
+                make_span(START, "outer", symbolic_name="outer"),
+                make_span(
+                    START,
+                    "inner",
+                    offset=dt.timedelta(microseconds=1),
+                    symbolic_name="inner",
+                ),
+                make_span(END, "outer", offset=dt.timedelta(microseconds=2)),
+                make_span(END, "inner", offset=dt.timedelta(microseconds=3)),
+            ]
+        )
+    )
+    writer.close()
+
+    # Replay the events the way viewers do - "E" ends the innermost slice.
+    stack = []
+    slices = []
+    for event in read_events(path):
+        if event["ph"] == "B":
+            stack.append(event)
+        else:
+            start = stack.pop()
+            slices.append((start["name"], start["ts"], event["ts"]))
+    assert not stack
+    base = min(start for _, start, _ in slices)
+    outer = [(s - base, e - base) for n, s, e in slices if n == "outer"]
+    inner = [(s - base, e - base) for n, s, e in slices if n == "inner"]
+    assert outer == [(0, 2)]
+    assert sorted(inner) == [(1, 2), (2, 3)]
@@ -0,0 +1,45 @@
+import datetime as dt
+
+from _gauge.testing import FastClock
+
+
+class SimulatedClocks:
+    """TSC ticking once per nanosecond and a steady clock slewed by NTP."""
+
+    def __init__(self):
+        self.ticks = 0
+        self.steady = 0
+
+    def advance(self, seconds, steady_rate=1.0):
+        self.ticks += seconds * 10**9
+        self.steady += round(seconds * 10**6 * steady_rate)
+
+    def read_steady(self):
+        return dt.timedelta(microseconds=self.steady)
+
+    def get_offset(self, clock):
+        return clock.now() - self.read_steady()
+
+
+def test_offset_from_slewed_steady_clock_is_slewed_away():
+    clocks = SimulatedClocks()
+    clock = FastClock(lambda: clocks.ticks, clocks.read_steady)
+    previous = clock.now()
+
+    def run(seconds, steady_rate):
+        nonlocal previous
+        for _ in range(seconds):
+            clocks.advance(1, steady_rate)
+            clock.calibrate()
+            now = clock.now()
+            assert now >= previous
+            previous = now
+
+    run(1000, 1.0)
+    assert abs(clocks.get_offset(clock)) < dt.timedelta(microseconds=10)
+    # The frequency is measured over the whole uptime, so it lags behind
+    # the slewed steady clock and the mapping runs ahead of it.
+    run(60, 0.9995)
+    assert clocks.get_offset(clock) < dt.timedelta(milliseconds=2)
+    run(120, 1.0)
+    assert abs(clocks.get_offset(clock)) < dt.timedelta(milliseconds=1)
@@ -0,0 +1,51 @@
+import datetime as dt
+
+from gauge import LatencyAggregator, Span
+from _gauge import Spans
+
+START = Span.SpanLifeTime.Start
+END = Span.SpanLifeTime.End
+
+
+def test_oldest_open_spans_are_dropped(make_span):
+    aggregator = LatencyAggregator(max_open_spans=4)
+    starts = [
+        make_span(START, str(number), offset=dt.timedelta(seconds=number))
+        for number in range(6)
+    ]
+    ends = [
+        make_span(END, str(number), offset=dt.timedelta(seconds=7))
+        for number in range(6)
+    ]
+    aggregator(Spans(starts + ends))
+    stats = aggregator.snapshot()
+    assert len(stats) == 1
+    # Spans "0" and "1" were dropped when the fifth span has started.
+    assert stats[0].count == 4
+    assert stats[0].max <= dt.timedelta(seconds=5)
+
+
+def test_subscribers_could_subscribe_from_callbacks(make_span):
+    aggregator = LatencyAggregator(window=dt.timedelta(seconds=1))
+    late_snapshots = []
+
+    def subscribe_late(snapshot):
+        # Would deadlock if the aggregator's mutex or the lock of
+        # the subscribers was held.
+        if not late_snapshots:
+            aggregator.subscribe(late_snapshots.append)
+
+    aggregator.subscribe(subscribe_late)
+    for second in range(3):
+        offset = dt.timedelta(seconds=second)
+        aggregator(
+            Spans(
+                [
+                    make_span(START, str(second), offset=offset),
+                    make_span(END, str(second), offset=offset),
+                ]
+            )
+        )
+    # Windows are switched at the second and the third spans, the late
+    # subscriber sees only the latter.
+    assert len(late_snapshots) == 1
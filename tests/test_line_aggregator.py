@@ -0,0 +1,66 @@
+import datetime as dt
+
+from _gauge import TraceSamples
+from gauge import LineAggregator
+
+
+def test_cpu_times_of_traces_are_summed_per_line(make_trace):
+    aggregator = LineAggregator()
+    busy = [("/app/a.py", 10), ("/app/a.py", 1)]
+    idle = [("/app/b.py", 20), ("/app/a.py", 1)]
+    aggregator(
+        TraceSamples(
+            [
+                make_trace(busy, cpu_time=dt.timedelta(milliseconds=9)),
+                make_trace(idle, cpu_time=dt.timedelta(milliseconds=1)),
+                make_trace(idle, cpu_time=dt.timedelta(0)),
+            ]
+        )
+    )
+    lines = {
+        (line.file_name, line.line_number): line
+        for line in aggregator.snapshot()
+    }
+    assert lines[("/app/a.py", 10)].self_cpu_time == dt.timedelta(
+        milliseconds=9
+    )
+    assert lines[("/app/b.py", 20)].self_cpu_time == dt.timedelta(
+        milliseconds=1
+    )
+    assert lines[("/app/a.py", 1)].self_cpu_time == dt.timedelta(0)
+    assert lines[("/app/a.py", 1)].total_cpu_time == dt.timedelta(
+        milliseconds=10
+    )
+
+    # The idle line is sampled more often, the busy line uses more CPU.
+    top = aggregator.top(1)
+    assert (top[0].file_name, top[0].line_number) == ("/app/b.py", 20)
+    top = aggregator.top(1, by_cpu_time=True)
+    assert (top[0].file_name, top[0].line_number) == ("/app/a.py", 10)
+
+
+def test_subscribers_are_called_without_the_lock(make_trace):
+    aggregator = LineAggregator(snapshot_interval=dt.timedelta(seconds=1))
+    snapshots = []
+
+    def callback(lines):
+        # Would deadlock if called with the aggregator's mutex held.
+        snapshots.append(
+            (
+                [line.self_count for line in lines],
+                aggregator.get_samples_count(),
+            )
+        )
+
+    aggregator.subscribe(callback)
+    stack = [("/app/a.py", 10)]
+    aggregator(
+        TraceSamples(
+            [
+                make_trace(stack, offset=dt.timedelta(seconds=offset))
+                for offset in range(3)
+            ]
+        )
+    )
+    # Snapshots are passed once the whole batch is counted.
+    assert snapshots == [([2], 0), ([1], 0)]
@@ -0,0 +1,225 @@
+import contextvars
+import datetime as dt
+import threading
+import time
+
+import pytest
+
+from gauge import CollectorError, SamplingCollector, get_tag
+
+
+def run_idle_thread(function):
+    """Run the function while another thread is waiting on an event."""
+    stop = threading.Event()
+    thread = threading.Thread(target=stop.wait)
+    thread.start()
+    try:
+        function()
+    finally:
+        stop.set()
+        thread.join()
+    return thread.ident
+
+
+def test_late_subscriber_receives_whole_stacks():
+    collector = SamplingCollector(
+        sampling_interval=dt.timedelta(milliseconds=1),
+        processing_interval=dt.timedelta(milliseconds=10),
+        suppress_unchanged_stacks=True,
+    )
+    traces = []
+
+    def sample():
+        collector.start()
+        # Let the stack of the idle thread be fingerprinted and processed
+        # while there are no subscribers.
+        time.sleep(0.2)
+        collector.subscribe(traces.extend)
+        time.sleep(0.2)
+        collector.stop()
+
+    thread_id = run_idle_thread(sample)
+    thread_traces = [trace for trace in traces if trace.thread_id == thread_id]
+    assert thread_traces
+    assert any(not trace.is_unchanged for trace in thread_traces)
+
+
+def busy_loop(stop):
+    while not stop.is_set():
+        sum(range(100))
+
+
+def test_gil_free_sampling_copies_consistent_stacks():
+    try:
+        collector = SamplingCollector(
+            sampling_interval=dt.timedelta(milliseconds=1),
+            processing_interval=dt.timedelta(milliseconds=10),
+            gil_free_sampling=True,
+        )
+    except CollectorError:
+        pytest.skip("GIL-free sampling isn't supported on the platform.")
+    traces = []
+    collector.subscribe(traces.extend)
+    stop = threading.Event()
+    thread = threading.Thread(target=busy_loop, args=(stop,))
+    thread.start()
+    collector.start()
+    time.sleep(0.3)
+    collector.stop()
+    stop.set()
+    thread.join()
+    thread_traces = [t for t in traces if t.thread_id == thread.ident]
+    assert thread_traces
+    for trace in thread_traces:
+        names = [frame.symbolic_name for frame in trace.frames]
+        # Bottommost frame goes first, the caller is always right below.
+        assert "busy_loop" in names
+        assert names[names.index("busy_loop") + 1] == "run"
+
+
+def test_flight_recorder_replays_unchanged_stacks_whole(tmp_path):
+    collector = SamplingCollector(
+        sampling_interval=dt.timedelta(milliseconds=1),
+        processing_interval=dt.timedelta(milliseconds=10),
+        suppress_unchanged_stacks=True,
+        flight_recorder_capacity=1000,
+    )
+    traces = []
+    collector.subscribe(traces.extend)
+
+    def sample():
+        collector.start()
+        time.sleep(0.3)
+        collector.stop()
+
+    thread_id = run_idle_thread(sample)
+    assert not traces
+
+    # Stacks of the idle thread are recorded whole only once in a hundred
+    # samples, the rest refer to them.
+    assert collector.replay() > 0
+    thread_traces = [trace for trace in traces if trace.thread_id == thread_id]
+    assert thread_traces
+    for trace in thread_traces:
+        assert not trace.is_unchanged
+        assert "wait" in [frame.symbolic_name for frame in trace.frames]
+
+    path = tmp_path / "stacks.txt"
+    count = collector.dump(str(path))
+    assert count == len(traces)
+    lines = path.read_text().splitlines()
+    assert sum(int(line.rsplit(" ", 1)[1]) for line in lines) == count
+
+
+class Unprintable:
+    def __str__(self):
+        raise AssertionError("Tags must be read without Python code.")
+
+
+def test_tags_are_read_without_running_python_code():
+    variables = [contextvars.ContextVar(name) for name in "abcde"]
+    collector = SamplingCollector(
+        sampling_interval=dt.timedelta(milliseconds=1),
+        processing_interval=dt.timedelta(milliseconds=10),
+        context_vars=variables,
+    )
+    traces = []
+    collector.subscribe(traces.extend)
+
+    def sample():
+        for variable, value in zip(variables, ["x", 7, 0.5, True]):
+            variable.set(value)
+        variables[-1].set(Unprintable())
+        collector.start()
+        time.sleep(0.2)
+        collector.stop()
+
+    sample_thread = threading.Thread(
+        target=contextvars.copy_context().run, args=(sample,)
+    )
+    sample_thread.start()
+    sample_thread.join()
+    tags = {
+        get_tag(tag)
+        for trace in traces
+        if trace.thread_id == sample_thread.ident
+        for tag in trace.tags
+    }
+    assert tags == {
+        ("a", "x"),
+        ("b", "7"),
+        ("c", "0.5"),
+        ("d", "True"),
+        ("e", "<Unprintable>"),
+    }
+
+
+def test_timestamps_follow_both_clocks():
+    collector = SamplingCollector(
+        sampling_interval=dt.timedelta(milliseconds=1),
+        processing_interval=dt.timedelta(milliseconds=10),
+    )
+    traces = []
+    collector.subscribe(traces.extend)
+    started_at = dt.datetime.now()
+    started_at_monotonic = dt.timedelta(seconds=time.monotonic())
+    collector.start()
+    time.sleep(0.3)
+    collector.stop()
+    stopped_at = dt.datetime.now()
+    stopped_at_monotonic = dt.timedelta(seconds=time.monotonic())
+
+    assert traces
+    tolerance = dt.timedelta(milliseconds=50)
+    by_thread = {}
+    for trace in traces:
+        assert (
+            started_at - tolerance <= trace.timestamp <= stopped_at + tolerance
+        )
+        assert (
+            started_at_monotonic - tolerance
+            <= trace.monotonic_clock_timestamp
+            <= stopped_at_monotonic + tolerance
+        )
+        by_thread.setdefault(trace.thread_id, []).append(trace)
+    for thread_traces in by_thread.values():
+        monotonic = [t.monotonic_clock_timestamp for t in thread_traces]
+        assert monotonic == sorted(monotonic)
+        # Both timestamps of traces are taken from the same mapping, so
+        # distances between them agree.
+        first, last = thread_traces[0], thread_traces[-1]
+        wall_distance = last.timestamp - first.timestamp
+        monotonic_distance = (
+            last.monotonic_clock_timestamp - first.monotonic_clock_timestamp
+        )
+        assert abs(wall_distance - monotonic_distance) < tolerance
+
+
+def test_renamed_threads_are_matched_by_new_names():
+    collector = SamplingCollector(
+        sampling_interval=dt.timedelta(milliseconds=1),
+        processing_interval=dt.timedelta(milliseconds=10),
+    )
+    collector.thread_filter.set_included_names(["worker-*"])
+    traces = []
+    collector.subscribe(traces.extend)
+    renamed = threading.Event()
+    stop = threading.Event()
+
+    def work():
+        time.sleep(0.3)
+        threading.current_thread().name = "worker-1"
+        renamed.set()
+        stop.wait()
+
+    thread = threading.Thread(target=work, name="idle")
+    collector.start()
+    thread.start()
+    renamed.wait()
+    # The old name could be cached for a second after the rename.
+    time.sleep(1.5)
+    collector.stop()
+    stop.set()
+    thread.join()
+
+    assert any(trace.thread_id == thread.ident for trace in traces)
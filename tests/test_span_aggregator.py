@@ -0,0 +1,90 @@
+import datetime as dt
+
+from gauge import Span, SpanAggregator
+from _gauge import TraceSamples
+
+END = Span.SpanLifeTime.End
+
+
+def test_unchanged_traces_keep_spans_from_eviction(make_trace):
+    aggregator = SpanAggregator()
+    aggregator.set_open_spans_budget(4)
+    received = []
+    aggregator.subscribe(received.extend)
+    stack = [("/app/a.py", 2), ("/app/a.py", 1)]
+
+    def at(milliseconds):
+        return dt.timedelta(milliseconds=milliseconds)
+
+    aggregator(
+        TraceSamples(
+            [
+                make_trace(stack, offset=at(0), thread_id=1, cookies=[2, 1]),
+                make_trace(stack, offset=at(1), thread_id=2, cookies=[4, 3]),
+                # The first thread is idle but alive.
+                make_trace([], offset=at(2), thread_id=1),
+                make_trace(stack, offset=at(3), thread_id=3, cookies=[6, 5]),
+            ]
+        )
+    )
+    ended = [span for span in received if span.lifetime == END]
+    assert len(ended) == 2
+    assert all(span.thread_id == 2 for span in ended)
+    assert aggregator.get_evicted_spans_count() == 2
+
+
+def at(milliseconds):
+    return dt.timedelta(milliseconds=milliseconds)
+
+
+def test_siblings_end_when_last_seen_in_unchanged_traces(make_trace):
+    aggregator = SpanAggregator()
+    received = []
+    aggregator.subscribe(received.extend)
+    parent = ("/app/a.py", 1)
+
+    aggregator(
+        TraceSamples(
+            [
+                make_trace([("/app/f.py", 2), parent], at(0), cookies=[2, 1]),
+                make_trace([], offset=at(1)),
+                make_trace([], offset=at(2)),
+                # "g" replaces its sibling "f" under the same parent.
+                make_trace([("/app/g.py", 3), parent], at(3), cookies=[3, 1]),
+            ]
+        )
+    )
+    (ended,) = [
+        span
+        for span in received
+        if span.lifetime == END and span.file_name == "/app/f.py"
+    ]
+    assert ended.monotonic_clock_timestamp == at(2)
+
+
+def test_coalesced_calls_last_until_unchanged_traces(make_trace):
+    aggregator = SpanAggregator(coalesce_siblings=True)
+    received = []
+    aggregator.subscribe(received.extend)
+    child, parent = ("/app/f.py", 2), ("/app/a.py", 1)
+
+    aggregator(
+        TraceSamples(
+            [
+                make_trace([child, parent], at(0), cookies=[2, 1]),
+                make_trace([], offset=at(2)),
+                # The same function is called again from the same line.
+                make_trace([child, parent], at(3), cookies=[3, 1]),
+                make_trace([], offset=at(5)),
+            ]
+        )
+    )
+    aggregator.finish_open_spans()
+    (ended,) = [
+        span
+        for span in received
+        if span.lifetime == END and span.file_name == "/app/f.py"
+    ]
+    assert ended.repetition_count == 2
+    assert ended.monotonic_clock_timestamp == at(5)
+    assert ended.summed_duration == at(4)
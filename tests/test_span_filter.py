@@ -0,0 +1,60 @@
+import os
+
+from gauge import Span, SpanFilter
+from _gauge import Spans
+
+START = Span.SpanLifeTime.Start
+END = Span.SpanLifeTime.End
+
+
+def filter_ids(span_filter, make_span, file_names):
+    """Pass a pair of spans of each file, get IDs of kept start-spans."""
+    received = []
+    span_filter.subscribe(received.extend)
+    spans = []
+    for number, file_name in enumerate(file_names):
+        spans.append(make_span(START, str(number), file_name=file_name))
+        spans.append(make_span(END, str(number), file_name=file_name))
+    span_filter(Spans(spans))
+    return [span.id for span in received if span.lifetime == START]
+
+
+def test_denied_files(make_span):
+    span_filter = SpanFilter(denied_files=["*/site-packages/*"])
+    ids = filter_ids(
+        span_filter,
+        make_span,
+        ["/app/main.py", "/usr/lib/site-packages/requests/api.py"],
+    )
+    assert ids == ["0"]
+
+
+def test_denied_modules(make_span, tmp_path, monkeypatch):
+    monkeypatch.syspath_prepend(str(tmp_path))
+    span_filter = SpanFilter(denied_modules=["pkg", "pkg.*"])
+    ids = filter_ids(
+        span_filter,
+        make_span,
+        [
+            os.path.join(str(tmp_path), "pkg", "__init__.py"),
+            os.path.join(str(tmp_path), "pkg", "sub.py"),
+            os.path.join(str(tmp_path), "pkgother.py"),
+        ],
+    )
+    assert ids == ["2"]
+
+
+def test_allowed_modules(make_span, tmp_path, monkeypatch):
+    monkeypatch.syspath_prepend(str(tmp_path))
+    span_filter = SpanFilter(allowed_modules=["app.*", "importlib.*"])
+    ids = filter_ids(
+        span_filter,
+        make_span,
+        [
+            os.path.join(str(tmp_path), "app", "views.py"),
+            os.path.join(str(tmp_path), "lib.py"),
+            "<frozen importlib._bootstrap>",
+            "/outside/of/sys/path.py",
+        ],
+    )
+    assert ids == ["0", "2"]
@@ -0,0 +1,70 @@
+import datetime as dt
+import threading
+import time
+
+from gauge import Span
+from _gauge import SpanRegistry, Spans
+
+START = Span.SpanLifeTime.Start
+END = Span.SpanLifeTime.End
+
+
+def test_contexts_of_threads_expire(make_span):
+    registry = SpanRegistry(dict, context_ttl=dt.timedelta(milliseconds=50))
+    exported = registry(
+        Spans([make_span(START, "1", thread_id=1), make_span(START, "2")])
+    )
+    # Spans of the same thread share a context.
+    assert exported[0][1].context is exported[1][1].context
+    registry(Spans([make_span(START, "3", thread_id=2)]))
+    assert registry.get_contexts_count() == 2
+    time.sleep(0.1)
+    assert registry.get_contexts_count() == 0
+
+    exported = registry(Spans([make_span(START, "4")]))
+    assert registry.get_contexts_count() == 1
+    assert exported[0][1].context == {}
+
+
+def test_stripped_spans_are_not_exported(make_span):
+    registry = SpanRegistry(dict)
+    registry.strip_levels(1)
+    exported = registry(
+        Spans(
+            [
+                make_span(START, "1"),
+                make_span(START, "2", parent_id="1"),
+                make_span(END, "2", parent_id="1"),
+                make_span(END, "1"),
+            ]
+        )
+    )
+    assert [(span.id, span.lifetime) for span, _ in exported] == [
+        ("2", START),
+        ("2", END),
+    ]
+    assert all(entry.is_top for _, entry in exported)
+    assert registry.get_spans_count() == 0
+
+
+def test_python_code_of_contexts_could_use_registry(make_span):
+    calls = []
+
+    class Context:
+        def __init__(self):
+            # Waiting for another thread releases the GIL.
+            thread = threading.Thread(
+                target=lambda: calls.append(registry.get_contexts_count())
+            )
+            thread.start()
+            thread.join()
+
+        def __del__(self):
+            calls.append(registry.get_spans_count())
+
+    registry = SpanRegistry(Context, context_ttl=dt.timedelta(milliseconds=50))
+    registry(Spans([make_span(START, "1", thread_id=1)]))
+    time.sleep(0.1)
+    registry(Spans([make_span(END, "1", thread_id=1)]))
+    assert registry.get_contexts_count() == 0
+    assert len(calls) == 2
@@ -0,0 +1,161 @@
+import datetime as dt
+
+from gauge import Span, SpanRetention
+from _gauge import Spans
+
+START = Span.SpanLifeTime.Start
+END = Span.SpanLifeTime.End
+
+
+def at(milliseconds):
+    return dt.timedelta(milliseconds=milliseconds)
+
+
+def make_tree(make_span, top_id, start, end, thread_id=1):
+    """Make spans of a top-level span with one child, in order."""
+    child_id = top_id + ".1"
+    return [
+        make_span(START, top_id, offset=at(start), thread_id=thread_id),
+        make_span(
+            START, child_id, top_id, offset=at(start), thread_id=thread_id
+        ),
+        make_span(END, child_id, top_id, offset=at(end), thread_id=thread_id),
+        make_span(END, top_id, offset=at(end), thread_id=thread_id),
+    ]
+
+
+def subscribe(retention):
+    batches = []
+    retention.subscribe(
+        lambda spans: batches.append([(s.id, s.lifetime) for s in spans])
+    )
+    return batches
+
+
+def test_trees_are_kept_or_dropped_by_duration(make_span):
+    retention = SpanRetention(min_duration=at(100))
+    batches = subscribe(retention)
+
+    retention(Spans(make_tree(make_span, "slow", 0, 150)))
+    retention(Spans(make_tree(make_span, "fast", 200, 210)))
+
+    assert batches == [
+        [
+            ("slow", START),
+            ("slow.1", START),
+            ("slow.1", END),
+            ("slow", END),
+        ]
+    ]
+    assert retention.get_kept_trees_count() == 1
+    assert retention.get_dropped_trees_count() == 1
+
+
+def test_spans_are_held_until_top_span_ends(make_span):
+    retention = SpanRetention(min_duration=at(100))
+    batches = subscribe(retention)
+    spans = make_tree(make_span, "slow", 0, 150)
+
+    retention(Spans(spans[:3]))
+    assert batches == []
+    retention(Spans(spans[3:]))
+    assert [len(batch) for batch in batches] == [4]
+
+
+def test_sampled_trees_are_kept_regardless_of_duration(make_span):
+    retention = SpanRetention(min_duration=at(100), sample_rate=1.0)
+    batches = subscribe(retention)
+
+    retention(Spans(make_tree(make_span, "fast", 0, 10)))
+
+    assert [len(batch) for batch in batches] == [4]
+    assert retention.get_kept_trees_count() == 1
+
+
+def test_trees_over_bound_are_released_early(make_span):
+    retention = SpanRetention(min_duration=at(100), max_held_spans=2)
+    batches = subscribe(retention)
+
+    retention(
+        Spans(
+            [
+                make_span(START, "top", offset=at(0)),
+                make_span(START, "a", "top", offset=at(0)),
+                make_span(END, "a", "top", offset=at(150)),
+            ]
+        )
+    )
+    # The tree has lasted long enough when it went over the bound, so it's
+    # let through and the following spans are passed right away.
+    assert batches == [[("top", START), ("a", START), ("a", END)]]
+    retention(
+        Spans(
+            [
+                make_span(START, "b", "top", offset=at(160)),
+                make_span(END, "b", "top", offset=at(170)),
+                make_span(END, "top", offset=at(170)),
+            ]
+        )
+    )
+    assert batches[1] == [("b", START), ("b", END), ("top", END)]
+    assert retention.get_kept_trees_count() == 1
+
+
+def test_short_trees_over_bound_are_dropped_with_children(make_span):
+    retention = SpanRetention(min_duration=at(100), max_held_spans=2)
+    batches = subscribe(retention)
+
+    retention(
+        Spans(
+            [
+                make_span(START, "top", offset=at(0)),
+                make_span(START, "a", "top", offset=at(0)),
+                make_span(END, "a", "top", offset=at(10)),
+                make_span(START, "b", "top", offset=at(20)),
+                make_span(START, "c", "b", offset=at(20)),
+                make_span(END, "c", "b", offset=at(30)),
+                make_span(END, "b", "top", offset=at(30)),
+                # Would have been kept if it had been held until the end.
+                make_span(END, "top", offset=at(200)),
+            ]
+        )
+    )
+
+    assert batches == []
+    assert retention.get_dropped_trees_count() == 1
+    assert retention.get_kept_trees_count() == 0
+
+
+def test_bound_is_per_thread(make_span):
+    retention = SpanRetention(min_duration=at(100), max_held_spans=4)
+    batches = subscribe(retention)
+    first = make_tree(make_span, "first", 0, 150, thread_id=1)
+    second = make_tree(make_span, "second", 0, 10, thread_id=2)
+
+    # Each thread holds 3 spans, which is within the bound of each of them.
+    retention(Spans(first[:3] + second[:3]))
+    assert batches == []
+    retention(Spans(first[3:] + second[3:]))
+    assert [span_id for span_id, _ in batches[0]] == [
+        "first",
+        "first.1",
+        "first.1",
+        "first",
+    ]
+    assert retention.get_dropped_trees_count() == 1
+
+
+def test_spans_of_unknown_trees_are_passed(make_span):
+    retention = SpanRetention(min_duration=at(100))
+    batches = subscribe(retention)
+
+    retention(
+        Spans(
+            [
+                make_span(START, "child", "unknown", offset=at(0)),
+                make_span(END, "child", "unknown", offset=at(10)),
+            ]
+        )
+    )
+
+    assert batches == [[("child", START), ("child", END)]]
@@ -0,0 +1,34 @@
+import datetime as dt
+
+from gauge import TracingCollector
+
+
+def test_restart_forgets_calls_of_previous_session():
+    def interrupted():
+        # Returns after the collector has been stopped, unnoticed.
+        collector.stop()
+
+    def traced():
+        pass
+
+    collector = TracingCollector(
+        traced_functions=[interrupted, traced],
+        processing_interval=dt.timedelta(milliseconds=1),
+    )
+    collector.start()
+    interrupted()
+
+    traces = []
+    collector.subscribe(traces.extend)
+    collector.start()
+    traced()
+    collector.stop()
+
+    stacks = [
+        [frame.symbolic_name for frame in trace.frames]
+        for trace in traces
+        if not trace.is_unchanged
+    ]
+    assert stacks
+    for stack in stacks:
+        assert stack == ["traced"]